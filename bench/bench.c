@@ -0,0 +1,526 @@
+//
+// 基准测试：生成代表性语料（字符串密集、浮点密集、深层嵌套、超大数组、宽对象），
+// 测量 json_parse / json_get / json_to_string / json_free 的吞吐与单次延迟分位数、
+// 分配次数与峰值 RSS，结果以 JSON 输出到标准输出，便于不同构建之间比较。
+// 运行多个语料时每个语料在单独的子进程中执行，峰值 RSS 只反映该语料
+//
+// 用法：mjson_bench [--scale F] [--min-time S] [--flags N] [--corpus NAME] [--output FILE]
+//
+#include "mJson.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MIN_ITERATIONS 5
+#define MAX_ITERATIONS 1000
+#define LOOKUP_COUNT 1024
+#define LOOKUP_BATCH 16  // json_get 每个样本计时的查询次数，降低计时开销的影响
+
+// ============================= 计数分配器 start ================================
+
+static size_t g_alloc_count;
+
+static void *count_malloc(void *ctx, size_t size) {
+    (void)ctx;
+    g_alloc_count++;
+    return malloc(size);
+}
+
+static void *count_realloc(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    g_alloc_count++;
+    return realloc(ptr, size);
+}
+
+static void count_free(void *ctx, void *ptr) {
+    (void)ctx;
+    free(ptr);
+}
+
+// ============================= 计数分配器 end ================================
+
+// ============================= 语料生成 start ================================
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} Buf;
+
+static void buf_printf(Buf *b, const char *fmt, ...) {
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(b->data + b->len, b->cap - b->len, fmt, ap);
+        va_end(ap);
+        if (n < 0) abort();
+        if ((size_t)n < b->cap - b->len) {
+            b->len += (size_t)n;
+            return;
+        }
+        b->cap = (b->cap + (size_t)n + 1) * 2;
+        b->data = realloc(b->data, b->cap);
+        if (!b->data) abort();
+    }
+}
+
+static uint32_t g_seed = 12345;
+
+static uint32_t next_random(void) {
+    g_seed = g_seed * 1103515245u + 12345u;
+    return g_seed >> 8;
+}
+
+static const char *const words[] = {
+    "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit", "sed", "do",
+    "eiusmod", "tempor", "incididunt", "ut", "labore", "et", "dolore", "magna", "aliqua", "caf\\u00e9",
+    "\\\"quoted\\\"", "line\\nbreak", "日本語", "emoji\\u00f1", "https:\\/\\/t.co\\/abc"
+};
+#define WORD_COUNT (sizeof(words) / sizeof(words[0]))
+
+static void gen_text(Buf *b, int count) {
+    for (int i = 0; i < count; i++) {
+        buf_printf(b, "%s%s", i ? " " : "", words[next_random() % WORD_COUNT]);
+    }
+}
+
+/**
+ * 字符串密集：仿推文列表，带转义、非 ASCII 文本和嵌套用户对象
+ */
+static void gen_twitter(Buf *b, double scale, Buf *paths) {
+    int count = (int)(3000 * scale) + 1;
+    buf_printf(b, "{\"statuses\":[");
+    for (int i = 0; i < count; i++) {
+        buf_printf(b, "%s{\"created_at\":\"Sun Aug 31 00:29:%02d +0000 2014\",\"id\":%d,\"id_str\":\"%d\",\"text\":\"",
+                   i ? "," : "", i % 60, 505874924 + i, 505874924 + i);
+        gen_text(b, 12 + (int)(next_random() % 12));
+        buf_printf(b, "\",\"source\":\"<a href=\\\"https:\\/\\/mobile.twitter.com\\\" rel=\\\"nofollow\\\">Mobile Web<\\/a>\","
+                      "\"truncated\":false,\"in_reply_to_status_id\":null,\"user\":{\"id\":%u,\"name\":\"",
+                   next_random());
+        gen_text(b, 2);
+        buf_printf(b, "\",\"screen_name\":\"user_%d\",\"location\":\"", i);
+        gen_text(b, 2);
+        buf_printf(b, "\",\"description\":\"");
+        gen_text(b, 10);
+        buf_printf(b, "\",\"followers_count\":%u,\"friends_count\":%u,\"verified\":%s,\"lang\":\"ja\"},"
+                      "\"retweet_count\":%u,\"favorite_count\":%u,\"entities\":{\"hashtags\":[\"%s\"],"
+                      "\"urls\":[],\"user_mentions\":[{\"screen_name\":\"user_%u\",\"indices\":[0,%u]}]},"
+                      "\"favorited\":false,\"retweeted\":false,\"lang\":\"ja\"}",
+                   next_random() % 100000, next_random() % 5000, i % 7 ? "false" : "true",
+                   next_random() % 1000, next_random() % 1000, words[next_random() % 19],
+                   next_random() % (unsigned)count, 5 + next_random() % 10);
+    }
+    buf_printf(b, "],\"search_metadata\":{\"completed_in\":0.087,\"max_id\":505874924095815681,\"count\":%d}}", count);
+
+    static const char *const fields[] = {"text", "id", "user.screen_name", "user.followers_count",
+                                         "entities.user_mentions[0].indices[1]", "retweet_count"};
+    for (int i = 0; i < LOOKUP_COUNT; i++) {
+        buf_printf(paths, "statuses[%u].%s", next_random() % (unsigned)count, fields[i % 6]);
+        buf_printf(paths, "%c", '\0');
+    }
+}
+
+/**
+ * 浮点密集：仿 GeoJSON 国界，大量 [经度, 纬度] 坐标对
+ */
+static void gen_canada(Buf *b, double scale, Buf *paths) {
+    int rings = (int)(480 * scale) + 1;
+    int points = 120;
+    buf_printf(b, "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\","
+                  "\"properties\":{\"name\":\"Canada\"},\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[");
+    for (int r = 0; r < rings; r++) {
+        buf_printf(b, "%s[", r ? "," : "");
+        for (int p = 0; p < points; p++) {
+            double lon = -141.0 + (next_random() % 8800000) / 100000.0;
+            double lat = 41.0 + (next_random() % 4200000) / 100000.0;
+            buf_printf(b, "%s[%.14g,%.14g]", p ? "," : "", lon, lat);
+        }
+        buf_printf(b, "]");
+    }
+    buf_printf(b, "]}}]}");
+
+    for (int i = 0; i < LOOKUP_COUNT; i++) {
+        buf_printf(paths, "features[0].geometry.coordinates[%u][%u][%u]",
+                   next_random() % (unsigned)rings, next_random() % (unsigned)points, next_random() % 2);
+        buf_printf(paths, "%c", '\0');
+    }
+}
+
+/**
+ * 深层嵌套：多条对象/数组交替嵌套的长链，查询路径贯穿整条链
+ */
+static void gen_deep(Buf *b, double scale, Buf *paths) {
+    int chains = (int)(256 * scale) + 1;
+    int depth = 200;
+    buf_printf(b, "[");
+    for (int c = 0; c < chains; c++) {
+        buf_printf(b, "%s", c ? "," : "");
+        for (int d = 0; d < depth; d++) buf_printf(b, "{\"level\":%d,\"id\":\"n%d_%d\",\"child\":[", d, c, d);
+        buf_printf(b, "\"leaf\"");
+        for (int d = 0; d < depth; d++) buf_printf(b, "]}");
+    }
+    buf_printf(b, "]");
+
+    for (int i = 0; i < LOOKUP_COUNT; i++) {
+        int target = 1 + (int)(next_random() % (unsigned)depth);
+        buf_printf(paths, "[%u]", next_random() % (unsigned)chains);
+        for (int d = 0; d < target; d++) buf_printf(paths, ".child[0]");
+        buf_printf(paths, "%c", '\0');
+    }
+}
+
+/**
+ * 超大数组：整数、浮点与少量短字符串混排的扁平数组
+ */
+static void gen_huge_array(Buf *b, double scale, Buf *paths) {
+    int count = (int)(400000 * scale) + 1;
+    buf_printf(b, "[");
+    for (int i = 0; i < count; i++) {
+        uint32_t r = next_random();
+        if (r % 8 == 0) buf_printf(b, "%s\"s%u\"", i ? "," : "", r % 1000);
+        else if (r % 3 == 0) buf_printf(b, "%s%.6g", i ? "," : "", (r % 1000000) / 997.0);
+        else buf_printf(b, "%s%d", i ? "," : "", (int)(r % 2000000) - 1000000);
+    }
+    buf_printf(b, "]");
+
+    for (int i = 0; i < LOOKUP_COUNT; i++) {
+        buf_printf(paths, "[%u]", next_random() % (unsigned)count);
+        buf_printf(paths, "%c", '\0');
+    }
+}
+
+/**
+ * 宽对象：单个对象含大量键，查询按键随机访问（无序对象为线性查找）
+ */
+static void gen_wide_object(Buf *b, double scale, Buf *paths) {
+    int count = (int)(100000 * scale) + 1;
+    buf_printf(b, "{");
+    for (int i = 0; i < count; i++) {
+        buf_printf(b, "%s\"key_%07d\":{\"v\":%d,\"ok\":%s}", i ? "," : "", i, i, i % 2 ? "true" : "false");
+    }
+    buf_printf(b, "}");
+
+    for (int i = 0; i < LOOKUP_COUNT; i++) {
+        buf_printf(paths, "key_%07u.v", next_random() % (unsigned)count);
+        buf_printf(paths, "%c", '\0');
+    }
+}
+
+typedef struct {
+    const char *name;
+    void (*generate)(Buf *b, double scale, Buf *paths);
+} Corpus;
+
+static const Corpus corpora[] = {
+    {"twitter", gen_twitter},
+    {"canada", gen_canada},
+    {"deep_nesting", gen_deep},
+    {"huge_array", gen_huge_array},
+    {"wide_object", gen_wide_object},
+};
+
+// ============================= 语料生成 end ================================
+
+// ============================= 统计与输出 start ================================
+
+typedef struct {
+    double *samples;  // 秒
+    size_t count;
+    size_t cap;
+    double total;
+} Series;
+
+static void series_add(Series *s, double seconds) {
+    if (s->count == s->cap) {
+        s->cap = s->cap ? s->cap * 2 : 64;
+        s->samples = realloc(s->samples, s->cap * sizeof(double));
+        if (!s->samples) abort();
+    }
+    s->samples[s->count++] = seconds;
+    s->total += seconds;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const Series *s, double p) {
+    size_t index = (size_t)(p * (double)(s->count - 1) + 0.5);
+    return s->samples[index];
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * 当前进程的峰值 RSS。只在单语料进程中读取，见 run_isolated
+ */
+static long peak_rss_kb(void) {
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : -1;
+}
+
+static void set_number(JsonValue *obj, const char *key, double val) {
+    json_set_double(object_emplace(obj, key), val);
+}
+
+/**
+ * 写入一组计时结果：延迟单位为微秒；bytes 非 0 时附带 MB/s
+ */
+static void add_series(JsonValue *obj, const char *key, Series *s, size_t bytes) {
+    JsonValue *o = object_emplace(obj, key);
+    json_set_object(o);
+    qsort(s->samples, s->count, sizeof(double), compare_double);
+    set_number(o, "samples", (double)s->count);
+    if (bytes) set_number(o, "mb_per_s", (double)bytes * s->count / s->total / 1e6);
+    set_number(o, "mean_us", s->total / s->count * 1e6);
+    set_number(o, "p50_us", percentile(s, 0.50) * 1e6);
+    set_number(o, "p90_us", percentile(s, 0.90) * 1e6);
+    set_number(o, "p99_us", percentile(s, 0.99) * 1e6);
+    set_number(o, "max_us", s->samples[s->count - 1] * 1e6);
+}
+
+/**
+ * 以 MJSON_STATS 编译的库：附带首轮 json_parse/json_to_string 的内部统计
+ */
+static void add_stats(JsonValue *obj, const JsonStats *stats) {
+    static const char *const type_names[JSON_TYPE_COUNT] = {
+        "null", "bool", "int", "float", "double", "string", "array", "object",
+        "int_array", "int64_array", "float_array", "double_array", "int64"
+    };
+    JsonValue *o = object_emplace(obj, "stats");
+    json_set_object(o);
+    JsonValue *nodes = object_emplace(o, "nodes");
+    json_set_object(nodes);
+    for (int i = 0; i < JSON_TYPE_COUNT; i++) {
+        if (stats->parse.nodes[i]) set_number(nodes, type_names[i], (double)stats->parse.nodes[i]);
+    }
+    set_number(o, "max_depth", (double)stats->parse.max_depth);
+    set_number(o, "string_bytes", (double)stats->parse.string_bytes);
+    set_number(o, "escapes", (double)stats->parse.escapes);
+    set_number(o, "parse_reallocs", (double)stats->parse.reallocs);
+    set_number(o, "parse_ticks", (double)stats->parse.total_ticks);
+    set_number(o, "string_ticks", (double)stats->parse.string_ticks);
+    set_number(o, "number_ticks", (double)stats->parse.number_ticks);
+    set_number(o, "measure_ticks", (double)stats->serialize.measure_ticks);
+    set_number(o, "write_ticks", (double)stats->serialize.write_ticks);
+}
+
+// ============================= 统计与输出 end ================================
+
+/**
+ * 运行一个语料：每轮依次解析、查询、序列化、释放，直到累计时间达到 min_time
+ */
+static int run_corpus(const Corpus *corpus, double scale, double min_time, unsigned flags, JsonValue *results) {
+    Buf text = {0}, path_buf = {0};
+    corpus->generate(&text, scale, &path_buf);
+    const char *paths[LOOKUP_COUNT];
+    const char *p = path_buf.data;
+    for (int i = 0; i < LOOKUP_COUNT; i++, p += strlen(p) + 1) paths[i] = p;
+
+    Series parse = {0}, get = {0}, serialize = {0}, release = {0};
+    JsonAllocStats parse_stats = {0};
+    JsonStats call_stats = {0};
+    size_t get_allocs = 0, serialize_allocs = 0, out_len = 0;
+    int error = JSON_SUCCESS;
+    double elapsed = 0;
+    for (int iter = 0; iter < MAX_ITERATIONS && (iter < MIN_ITERATIONS || elapsed < min_time); iter++) {
+        double start = now_seconds();
+        JsonAllocStats stats = {0};
+        JsonParseOptions options = {NULL, &stats, flags};
+        double t0 = now_seconds();
+        JsonValue doc = json_parse_ex(text.data, &options, &error);
+        double t1 = now_seconds();
+        if (error != JSON_SUCCESS) break;
+        series_add(&parse, t1 - t0);
+        if (iter == 0) parse_stats = stats;
+
+        size_t before = g_alloc_count;
+        for (int i = 0; i < LOOKUP_COUNT; i += LOOKUP_BATCH) {
+            t0 = now_seconds();
+            for (int j = i; j < i + LOOKUP_BATCH; j++) {
+                if (!json_get(&doc, paths[j])) error = JSON_INVALID;
+            }
+            series_add(&get, (now_seconds() - t0) / LOOKUP_BATCH);
+        }
+        get_allocs += g_alloc_count - before;
+
+        before = g_alloc_count;
+        t0 = now_seconds();
+        char *out = json_to_string(&doc);
+        t1 = now_seconds();
+        serialize_allocs += g_alloc_count - before;
+        series_add(&serialize, t1 - t0);
+        out_len = out ? strlen(out) : 0;
+        json_get_allocator()->free_fn(json_get_allocator()->ctx, out);
+
+        t0 = now_seconds();
+        json_free(&doc);
+        series_add(&release, now_seconds() - t0);
+        if (iter == 0) json_stats_last(&call_stats);
+        if (error != JSON_SUCCESS || !out) break;
+        elapsed += now_seconds() - start;
+    }
+    if (error != JSON_SUCCESS || parse.count == 0) {
+        fprintf(stderr, "%s: benchmark failed (error %d)\n", corpus->name, error);
+        free(text.data);
+        free(path_buf.data);
+        return 0;
+    }
+
+    size_t iterations = parse.count;
+    JsonValue *r = array_emplace(results);
+    json_set_object(r);
+    json_set_string(object_emplace(r, "corpus"), corpus->name);
+    set_number(r, "bytes", (double)text.len);
+    set_number(r, "output_bytes", (double)out_len);
+    set_number(r, "iterations", (double)iterations);
+    add_series(r, "parse", &parse, text.len);
+    add_series(r, "get", &get, 0);
+    add_series(r, "to_string", &serialize, out_len);
+    add_series(r, "free", &release, 0);
+
+    JsonValue *allocs = object_emplace(r, "allocations");
+    json_set_object(allocs);
+    set_number(allocs, "parse_count", (double)(parse_stats.alloc_count + parse_stats.realloc_count));
+    set_number(allocs, "parse_reallocs", (double)parse_stats.realloc_count);
+    set_number(allocs, "parse_bytes", (double)parse_stats.alloc_bytes);
+    set_number(allocs, "parse_peak_bytes", (double)parse_stats.peak_bytes);
+    set_number(allocs, "get_count", (double)get_allocs / iterations);
+    set_number(allocs, "to_string_count", (double)serialize_allocs / iterations);
+    set_number(r, "peak_rss_kb", (double)peak_rss_kb());
+    if (json_stats_enabled()) add_stats(r, &call_stats);
+
+    fprintf(stderr, "%-14s %8.2f MB  parse %8.1f MB/s  to_string %8.1f MB/s  get p50 %7.3f us\n",
+            corpus->name, text.len / 1e6, text.len * parse.count / parse.total / 1e6,
+            out_len * serialize.count / serialize.total / 1e6, percentile(&get, 0.5) * 1e6);
+
+    free(parse.samples);
+    free(get.samples);
+    free(serialize.samples);
+    free(release.samples);
+    free(text.data);
+    free(path_buf.data);
+    return 1;
+}
+
+/**
+ * 重新执行自身（附加 --corpus）在子进程中单独运行一个语料，取回子进程报告中的结果，
+ * 使 peak_rss_kb 不受先前语料的影响
+ * @return 成功返回 1
+ */
+static int run_isolated(const char *self, const Corpus *corpus, double scale, double min_time, unsigned flags,
+                        JsonValue *results) {
+    char scale_arg[32], time_arg[32], flags_arg[32];
+    snprintf(scale_arg, sizeof(scale_arg), "%.17g", scale);
+    snprintf(time_arg, sizeof(time_arg), "%.17g", min_time);
+    snprintf(flags_arg, sizeof(flags_arg), "%u", flags);
+    char *const args[] = {(char *)self, "--scale", scale_arg, "--min-time", time_arg, "--flags", flags_arg,
+                          "--corpus", (char *)corpus->name, NULL};
+    int fds[2];
+    if (pipe(fds) != 0) return 0;
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return 0;
+    }
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execv("/proc/self/exe", args);
+        execvp(self, args);
+        _exit(127);
+    }
+    close(fds[1]);
+
+    Buf out = {0};
+    char chunk[4096];
+    ssize_t n;
+    while ((n = read(fds[0], chunk, sizeof(chunk))) > 0) buf_printf(&out, "%.*s", (int)n, chunk);
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || !out.data) {
+        free(out.data);
+        return 0;
+    }
+
+    int error;
+    JsonValue child = json_parse(out.data, &error);
+    free(out.data);
+    const JsonValue *result = error == JSON_SUCCESS ? json_get(&child, "results[0]") : NULL;
+    JsonValue copy = result ? json_clone(result, &error) : (JsonValue){0};
+    int ok = result && error == JSON_SUCCESS && array_append(results, &copy);
+    if (!ok) json_free(&copy);
+    json_free(&child);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    static const JsonAllocator counting = {count_malloc, count_realloc, count_free, NULL};
+    double scale = 1.0, min_time = 0.5;
+    unsigned flags = 0;
+    const char *only = NULL, *output = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--scale") == 0) scale = atof(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "--min-time") == 0) min_time = atof(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "--flags") == 0) flags = (unsigned)strtoul(argv[++i], NULL, 0);
+        else if (i + 1 < argc && strcmp(argv[i], "--corpus") == 0) only = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "--output") == 0) output = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--scale F] [--min-time S] [--flags N] [--corpus NAME] [--output FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (scale <= 0) scale = 1.0;
+
+    // 分配次数只统计被测调用前后的差值，报告本身的分配不计入
+    json_set_allocator(&counting);
+    JsonValue report = {.type = JSON_NULL};
+    json_set_object(&report);
+    set_number(&report, "scale", scale);
+    set_number(&report, "min_time_s", min_time);
+    set_number(&report, "parse_flags", flags);
+#ifdef __VERSION__
+    json_set_string(object_emplace(&report, "compiler"), __VERSION__);
+#endif
+    JsonValue *results = object_emplace(&report, "results");
+    json_set_array(results);
+
+    int ok = 1, matched = 0;
+    for (size_t i = 0; i < sizeof(corpora) / sizeof(corpora[0]); i++) {
+        if (only && strcmp(only, corpora[i].name) != 0) continue;
+        matched = 1;
+        g_seed = 12345;
+        if (only) ok &= run_corpus(&corpora[i], scale, min_time, flags, results);
+        else ok &= run_isolated(argv[0], &corpora[i], scale, min_time, flags, results);
+    }
+    if (!matched) {
+        fprintf(stderr, "unknown corpus: %s\n", only);
+        return 2;
+    }
+
+    char *text = json_to_string(&report);
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!text || !out) {
+        fprintf(stderr, "failed to write report\n");
+        return 1;
+    }
+    fprintf(out, "%s\n", text);
+    if (output) fclose(out);
+    counting.free_fn(counting.ctx, text);
+    json_free(&report);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+//
+// 冻结文档的多线程读取基准：同一份配置文档被 1..N 个线程同时用 json_get 查询，
+// 输出各线程数下的总吞吐与相对单线程的加速比，并检查读取期间没有发生内存分配
+//
+#include "mJson.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SERVICE_COUNT 256
+#define PATH_COUNT 1024
+#define MAX_THREADS 256
+
+static atomic_size_t g_alloc_count;
+
+static void *count_malloc(void *ctx, size_t size) {
+    (void)ctx;
+    atomic_fetch_add_explicit(&g_alloc_count, 1, memory_order_relaxed);
+    return malloc(size);
+}
+
+static void *count_realloc(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    atomic_fetch_add_explicit(&g_alloc_count, 1, memory_order_relaxed);
+    return realloc(ptr, size);
+}
+
+static void count_free(void *ctx, void *ptr) {
+    (void)ctx;
+    free(ptr);
+}
+
+typedef struct {
+    const JsonValue *doc;
+    char **paths;
+    size_t lookups;
+    size_t offset;
+    size_t found;
+} Worker;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * 生成配置文档：services 下 SERVICE_COUNT 个服务，每个服务含若干标量、数组和嵌套对象
+ */
+static char *build_config(void) {
+    size_t cap = SERVICE_COUNT * 512 + 64, len = 0;
+    char *json = malloc(cap);
+    if (!json) return NULL;
+    len += snprintf(json + len, cap - len, "{\"version\":3,\"services\":{");
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        len += snprintf(json + len, cap - len,
+                        "%s\"svc%03d\":{\"host\":\"10.0.%d.%d\",\"port\":%d,\"weight\":%.2f,"
+                        "\"enabled\":%s,\"tags\":[\"zone-%d\",\"tier-%d\"],"
+                        "\"limits\":{\"rps\":%d,\"burst\":%d,\"timeout_ms\":%d}}",
+                        i ? "," : "", i, i / 256, i % 256, 8000 + i, (i % 10) / 10.0,
+                        i % 3 ? "true" : "false", i % 4, i % 3, 1000 + i, 50 + i % 7, 250 + i);
+    }
+    snprintf(json + len, cap - len, "}}");
+    return json;
+}
+
+static void *worker_run(void *arg) {
+    Worker *w = arg;
+    size_t found = 0;
+    for (size_t i = 0; i < w->lookups; i++) {
+        if (json_get(w->doc, w->paths[(w->offset + i) % PATH_COUNT])) found++;
+    }
+    w->found = found;
+    return NULL;
+}
+
+/**
+ * 用 threads 个线程各执行 lookups 次查询
+ * @return 每秒查询次数，失败返回 0
+ */
+static double run_round(const JsonValue *doc, char **paths, unsigned threads, size_t lookups) {
+    pthread_t tids[MAX_THREADS];
+    Worker workers[MAX_THREADS];
+    double start = now_seconds();
+    for (unsigned t = 0; t < threads; t++) {
+        workers[t] = (Worker){doc, paths, lookups, t * 7919u, 0};
+        if (pthread_create(&tids[t], NULL, worker_run, &workers[t]) != 0) {
+            while (t > 0) pthread_join(tids[--t], NULL);
+            return 0;
+        }
+    }
+    size_t found = 0;
+    for (unsigned t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+        found += workers[t].found;
+    }
+    double elapsed = now_seconds() - start;
+    if (found != (size_t)threads * lookups) {
+        fprintf(stderr, "lookup miss: %zu of %zu\n", (size_t)threads * lookups - found, (size_t)threads * lookups);
+        return 0;
+    }
+    return threads * (double)lookups / elapsed;
+}
+
+int main(int argc, char **argv) {
+    static const JsonAllocator counting = {count_malloc, count_realloc, count_free, NULL};
+    static const char *fields[] = {"host", "port", "weight", "enabled", "tags[1]", "limits.rps", "limits.timeout_ms"};
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned max_threads = argc > 1 ? (unsigned)atoi(argv[1]) : (unsigned)(cpus > 0 ? cpus : 1);
+    size_t lookups = argc > 2 ? (size_t)atol(argv[2]) : 2000000;
+    if (max_threads < 1) max_threads = 1;
+    if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+
+    json_set_allocator(&counting);
+    char *json = build_config();
+    int error;
+    JsonValue doc = json ? json_parse(json, &error) : (JsonValue){0};
+    free(json);
+    if (!json || error != JSON_SUCCESS || !json_freeze(&doc)) {
+        fprintf(stderr, "failed to build config document\n");
+        return 1;
+    }
+
+    char *paths[PATH_COUNT];
+    for (int i = 0; i < PATH_COUNT; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), "services.svc%03d.%s", (i * 37) % SERVICE_COUNT,
+                 fields[i % (sizeof(fields) / sizeof(fields[0]))]);
+        paths[i] = strdup(path);
+    }
+
+    printf("%-8s %16s %10s\n", "threads", "lookups/s", "speedup");
+    size_t allocs_before = atomic_load(&g_alloc_count);
+    double base = 0;
+    for (unsigned threads = 1;; threads *= 2) {
+        if (threads > max_threads) threads = max_threads;
+        double rate = run_round(&doc, paths, threads, lookups);
+        if (rate == 0) return 1;
+        if (threads == 1) base = rate;
+        printf("%-8u %16.0f %9.2fx\n", threads, rate, rate / base);
+        if (threads == max_threads) break;
+    }
+    size_t read_allocs = atomic_load(&g_alloc_count) - allocs_before;
+    printf("allocations during reads: %zu\n", read_allocs);
+
+    for (int i = 0; i < PATH_COUNT; i++) free(paths[i]);
+    json_free(&doc);
+    return read_allocs == 0 ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+#include "mJson.hpp"
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct Address {
+    std::string street;
+    int number = 0;
+};
+MJSON_FIELDS(Address, street, number)
+
+struct Person {
+    std::string name;
+    int age = 0;
+    bool student = false;
+    double height = 0;
+    std::vector<std::string> skill;
+    Address address;
+    std::optional<std::string> nickname;
+};
+MJSON_FIELDS(Person, name, age, student, height, skill, address, nickname)
+
+int main() {
+    const char *json = "{"
+                       "\"name\": \"kevinfan\","
+                       "\"age\": 30,"
+                       "\"student\": false,"
+                       "\"height\": 175.23,"
+                       "\"skill\": [\"c\", \"c#\"],"
+                       "\"address\": {"
+                       "\"street\": \"baoan\","
+                       "\"number\": 60"
+                       "}"
+                       "}";
+
+    int error;
+    mjson::Document doc = mjson::Document::parse(json, &error);
+    if (error != JSON_SUCCESS) {
+        std::printf("Parse error: %d\n", error);
+        return 1;
+    }
+
+    // 只读视图与范围遍历
+    std::string_view name = doc["name"].as_string();
+    std::printf("name ->: %.*s\n", static_cast<int>(name.size()), name.data());
+    for (mjson::Value skill : doc["skill"].elements()) {
+        std::printf("skill ->: %s\n", std::string(skill.as_string()).c_str());
+    }
+    for (mjson::Member m : doc["address"].members()) {
+        std::printf("address.%s\n", std::string(m.key).c_str());
+    }
+
+    // 写时复制克隆后修改，原文档不变
+    mjson::Document copy = doc.clone();
+    copy.mut()["address"]["number"].set(61);
+    copy.mut()["skill"].append().set("c++");
+    std::printf("doc ->: %s\n", doc.to_string().c_str());
+    std::printf("copy ->: %s\n", copy.to_string().c_str());
+
+    // 结构体编解码
+    Person person;
+    if (mjson::decode(json, person) != JSON_SUCCESS) {
+        std::printf("Decode error\n");
+        return 1;
+    }
+    person.nickname = "kevin";
+    std::printf("person ->: %s\n", mjson::to_json(person).c_str());
+    return 0;
+}
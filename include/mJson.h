@@ -6,12 +6,17 @@
 #include <stddef.h>
 #include <float.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
 #include <math.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // 类型校验示例
 #define CHECK_TYPE(jv, expected) \
     do { if (!jv || jv->type != (expected)) return NULL; } while(0)
@@ -24,7 +29,13 @@ typedef enum {
     JSON_DOUBLE,
     JSON_STRING,
     JSON_ARRAY,
-    JSON_OBJECT
+    JSON_OBJECT,
+    // 紧凑数值数组：元素连续存储在 packed_value.data 中
+    JSON_INT_ARRAY,    // int32_t
+    JSON_INT64_ARRAY,  // int64_t
+    JSON_FLOAT_ARRAY,  // float
+    JSON_DOUBLE_ARRAY, // double
+    JSON_INT64         // 超出 int 范围的整数，由 int64 紧凑数组展开或 CBOR 解码产生
 } JsonType;
 
 typedef struct JsonValue JsonValue;
@@ -35,6 +46,7 @@ struct JsonValue {
     union {
         bool bool_value;
         int int_value;
+        int64_t int64_value;
         float float_value; // 32位单精度
         double double_value;  // 64位双精度
         char *string_value;
@@ -46,7 +58,12 @@ struct JsonValue {
             JsonPair *pairs;
             size_t pair_count;
         } object_value;
+        struct {
+            void *data;
+            size_t count;
+        } packed_value;
     } value;
+    void *owner;  // 内部使用：所在容器的存储块，根节点为 NULL；自行初始化时置 0
 };
 
 struct JsonPair {
@@ -54,6 +71,40 @@ struct JsonPair {
     JsonValue value;
 };
 
+// 内存分配器钩子：malloc/realloc/free 回调加用户上下文
+typedef struct {
+    void *(*malloc_fn)(void *ctx, size_t size);
+    void *(*realloc_fn)(void *ctx, void *ptr, size_t size);
+    void (*free_fn)(void *ctx, void *ptr);
+    void *ctx;
+} JsonAllocator;
+
+// 分配统计（按次调用累计）
+typedef struct {
+    size_t alloc_count;    // malloc 次数
+    size_t realloc_count;  // realloc 次数
+    size_t alloc_bytes;    // 累计申请字节数
+    size_t current_bytes;  // 当前存活字节数
+    size_t peak_bytes;     // 存活字节数峰值
+} JsonAllocStats;
+
+// 解析标志
+#define JSON_PARSE_SORT_KEYS  0x1u  // 对象键值对按键排序（相同键保持原始先后），查找使用二分查找
+#define JSON_PARSE_KEEP_ORDER 0x2u  // 与 SORT_KEYS 同用：键值对保持原始顺序，仅额外建立按键索引
+#define JSON_PARSE_PACK_NUMBERS 0x4u  // 元素全为数字的数组解析为 JSON_*_ARRAY 紧凑数组
+#define JSON_PARSE_HASH 0x8u          // 解析时为每个容器计算键序无关的结构哈希（json_hash/json_equal/json_diff 直接使用）
+
+// 解析选项
+typedef struct {
+    const JsonAllocator *allocator; // 本文档使用的分配器，NULL 表示使用全局分配器
+    JsonAllocStats *stats;          // 非 NULL 时记录本次解析的分配情况
+    unsigned int flags;             // JSON_PARSE_* 组合
+} JsonParseOptions;
+
+// 全局分配器，NULL 恢复为标准库 malloc/realloc/free；需在创建任何文档之前设置
+void json_set_allocator(const JsonAllocator *allocator);
+const JsonAllocator *json_get_allocator(void);
+
 // 2025年3月26日 新增  创建基础类型实例
 JsonValue* create_bool(bool val);
 JsonValue* create_int(int val);
@@ -66,16 +117,243 @@ JsonValue* create_object();
 int object_add_pair(JsonValue* obj, const char* key, JsonValue* value);
 char* json_to_string(const JsonValue* jv);
 
+// 插入、删除与修改
+JsonValue* array_get(JsonValue* arr, size_t index);
+JsonValue* array_get_mut(JsonValue* arr, size_t index);
+JsonValue* object_get_n(const JsonValue* obj, const char* key, size_t len);
+JsonValue* object_get_mut_n(JsonValue* obj, const char* key, size_t len);
+int array_insert_at(JsonValue* array, size_t index, JsonValue* element);
+int object_insert_at(JsonValue* obj, size_t index, const char* key, JsonValue* value);
+int object_insert_sorted(JsonValue* obj, const char* key, JsonValue* value);
+JsonValue* array_replace_at(JsonValue* array, size_t index, JsonValue* new_element);
+JsonValue* array_remove_at(JsonValue* array, size_t index);
+JsonValue* object_update(JsonValue* obj, const char* key, JsonValue* new_value);
+JsonValue* object_remove(JsonValue* obj, const char* key);
+
+// 有序对象：json_get、object_update、object_remove 使用二分查找，插入时维持键序
+int json_object_sort(JsonValue* obj, bool keep_order);
+bool json_object_is_sorted(const JsonValue* obj);
+
+// 紧凑数值数组：返回连续存储的指针与长度，类型不符时返回 NULL
+// 元素没有独立节点，json_get("a[1]")、array_get 对紧凑数组返回 NULL；按下标读取用下列接口，或先 json_array_unpack
+bool json_is_packed_array(const JsonValue* jv);
+size_t json_array_size(const JsonValue* jv);
+const int32_t* json_int_array(const JsonValue* jv, size_t* count);
+const int64_t* json_int64_array(const JsonValue* jv, size_t* count);
+const float* json_float_array(const JsonValue* jv, size_t* count);
+const double* json_double_array(const JsonValue* jv, size_t* count);
+int json_array_unpack(JsonValue* jv);
+
+// 批量插入：与 array_insert_at 相同，按位复制 elements[i] 指向的值，容器接管其中的字符串与子容器；
+// 源节点保持原样（不置为 JSON_NULL），之后不能再对其调用 json_free，节点本身的内存仍归调用方
+int batch_append(JsonValue* arr, JsonValue** elements, size_t num);
+int array_insert_batch(JsonValue* array, size_t index, JsonValue** elements, size_t num);
+
+// 批量构建：一次容量预留，值按位移入容器（转移所有权，原位置置为 JSON_NULL）
+int array_reserve(JsonValue* array, size_t capacity);
+int object_reserve(JsonValue* obj, size_t capacity);
+int array_append_move(JsonValue* array, JsonValue* values, size_t num);
+int object_add_pairs(JsonValue* obj, const char* const* keys, JsonValue* values, size_t num);
+int object_insert_sorted_batch(JsonValue* obj, const char* const* keys, JsonValue* values, size_t num);
+
+// 节点池构建器：节点从 slab 中分配，避免每个节点一次 malloc
+typedef struct JsonBuilder JsonBuilder;
+JsonBuilder* json_builder_create(void);
+void json_builder_destroy(JsonBuilder* builder);
+JsonValue* json_builder_node(JsonBuilder* builder);
+void json_builder_release(JsonBuilder* builder, JsonValue* node);
+int json_builder_append(JsonBuilder* builder, JsonValue* array, JsonValue* node);
+int json_builder_add_pair(JsonBuilder* builder, JsonValue* obj, const char* key, JsonValue* node);
+
+// 原地构造：直接在父容器中分配槽位，无中间节点与拷贝
+JsonValue* array_emplace(JsonValue* array);
+JsonValue* object_emplace(JsonValue* obj, const char* key);
+// 赋值接口成功返回 1；节点位于共享、冻结的存储块中（见 json_clone、json_freeze）或内存不足时返回 0
+int json_set_null(JsonValue* jv);
+int json_set_bool(JsonValue* jv, bool val);
+int json_set_int(JsonValue* jv, int val);
+int json_set_float(JsonValue* jv, float val);
+int json_set_double(JsonValue* jv, double val);
+int json_set_string(JsonValue* jv, const char* val);
+int json_set_string_n(JsonValue* jv, const char* val, size_t len);
+int json_set_array(JsonValue* jv);
+int json_set_object(JsonValue* jv);
+
+// 写时复制克隆：O(1) 共享全部子树，修改接口写入时只复制被修改的那一层；用 json_free 释放。
+// 共享期间 json_get/array_get 返回的节点只读，修改接口对其返回失败，需先用 json_get_mut 取得
+JsonValue json_clone(const JsonValue* src, int* error);
+
 // 解析接口
 JsonValue json_parse(const char *json, int *error);
 void json_free(JsonValue *value);
+// 按文档指定分配器解析：文档记住该分配器，之后的修改、克隆和 json_free 都使用它，分配器须在文档释放前保持有效
+JsonValue json_parse_ex(const char *json, const JsonParseOptions *options, int *error);
 
 // 查询接口
 JsonValue *json_get(const JsonValue *obj, const char *path);
+// 取得可修改的节点：沿路径复制与克隆共享的存储块
+JsonValue *json_get_mut(JsonValue *obj, const char *path);
 int json_insert(JsonValue** root, const char* path, JsonValue* new_item);
+
+// 补丁：原地修改，失败时回滚全部修改，返回错误码
+int json_patch_apply(JsonValue* doc, const JsonValue* patch);        // JSON Patch（RFC 6902）
+int json_merge_patch_apply(JsonValue* doc, const JsonValue* patch);  // JSON Merge Patch（RFC 7396）
+
+// 二进制编码（CBOR，紧凑数组使用 RFC 8746 类型化数组标签），保留 int/float/double 区分
+unsigned char* json_to_binary(const JsonValue* jv, size_t* out_len);
+JsonValue json_from_binary(const void* data, size_t len, int* error);
+// 单次分配解码：结果只读，整体用 json_free_flat 释放
+JsonValue* json_from_binary_flat(const void* data, size_t len, int* error);
+void json_free_flat(JsonValue* root);
+
+// 可映射快照：与地址无关的只读二进制文件，打开后直接查询，多进程共享页缓存
+typedef struct JsonSnapshot JsonSnapshot;
+typedef struct JsonSnapNode JsonSnapNode;
+int json_snapshot_write(const JsonValue* root, const char* path);
+JsonSnapshot* json_snapshot_open(const char* path, int* error);
+void json_snapshot_close(JsonSnapshot* snap);
+const JsonSnapNode* json_snapshot_root(const JsonSnapshot* snap);
+JsonType json_snap_type(const JsonSnapNode* node);
+bool json_snap_bool(const JsonSnapNode* node);
+int json_snap_int(const JsonSnapNode* node);
+int64_t json_snap_int64(const JsonSnapNode* node);
+float json_snap_float(const JsonSnapNode* node);
+double json_snap_double(const JsonSnapNode* node);
+const char* json_snap_string(const JsonSnapNode* node, size_t* len);
+size_t json_snap_size(const JsonSnapNode* node);
+const JsonSnapNode* json_snap_array_get(const JsonSnapNode* node, size_t index);
+const JsonSnapNode* json_snap_object_at(const JsonSnapNode* node, size_t index, const char** key);
+const JsonSnapNode* json_snap_find(const JsonSnapNode* node, const char* key);
+const JsonSnapNode* json_snap_get(const JsonSnapNode* node, const char* path);
+const void* json_snap_packed(const JsonSnapNode* node, size_t* count);
+
+// 结构哈希、比较与差异：数值不区分 int/float/double，对象比较与键序无关
+#define JSON_HASH_UNORDERED 0x1u  // 对象哈希与键值对顺序无关（结果缓存在容器上）
+uint64_t json_hash(const JsonValue* jv, unsigned int flags);
+bool json_equal(const JsonValue* a, const JsonValue* b);
+JsonValue json_diff(const JsonValue* from, const JsonValue* to, int* error);
+
+// JSONPath 查询：结果是指向文档内部的节点指针，不复制节点
+// 紧凑数组（JSON_PARSE_PACK_NUMBERS）的元素没有独立节点：[n]、[a:b]、*、[?()] 作用于紧凑数组时不选中任何元素，
+// 只能选中紧凑数组本身（再用 json_int_array 等取数据，或先 json_array_unpack）；过滤表达式中的 @.a[n] 可以读取紧凑数组元素
+typedef struct JsonQuery JsonQuery;
+typedef bool (*JsonQueryCallback)(const JsonValue* node, void* user);
+JsonQuery* json_query_compile(const char* expr, int* error);
+void json_query_free(JsonQuery* query);
+size_t json_query_each(const JsonQuery* query, const JsonValue* doc, JsonQueryCallback callback, void* user);
+size_t json_query_select(const JsonQuery* query, const JsonValue* doc, const JsonValue** results,
+                         size_t capacity, unsigned int threads);
+size_t json_query(const JsonValue* doc, const char* expr, const JsonValue** results, size_t capacity, int* error);
+
+// 结构体绑定：按字段表在结构体与 JSON 文本之间直接转换，不构建 JsonValue 树
+typedef enum {
+    JSON_FIELD_BOOL,    // bool
+    JSON_FIELD_INT,     // int
+    JSON_FIELD_INT64,   // int64_t
+    JSON_FIELD_FLOAT,   // float
+    JSON_FIELD_DOUBLE,  // double
+    JSON_FIELD_STRING,  // char*，解码时分配，json_struct_free 释放
+    JSON_FIELD_CHARS,   // char[N] 定长缓冲，超长时解码失败
+    JSON_FIELD_STRUCT,  // 嵌套结构体，由 desc 描述
+    JSON_FIELD_ARRAY    // 动态数组：元素指针成员 + size_t 计数成员，元素类型为 elem_type
+} JsonFieldType;
+
+typedef struct JsonStructDesc JsonStructDesc;
+
+typedef struct {
+    const char *name;            // JSON 键
+    JsonFieldType type;
+    size_t offset;               // 成员偏移
+    size_t size;                 // 成员大小（CHARS 的缓冲区大小）
+    const JsonStructDesc *desc;  // STRUCT 或元素为 STRUCT 的 ARRAY
+    JsonFieldType elem_type;     // ARRAY 的元素类型，不能是 ARRAY/CHARS
+    size_t count_offset;         // ARRAY 的计数成员偏移
+} JsonField;
+
+struct JsonStructDesc {
+    size_t size;
+    const JsonField *fields;
+    size_t field_count;
+};
+
+#define JSON_FIELD_OF(st, member, type) \
+    {#member, type, offsetof(st, member), sizeof(((st *)0)->member), NULL, JSON_FIELD_BOOL, 0}
+#define JSON_STRUCT_FIELD_OF(st, member, desc) \
+    {#member, JSON_FIELD_STRUCT, offsetof(st, member), sizeof(((st *)0)->member), &(desc), JSON_FIELD_BOOL, 0}
+#define JSON_ARRAY_FIELD_OF(st, member, count_member, elem_type, elem_desc) \
+    {#member, JSON_FIELD_ARRAY, offsetof(st, member), sizeof(((st *)0)->member), elem_desc, elem_type, offsetof(st, count_member)}
+#define JSON_STRUCT_DESC(st, fields) {sizeof(st), fields, sizeof(fields) / sizeof((fields)[0])}
+
+int json_decode_struct(const char* json, const JsonStructDesc* desc, void* out);
+char* json_encode_struct(const JsonStructDesc* desc, const void* obj);
+void json_struct_free(const JsonStructDesc* desc, void* obj);
+
+// 带缓存的序列化：容器保存上次输出的文本，修改接口使其失效，只重新生成变化的子树
+char* json_to_string_cached(const JsonValue* jv);
+void json_cache_clear(JsonValue* jv);
+
+// 冻结：文档变为只读，之后可被多个线程同时读取；json_get、array_get、object_get_n、json_hash、
+// json_to_buffer 等读取接口可重入且不分配内存。经 json_get、json_get_mut 等任何途径取得的节点上，
+// 修改接口（json_set_*、数组/对象增删改、排序、json_array_unpack、补丁）一律失败；标量根节点没有存储块，不受冻结影响
+int json_freeze(JsonValue* jv);
+bool json_is_frozen(const JsonValue* jv);
+// 序列化到调用方的缓冲区：返回所需长度（不含 NUL），size 大于该长度时才写入
+size_t json_to_buffer(const JsonValue* jv, char* buf, size_t size);
+
+// 并行序列化：大容器切块后多线程写入，输出与 json_to_string 逐字节相同；全局分配器须线程安全
+typedef struct {
+    unsigned int threads;  // 工作线程数，0 表示在线 CPU 数，1 表示不并行
+    size_t min_split;      // 子元素数达到该值的容器才切块，0 表示默认 4096
+} JsonSerializeOptions;
+char* json_to_string_parallel(const JsonValue* jv, const JsonSerializeOptions* options);
+// 并行序列化后用 writev 直接写入文件描述符（仅 POSIX）
+int json_write_fd(int fd, const JsonValue* jv, const JsonSerializeOptions* options);
+
+// 解析/序列化统计：以 -DMJSON_STATS（CMake 选项 MJSON_STATS）编译时由 json_parse/json_parse_ex 与 json_to_string 填写，
+// 未开启时不做任何统计，读取接口返回全 0。ticks 在 x86 上为 TSC 周期，其他平台为纳秒
+#define JSON_TYPE_COUNT (JSON_INT64 + 1)
+typedef struct {
+    size_t calls;
+    size_t bytes;                    // 消耗的输入字节数
+    size_t nodes[JSON_TYPE_COUNT];   // 按 JsonType 统计的节点数
+    size_t max_depth;                // 最大嵌套深度（顶层值为 1）
+    size_t string_bytes;             // 复制的字符串字节数（含键）
+    size_t escapes;                  // 解码的转义序列数
+    size_t reallocs;                 // realloc 次数（字符串缓冲与容器扩容）
+    uint64_t total_ns;
+    uint64_t total_ticks;
+    uint64_t string_ticks;           // 字符串与键解析
+    uint64_t number_ticks;           // 数字与紧凑数组解析
+} JsonParseStats;
+typedef struct {
+    size_t calls;
+    size_t bytes;                    // 输出字节数（不含 NUL）
+    uint64_t total_ns;
+    uint64_t total_ticks;
+    uint64_t measure_ticks;          // 计算输出长度
+    uint64_t write_ticks;            // 写入输出
+} JsonSerializeStats;
+typedef struct {
+    JsonParseStats parse;
+    JsonSerializeStats serialize;
+} JsonStats;
+bool json_stats_enabled(void);
+// 本线程最近一次解析与最近一次序列化的统计
+void json_stats_last(JsonStats* out);
+// 本线程自上次 json_stats_reset 以来的累计统计（max_depth 取最大值）
+void json_stats_thread(JsonStats* out);
+void json_stats_reset(void);
+
+// 只校验：按 RFC 8259 严格检查语法、转义、代理对与 UTF-8，不分配内存；err_offset 返回首个错误的字节偏移
+int json_validate(const char *json, size_t len, size_t *err_offset);
 // 错误码
 #define JSON_SUCCESS 0
 #define JSON_INVALID 1
 #define JSON_MEM_ERROR 2
+#define JSON_TOO_DEEP 3
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
@@ -0,0 +1,772 @@
+//
+// mJson C++17 封装：RAII 文档、只读/可写视图、范围遍历与编译期结构体编解码
+//
+#ifndef MJSON_HPP
+#define MJSON_HPP
+
+#include "mJson.h"
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mjson {
+
+enum class Type {
+    Null = JSON_NULL,
+    Bool = JSON_BOOL,
+    Int = JSON_INT,
+    Float = JSON_FLOAT,
+    Double = JSON_DOUBLE,
+    String = JSON_STRING,
+    Array = JSON_ARRAY,
+    Object = JSON_OBJECT,
+    IntArray = JSON_INT_ARRAY,
+    Int64Array = JSON_INT64_ARRAY,
+    FloatArray = JSON_FLOAT_ARRAY,
+    DoubleArray = JSON_DOUBLE_ARRAY,
+    Int64 = JSON_INT64
+};
+
+// 紧凑数组的只读视图
+template <class T>
+class ArrayView {
+public:
+    ArrayView() noexcept = default;
+    ArrayView(const T *data, std::size_t size) noexcept : data_(data), size_(size) {}
+    const T *begin() const noexcept { return data_; }
+    const T *end() const noexcept { return data_ + size_; }
+    const T *data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    const T &operator[](std::size_t i) const noexcept { return data_[i]; }
+
+private:
+    const T *data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+class Value;
+struct Member;
+
+// 数组元素迭代器，解引用得到 Value
+class ElementIterator {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = Value;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Value;
+
+    explicit ElementIterator(const JsonValue *pos = nullptr) noexcept : pos_(pos) {}
+    inline Value operator*() const noexcept;
+    ElementIterator &operator++() noexcept { ++pos_; return *this; }
+    ElementIterator operator++(int) noexcept { ElementIterator old = *this; ++pos_; return old; }
+    ElementIterator &operator--() noexcept { --pos_; return *this; }
+    ElementIterator &operator+=(difference_type n) noexcept { pos_ += n; return *this; }
+    ElementIterator operator+(difference_type n) const noexcept { return ElementIterator(pos_ + n); }
+    difference_type operator-(const ElementIterator &o) const noexcept { return pos_ - o.pos_; }
+    bool operator==(const ElementIterator &o) const noexcept { return pos_ == o.pos_; }
+    bool operator!=(const ElementIterator &o) const noexcept { return pos_ != o.pos_; }
+
+private:
+    const JsonValue *pos_;
+};
+
+// 对象成员迭代器，解引用得到 Member（键 + 值）
+class MemberIterator {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = Member;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Member;
+
+    explicit MemberIterator(const JsonPair *pos = nullptr) noexcept : pos_(pos) {}
+    inline Member operator*() const noexcept;
+    MemberIterator &operator++() noexcept { ++pos_; return *this; }
+    MemberIterator operator++(int) noexcept { MemberIterator old = *this; ++pos_; return old; }
+    MemberIterator &operator--() noexcept { --pos_; return *this; }
+    MemberIterator &operator+=(difference_type n) noexcept { pos_ += n; return *this; }
+    MemberIterator operator+(difference_type n) const noexcept { return MemberIterator(pos_ + n); }
+    difference_type operator-(const MemberIterator &o) const noexcept { return pos_ - o.pos_; }
+    bool operator==(const MemberIterator &o) const noexcept { return pos_ == o.pos_; }
+    bool operator!=(const MemberIterator &o) const noexcept { return pos_ != o.pos_; }
+
+private:
+    const JsonPair *pos_;
+};
+
+template <class Iterator>
+class Range {
+public:
+    Range(Iterator first, Iterator last) noexcept : first_(first), last_(last) {}
+    Iterator begin() const noexcept { return first_; }
+    Iterator end() const noexcept { return last_; }
+    std::size_t size() const noexcept { return static_cast<std::size_t>(last_ - first_); }
+    bool empty() const noexcept { return first_ == last_; }
+
+private:
+    Iterator first_, last_;
+};
+
+/**
+ * 只读视图：不持有内存，生命周期不超过所属文档
+ * 键或下标不存在时得到无效视图（valid() 为 false），取值返回默认值
+ * 紧凑数组没有逐个元素的节点，下标取得的视图内含该元素的副本，get() 指向视图自身
+ */
+class Value {
+public:
+    Value() noexcept = default;
+    explicit Value(const JsonValue *jv) noexcept : jv_(jv) {}
+    // 复制紧凑数组元素的视图时指向新视图中的副本
+    Value(const Value &other) noexcept : jv_(other.jv_), copy_(other.copy_) {
+        if (other.jv_ == &other.copy_) jv_ = &copy_;
+    }
+    Value &operator=(const Value &other) noexcept {
+        copy_ = other.copy_;
+        jv_ = other.jv_ == &other.copy_ ? &copy_ : other.jv_;
+        return *this;
+    }
+
+    bool valid() const noexcept { return jv_ != nullptr; }
+    explicit operator bool() const noexcept { return valid(); }
+    const JsonValue *get() const noexcept { return jv_; }
+
+    Type type() const noexcept { return jv_ ? static_cast<Type>(jv_->type) : Type::Null; }
+    bool is_null() const noexcept { return jv_ && jv_->type == JSON_NULL; }
+    bool is_bool() const noexcept { return jv_ && jv_->type == JSON_BOOL; }
+    bool is_number() const noexcept {
+        return jv_ && (jv_->type == JSON_INT || jv_->type == JSON_INT64 || jv_->type == JSON_FLOAT ||
+                       jv_->type == JSON_DOUBLE);
+    }
+    bool is_string() const noexcept { return jv_ && jv_->type == JSON_STRING; }
+    bool is_array() const noexcept { return jv_ && jv_->type == JSON_ARRAY; }
+    bool is_packed() const noexcept { return json_is_packed_array(jv_); }
+    bool is_object() const noexcept { return jv_ && jv_->type == JSON_OBJECT; }
+
+    bool as_bool(bool def = false) const noexcept { return is_bool() ? jv_->value.bool_value : def; }
+    int as_int(int def = 0) const noexcept { return jv_ && jv_->type == JSON_INT ? jv_->value.int_value : def; }
+    // 超出 int 范围的整数在文档中保存为 int64 或 double
+    std::int64_t as_int64(std::int64_t def = 0) const noexcept {
+        if (!jv_) return def;
+        if (jv_->type == JSON_INT) return jv_->value.int_value;
+        if (jv_->type == JSON_INT64) return jv_->value.int64_value;
+        if (jv_->type == JSON_DOUBLE && jv_->value.double_value >= -9223372036854775808.0 &&
+            jv_->value.double_value < 9223372036854775808.0 &&
+            static_cast<double>(static_cast<std::int64_t>(jv_->value.double_value)) == jv_->value.double_value) {
+            return static_cast<std::int64_t>(jv_->value.double_value);
+        }
+        return def;
+    }
+    double as_double(double def = 0) const noexcept {
+        if (!jv_) return def;
+        switch (jv_->type) {
+            case JSON_INT:    return jv_->value.int_value;
+            case JSON_INT64:  return static_cast<double>(jv_->value.int64_value);
+            case JSON_FLOAT:  return jv_->value.float_value;
+            case JSON_DOUBLE: return jv_->value.double_value;
+            default:          return def;
+        }
+    }
+    std::string_view as_string(std::string_view def = {}) const noexcept {
+        return is_string() ? std::string_view(jv_->value.string_value) : def;
+    }
+
+    // 数组、紧凑数组的元素个数或对象的成员个数
+    std::size_t size() const noexcept {
+        if (is_object()) return jv_->value.object_value.pair_count;
+        return json_array_size(jv_);
+    }
+    Value operator[](std::size_t index) const noexcept {
+        if (is_packed()) return index < jv_->value.packed_value.count ? packed_element(jv_, index) : Value();
+        return is_array() && index < jv_->value.array_value.ele_count
+               ? Value(&jv_->value.array_value.elements[index]) : Value();
+    }
+    Value operator[](std::string_view key) const noexcept {
+        return Value(jv_ ? object_get_n(jv_, key.data(), key.size()) : nullptr);
+    }
+    // json_get 路径语法，如 "a.b[2].c"
+    Value at_path(const char *path) const noexcept { return Value(json_get(jv_, path)); }
+
+    template <class T>
+    ArrayView<T> packed() const noexcept {
+        std::size_t count = 0;
+        const T *data = nullptr;
+        if constexpr (std::is_same_v<T, std::int32_t>) data = json_int_array(jv_, &count);
+        else if constexpr (std::is_same_v<T, std::int64_t>) data = json_int64_array(jv_, &count);
+        else if constexpr (std::is_same_v<T, float>) data = json_float_array(jv_, &count);
+        else if constexpr (std::is_same_v<T, double>) data = json_double_array(jv_, &count);
+        else static_assert(sizeof(T) == 0, "packed<T>: T must be int32_t, int64_t, float or double");
+        return ArrayView<T>(data, count);
+    }
+
+    Range<ElementIterator> elements() const noexcept {
+        if (!is_array()) return {ElementIterator(), ElementIterator()};
+        const JsonValue *first = jv_->value.array_value.elements;
+        return {ElementIterator(first), ElementIterator(first + jv_->value.array_value.ele_count)};
+    }
+    Range<MemberIterator> members() const noexcept {
+        if (!is_object()) return {MemberIterator(), MemberIterator()};
+        const JsonPair *first = jv_->value.object_value.pairs;
+        return {MemberIterator(first), MemberIterator(first + jv_->value.object_value.pair_count)};
+    }
+
+private:
+    // 紧凑数组元素转为数值节点，与 json_array_unpack 展开的结果相同
+    static Value packed_element(const JsonValue *jv, std::size_t index) noexcept {
+        Value v;
+        v.jv_ = &v.copy_;
+        const void *data = jv->value.packed_value.data;
+        switch (jv->type) {
+            case JSON_INT_ARRAY:
+                v.copy_.type = JSON_INT;
+                v.copy_.value.int_value = static_cast<const std::int32_t *>(data)[index];
+                break;
+            case JSON_INT64_ARRAY: {
+                std::int64_t val = static_cast<const std::int64_t *>(data)[index];
+                if (val >= std::numeric_limits<int>::min() && val <= std::numeric_limits<int>::max()) {
+                    v.copy_.type = JSON_INT;
+                    v.copy_.value.int_value = static_cast<int>(val);
+                } else {
+                    v.copy_.type = JSON_INT64;
+                    v.copy_.value.int64_value = val;
+                }
+                break;
+            }
+            case JSON_FLOAT_ARRAY:
+                v.copy_.type = JSON_FLOAT;
+                v.copy_.value.float_value = static_cast<const float *>(data)[index];
+                break;
+            default:
+                v.copy_.type = JSON_DOUBLE;
+                v.copy_.value.double_value = static_cast<const double *>(data)[index];
+                break;
+        }
+        return v;
+    }
+
+    const JsonValue *jv_ = nullptr;
+    JsonValue copy_{};
+};
+
+struct Member {
+    std::string_view key;
+    Value value;
+};
+
+inline Value ElementIterator::operator*() const noexcept { return Value(pos_); }
+inline Member MemberIterator::operator*() const noexcept { return Member{pos_->key, Value(&pos_->value)}; }
+
+class Document;
+
+/**
+ * 可写视图：经过写时复制，修改不会影响共享同一子树的克隆
+ * 与 C 接口相同，append/add 返回的视图在下一次修改同一容器前有效；
+ * set 系列在视图无效、文档已冻结或内存不足时返回 false
+ */
+class MutValue {
+public:
+    MutValue() noexcept = default;
+    explicit MutValue(JsonValue *jv) noexcept : jv_(jv) {}
+
+    bool valid() const noexcept { return jv_ != nullptr; }
+    explicit operator bool() const noexcept { return valid(); }
+    JsonValue *get() const noexcept { return jv_; }
+    Value view() const noexcept { return Value(jv_); }
+    operator Value() const noexcept { return view(); }
+
+    bool set_null() noexcept { return jv_ && json_set_null(jv_); }
+    bool set(bool val) noexcept { return jv_ && json_set_bool(jv_, val); }
+    bool set(int val) noexcept { return jv_ && json_set_int(jv_, val); }
+    bool set(float val) noexcept { return jv_ && json_set_float(jv_, val); }
+    bool set(double val) noexcept { return jv_ && json_set_double(jv_, val); }
+    bool set(std::string_view val) noexcept { return jv_ && json_set_string_n(jv_, val.data(), val.size()); }
+    bool set(const char *val) noexcept { return set(std::string_view(val)); }
+    bool set_array() noexcept { return jv_ && json_set_array(jv_); }
+    bool set_object() noexcept { return jv_ && json_set_object(jv_); }
+
+    // 原地构造新元素/键值对（值为 null），再通过返回的视图赋值
+    MutValue append() noexcept { return MutValue(jv_ ? array_emplace(jv_) : nullptr); }
+    MutValue add(const char *key) noexcept { return MutValue(jv_ ? object_emplace(jv_, key) : nullptr); }
+    // 移入整个文档，成功后 doc 变为 null
+    inline bool append(Document &&doc) noexcept;
+    inline bool add(const char *key, Document &&doc) noexcept;
+
+    bool remove(std::size_t index) noexcept {
+        JsonValue *removed = jv_ ? array_remove_at(jv_, index) : nullptr;
+        if (removed) json_free(removed);
+        return removed != nullptr;
+    }
+    bool remove(const char *key) noexcept {
+        JsonValue *removed = jv_ ? object_remove(jv_, key) : nullptr;
+        if (removed) json_free(removed);
+        return removed != nullptr;
+    }
+
+    MutValue operator[](std::size_t index) const noexcept {
+        return MutValue(jv_ ? array_get_mut(jv_, index) : nullptr);
+    }
+    MutValue operator[](std::string_view key) const noexcept {
+        return MutValue(jv_ ? object_get_mut_n(jv_, key.data(), key.size()) : nullptr);
+    }
+    MutValue at_path(const char *path) const noexcept { return MutValue(json_get_mut(jv_, path)); }
+
+private:
+    JsonValue *jv_ = nullptr;
+};
+
+/**
+ * 文档：独占一棵 JsonValue 树，析构时释放；只能移动，复制须显式调用 clone()
+ */
+class Document {
+public:
+    Document() noexcept : root_(null_value()) {}
+    // 接管 C 接口得到的值，source 被置为 null；文档记录了自己的分配器（json_parse_ex），释放时无需再指定
+    explicit Document(JsonValue &&source) noexcept : root_(source) {
+        source = null_value();
+    }
+    ~Document() { reset(); }
+
+    Document(const Document &) = delete;
+    Document &operator=(const Document &) = delete;
+    Document(Document &&other) noexcept : root_(other.root_) {
+        other.root_ = null_value();
+    }
+    Document &operator=(Document &&other) noexcept {
+        if (this != &other) {
+            reset();
+            root_ = other.root_;
+            other.root_ = null_value();
+        }
+        return *this;
+    }
+
+    static Document parse(const char *json, int *error = nullptr, const JsonParseOptions *options = nullptr) {
+        int err = JSON_SUCCESS;
+        JsonValue value = json_parse_ex(json, options, &err);
+        if (error) *error = err;
+        if (err) return Document();
+        return Document(std::move(value));
+    }
+    static Document parse(const std::string &json, int *error = nullptr, const JsonParseOptions *options = nullptr) {
+        return parse(json.c_str(), error, options);
+    }
+
+    static Document of(bool val) noexcept { Document d; json_set_bool(&d.root_, val); return d; }
+    static Document of(int val) noexcept { Document d; json_set_int(&d.root_, val); return d; }
+    static Document of(float val) noexcept { Document d; json_set_float(&d.root_, val); return d; }
+    static Document of(double val) noexcept { Document d; json_set_double(&d.root_, val); return d; }
+    static Document of(std::string_view val) noexcept {
+        Document d;
+        json_set_string_n(&d.root_, val.data(), val.size());
+        return d;
+    }
+    static Document array() noexcept { Document d; json_set_array(&d.root_); return d; }
+    static Document object() noexcept { Document d; json_set_object(&d.root_); return d; }
+
+    // 写时复制克隆，O(1)；克隆沿用源文档的分配器
+    Document clone(int *error = nullptr) const {
+        int err = JSON_SUCCESS;
+        JsonValue value = json_clone(&root_, &err);
+        if (error) *error = err;
+        return err ? Document() : Document(std::move(value));
+    }
+
+    // 冻结为只读，之后 const 访问可跨线程共享；mut() 的修改一律失败
+    bool freeze() noexcept { return json_freeze(&root_) != 0; }
+    bool frozen() const noexcept { return json_is_frozen(&root_); }
+
+    Value root() const noexcept { return Value(&root_); }
+    MutValue mut() noexcept { return MutValue(&root_); }
+    Value operator[](std::string_view key) const noexcept { return root()[key]; }
+    Value operator[](std::size_t index) const noexcept { return root()[index]; }
+    const JsonValue *get() const noexcept { return &root_; }
+
+    std::string to_string() const {
+        char *text = json_to_string(&root_);
+        if (!text) return std::string();
+        std::string result(text);
+        const JsonAllocator *a = json_get_allocator();
+        a->free_fn(a->ctx, text);
+        return result;
+    }
+
+    // 交还所有权给 C 接口，之后由调用方释放
+    JsonValue release() noexcept {
+        JsonValue value = root_;
+        root_ = null_value();
+        return value;
+    }
+
+private:
+    friend class MutValue;
+
+    static JsonValue null_value() noexcept {
+        JsonValue value{};
+        value.type = JSON_NULL;
+        return value;
+    }
+    void reset() noexcept {
+        json_free(&root_);
+        root_ = null_value();
+    }
+
+    JsonValue root_;
+};
+
+inline bool MutValue::append(Document &&doc) noexcept {
+    if (!jv_ || !array_append(jv_, &doc.root_)) return false;
+    doc.root_ = Document::null_value();
+    return true;
+}
+
+inline bool MutValue::add(const char *key, Document &&doc) noexcept {
+    if (!jv_ || !object_add_pair(jv_, key, &doc.root_)) return false;
+    doc.root_ = Document::null_value();
+    return true;
+}
+
+// ============================= 结构体编解码 ================================
+
+namespace detail {
+
+template <class C, class M>
+struct Field {
+    const char *name;
+    std::size_t length;
+    M C::*member;
+};
+
+template <class C, class M, std::size_t N>
+constexpr Field<C, M> field(const char (&name)[N], M C::*member) noexcept {
+    return Field<C, M>{name, N - 1, member};
+}
+
+template <class T, class = void>
+struct has_fields : std::false_type {};
+template <class T>
+struct has_fields<T, std::void_t<decltype(mjson_fields(static_cast<const T *>(nullptr)))>> : std::true_type {};
+
+// 编译期按键排序的字段表：解码时二分查找成员的键，再按字段序号分派
+template <std::size_t N>
+struct KeyTable {
+    std::string_view names[N];
+    std::size_t fields[N];
+};
+
+template <class Fields, std::size_t... I>
+constexpr KeyTable<sizeof...(I)> make_key_table(const Fields &fields, std::index_sequence<I...>) {
+    constexpr std::size_t count = sizeof...(I);
+    KeyTable<count> table{{std::string_view(std::get<I>(fields).name, std::get<I>(fields).length)...}, {I...}};
+    for (std::size_t i = 1; i < count; i++) {
+        for (std::size_t j = i; j > 0 && table.names[j] < table.names[j - 1]; j--) {
+            std::string_view name = table.names[j];
+            table.names[j] = table.names[j - 1];
+            table.names[j - 1] = name;
+            std::size_t field = table.fields[j];
+            table.fields[j] = table.fields[j - 1];
+            table.fields[j - 1] = field;
+        }
+    }
+    return table;
+}
+
+template <std::size_t N>
+std::size_t find_field(const KeyTable<N> &table, std::string_view key) noexcept {
+    std::size_t lo = 0, hi = N;
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        if (table.names[mid] < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < N && table.names[lo] == key ? table.fields[lo] : N;
+}
+
+template <class T>
+struct FieldTable {
+    static constexpr auto fields = mjson_fields(static_cast<const T *>(nullptr));
+    static constexpr std::size_t count = std::tuple_size_v<std::remove_const_t<decltype(fields)>>;
+    static constexpr auto keys = make_key_table(fields, std::make_index_sequence<count>());
+};
+
+template <class T> struct is_vector : std::false_type {};
+template <class T, class A> struct is_vector<std::vector<T, A>> : std::true_type {};
+template <class T> struct is_optional : std::false_type {};
+template <class T> struct is_optional<std::optional<T>> : std::true_type {};
+template <class T> struct dependent_false : std::false_type {};
+
+inline void write_string(std::string &out, std::string_view s) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    std::size_t plain = 0;
+    for (std::size_t i = 0; i < s.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        out.append(s.data() + plain, i - plain);
+        plain = i + 1;
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            default:
+                out += "\\u00";
+                out += hex[c >> 4];
+                out += hex[c & 0xF];
+        }
+    }
+    out.append(s.data() + plain, s.size() - plain);
+    out += '"';
+}
+
+template <class T>
+void write_value(std::string &out, const T &val) {
+    if constexpr (std::is_same_v<T, bool>) {
+        out += val ? "true" : "false";
+    } else if constexpr (std::is_integral_v<T>) {
+        char buf[24];
+        auto result = std::to_chars(buf, buf + sizeof(buf), val);
+        out.append(buf, result.ptr);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        // 与 json_to_string 的数值格式一致
+        char buf[32];
+        int len = std::snprintf(buf, sizeof(buf), std::is_same_v<T, float> ? "%.6g" : "%.14g",
+                                static_cast<double>(val));
+        out.append(buf, static_cast<std::size_t>(len));
+    } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+        write_string(out, std::string_view(val));
+    } else if constexpr (is_optional<T>::value) {
+        if (val) write_value(out, *val);
+        else out += "null";
+    } else if constexpr (is_vector<T>::value) {
+        out += '[';
+        for (std::size_t i = 0; i < val.size(); i++) {
+            if (i > 0) out += ',';
+            write_value(out, val[i]);
+        }
+        out += ']';
+    } else if constexpr (has_fields<T>::value) {
+        constexpr auto &fields = FieldTable<T>::fields;
+        out += '{';
+        bool first = true;
+        std::apply([&](const auto &...f) {
+            ((out += first ? "\"" : ",\"", first = false,
+              out.append(f.name, f.length), out += "\":", write_value(out, val.*(f.member))), ...);
+        }, fields);
+        out += '}';
+    } else {
+        static_assert(dependent_false<T>::value, "mjson: type has no JSON mapping; declare it with MJSON_FIELDS");
+    }
+}
+
+template <class T>
+bool read_value(Value v, T &out);
+
+template <class T, std::size_t I>
+bool read_field(Value v, T &out) {
+    return read_value(v, out.*(std::get<I>(FieldTable<T>::fields).member));
+}
+
+// 按字段序号索引的读取函数表
+template <class T, std::size_t... I>
+constexpr std::array<bool (*)(Value, T &), sizeof...(I)> make_readers(std::index_sequence<I...>) {
+    return {{&read_field<T, I>...}};
+}
+
+template <class T>
+bool read_number(Value v, T &out) {
+    if constexpr (std::is_floating_point_v<T>) {
+        if (!v.is_number()) return false;
+        if constexpr (!std::is_same_v<T, float>) {
+            // 单精度值按最短十进制表示还原，避免 175.23f 变成 175.22999572754
+            if (v.type() == Type::Float) {
+                float f = v.get()->value.float_value;
+                char buf[32];
+                for (int digits = 6; digits <= 9; digits++) {
+                    std::snprintf(buf, sizeof(buf), "%.*g", digits, static_cast<double>(f));
+                    if (std::strtof(buf, nullptr) == f) break;
+                }
+                out = static_cast<T>(std::strtod(buf, nullptr));
+                return true;
+            }
+        }
+        out = static_cast<T>(v.as_double());
+        return true;
+    } else {
+        if (!v.is_number()) return false;
+        double d = v.as_double();
+        if (v.type() == Type::Int || v.type() == Type::Int64) {
+            std::int64_t i = v.as_int64();
+            if constexpr (std::is_unsigned_v<T>) {
+                if (i < 0) return false;
+            }
+            if (static_cast<long long>(i) < static_cast<long long>(std::numeric_limits<T>::min()) ||
+                static_cast<unsigned long long>(i < 0 ? 0 : i) > static_cast<unsigned long long>(std::numeric_limits<T>::max())) {
+                return false;
+            }
+            out = static_cast<T>(i);
+            return true;
+        }
+        // 其他来源的大整数以 double 保存
+        if (d != static_cast<double>(static_cast<long long>(d)) ||
+            d < static_cast<double>(std::numeric_limits<T>::min()) ||
+            d >= static_cast<double>(std::numeric_limits<T>::max()) + 1.0) {
+            return false;
+        }
+        out = static_cast<T>(d);
+        return true;
+    }
+}
+
+template <class T>
+bool read_value(Value v, T &out) {
+    if constexpr (std::is_same_v<T, bool>) {
+        if (!v.is_bool()) return false;
+        out = v.as_bool();
+        return true;
+    } else if constexpr (std::is_arithmetic_v<T>) {
+        return read_number(v, out);
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        if (!v.is_string()) return false;
+        out.assign(v.as_string());
+        return true;
+    } else if constexpr (is_optional<T>::value) {
+        if (v.is_null()) {
+            out.reset();
+            return true;
+        }
+        return read_value(v, out.emplace());
+    } else if constexpr (is_vector<T>::value) {
+        std::size_t count = v.size();
+        if (v.is_packed()) {
+            // 元素类型与紧凑存储完全一致时整体复制，其余逐个按普通数组的规则检查范围与小数
+            using E = typename T::value_type;
+            auto copy = [&out](auto view) {
+                out.assign(view.begin(), view.end());
+                return true;
+            };
+            if constexpr (std::is_same_v<E, std::int32_t>) {
+                if (v.type() == Type::IntArray) return copy(v.packed<E>());
+            } else if constexpr (std::is_same_v<E, std::int64_t>) {
+                if (v.type() == Type::Int64Array) return copy(v.packed<E>());
+            } else if constexpr (std::is_same_v<E, float>) {
+                if (v.type() == Type::FloatArray) return copy(v.packed<E>());
+            } else if constexpr (std::is_same_v<E, double>) {
+                if (v.type() == Type::DoubleArray) return copy(v.packed<E>());
+            }
+            out.clear();
+            out.reserve(count);
+            for (std::size_t i = 0; i < count; i++) {
+                if (!read_value(v[i], out.emplace_back())) return false;
+            }
+            return true;
+        }
+        if (!v.is_array()) return false;
+        out.clear();
+        out.reserve(count);
+        for (Value element : v.elements()) {
+            if (!read_value(element, out.emplace_back())) return false;
+        }
+        return true;
+    } else if constexpr (has_fields<T>::value) {
+        if (!v.is_object()) return false;
+        using Table = FieldTable<T>;
+        static constexpr auto readers = make_readers<T>(std::make_index_sequence<Table::count>());
+        // 逐个成员二分查找字段，未知键忽略，缺少的字段保持原值
+        for (Member m : v.members()) {
+            std::size_t field = find_field(Table::keys, m.key);
+            if (field < Table::count && !readers[field](m.value, out)) return false;
+        }
+        return true;
+    } else {
+        static_assert(dependent_false<T>::value, "mjson: type has no JSON mapping; declare it with MJSON_FIELDS");
+    }
+}
+
+} // namespace detail
+
+// 结构体编码为 JSON 文本，不构建中间文档
+template <class T>
+std::string to_json(const T &val) {
+    std::string out;
+    detail::write_value(out, val);
+    return out;
+}
+
+template <class T>
+bool from_json(Value v, T &out) {
+    return detail::read_value(v, out);
+}
+
+// 解析文本并填充结构体，返回错误码；类型不符时返回 JSON_INVALID
+template <class T>
+int decode(const char *json, T &out) {
+    int error = JSON_SUCCESS;
+    Document doc = Document::parse(json, &error);
+    if (error) return error;
+    return from_json(doc.root(), out) ? JSON_SUCCESS : JSON_INVALID;
+}
+
+} // namespace mjson
+
+// 字段列表宏：在结构体所在命名空间中使用，如 MJSON_FIELDS(Point, x, y)，最多 32 个字段
+#define MJSON_EXPAND_(x) x
+#define MJSON_FIELD_ENTRY_(T, member) ::mjson::detail::field(#member, &T::member)
+#define MJSON_FE_1_(m, T, a) m(T, a)
+#define MJSON_FE_2_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_1_(m, T, __VA_ARGS__))
+#define MJSON_FE_3_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_2_(m, T, __VA_ARGS__))
+#define MJSON_FE_4_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_3_(m, T, __VA_ARGS__))
+#define MJSON_FE_5_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_4_(m, T, __VA_ARGS__))
+#define MJSON_FE_6_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_5_(m, T, __VA_ARGS__))
+#define MJSON_FE_7_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_6_(m, T, __VA_ARGS__))
+#define MJSON_FE_8_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_7_(m, T, __VA_ARGS__))
+#define MJSON_FE_9_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_8_(m, T, __VA_ARGS__))
+#define MJSON_FE_10_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_9_(m, T, __VA_ARGS__))
+#define MJSON_FE_11_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_10_(m, T, __VA_ARGS__))
+#define MJSON_FE_12_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_11_(m, T, __VA_ARGS__))
+#define MJSON_FE_13_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_12_(m, T, __VA_ARGS__))
+#define MJSON_FE_14_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_13_(m, T, __VA_ARGS__))
+#define MJSON_FE_15_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_14_(m, T, __VA_ARGS__))
+#define MJSON_FE_16_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_15_(m, T, __VA_ARGS__))
+#define MJSON_FE_17_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_16_(m, T, __VA_ARGS__))
+#define MJSON_FE_18_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_17_(m, T, __VA_ARGS__))
+#define MJSON_FE_19_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_18_(m, T, __VA_ARGS__))
+#define MJSON_FE_20_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_19_(m, T, __VA_ARGS__))
+#define MJSON_FE_21_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_20_(m, T, __VA_ARGS__))
+#define MJSON_FE_22_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_21_(m, T, __VA_ARGS__))
+#define MJSON_FE_23_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_22_(m, T, __VA_ARGS__))
+#define MJSON_FE_24_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_23_(m, T, __VA_ARGS__))
+#define MJSON_FE_25_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_24_(m, T, __VA_ARGS__))
+#define MJSON_FE_26_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_25_(m, T, __VA_ARGS__))
+#define MJSON_FE_27_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_26_(m, T, __VA_ARGS__))
+#define MJSON_FE_28_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_27_(m, T, __VA_ARGS__))
+#define MJSON_FE_29_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_28_(m, T, __VA_ARGS__))
+#define MJSON_FE_30_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_29_(m, T, __VA_ARGS__))
+#define MJSON_FE_31_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_30_(m, T, __VA_ARGS__))
+#define MJSON_FE_32_(m, T, a, ...) m(T, a), MJSON_EXPAND_(MJSON_FE_31_(m, T, __VA_ARGS__))
+#define MJSON_GET_FE_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, NAME, ...) NAME
+#define MJSON_FOR_EACH_(m, T, ...) \
+    MJSON_EXPAND_(MJSON_GET_FE_(__VA_ARGS__, MJSON_FE_32_, MJSON_FE_31_, MJSON_FE_30_, MJSON_FE_29_, MJSON_FE_28_, MJSON_FE_27_, MJSON_FE_26_, MJSON_FE_25_, MJSON_FE_24_, MJSON_FE_23_, MJSON_FE_22_, MJSON_FE_21_, MJSON_FE_20_, MJSON_FE_19_, MJSON_FE_18_, MJSON_FE_17_, MJSON_FE_16_, MJSON_FE_15_, MJSON_FE_14_, MJSON_FE_13_, MJSON_FE_12_, MJSON_FE_11_, MJSON_FE_10_, MJSON_FE_9_, MJSON_FE_8_, MJSON_FE_7_, MJSON_FE_6_, MJSON_FE_5_, MJSON_FE_4_, MJSON_FE_3_, MJSON_FE_2_, MJSON_FE_1_)(m, T, __VA_ARGS__))
+
+#define MJSON_FIELDS(T, ...) \
+    [[maybe_unused]] inline constexpr auto mjson_fields(const T *) { \
+        return std::make_tuple(MJSON_FOR_EACH_(MJSON_FIELD_ENTRY_, T, __VA_ARGS__)); \
+    }
+
+#endif // MJSON_HPP
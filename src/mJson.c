@@ -2,13 +2,748 @@
 // Created by fanmin on 2025-03-25.
 //
 #include "mJson.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <pthread.h>
+#define MJSON_HAVE_PTHREAD 1
+#endif
 
 typedef struct {
     const char *start;
     const char *pos;
     char *error;
+    const JsonAllocator *allocator;
+    void *owner;  // 解析出的节点在移入容器前的 owner（root_owner(allocator)）
+    JsonAllocStats *stats;
+    unsigned int flags;
+#ifdef MJSON_STATS
+    JsonParseStats *pstats;  // 非 NULL 时记录本次解析的统计（json_parse_ex），内部复用的解析不计
+    size_t depth;
+#endif
 } ParserContext;
 
+// ============================= 内存分配器 start ================================
+
+static void *default_malloc(void *ctx, size_t size) {
+    (void)ctx;
+    return malloc(size);
+}
+
+static void *default_realloc(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    return realloc(ptr, size);
+}
+
+static void default_free(void *ctx, void *ptr) {
+    (void)ctx;
+    free(ptr);
+}
+
+static const JsonAllocator default_allocator = {default_malloc, default_realloc, default_free, NULL};
+static JsonAllocator g_allocator = {default_malloc, default_realloc, default_free, NULL};
+
+/**
+ * 设置全局分配器
+ * @param allocator NULL 表示恢复默认
+ */
+void json_set_allocator(const JsonAllocator *allocator) {
+    if (!allocator || !allocator->malloc_fn || !allocator->realloc_fn || !allocator->free_fn) {
+        g_allocator = default_allocator;
+        return;
+    }
+    g_allocator = *allocator;
+}
+
+const JsonAllocator *json_get_allocator(void) {
+    return &g_allocator;
+}
+
+static const JsonAllocator *resolve_allocator(const JsonAllocator *allocator) {
+    return allocator ? allocator : &g_allocator;
+}
+
+static void stats_grow(JsonAllocStats *stats, size_t size) {
+    stats->alloc_bytes += size;
+    stats->current_bytes += size;
+    if (stats->current_bytes > stats->peak_bytes) stats->peak_bytes = stats->current_bytes;
+}
+
+static void stats_shrink(JsonAllocStats *stats, size_t size) {
+    stats->current_bytes = stats->current_bytes > size ? stats->current_bytes - size : 0;
+}
+
+static void *mem_malloc(const JsonAllocator *a, JsonAllocStats *stats, size_t size) {
+    void *ptr = a->malloc_fn(a->ctx, size);
+    if (ptr && stats) {
+        stats->alloc_count++;
+        stats_grow(stats, size);
+    }
+    return ptr;
+}
+
+/**
+ * 重新分配，old_size 仅用于统计
+ */
+static void *mem_realloc(const JsonAllocator *a, JsonAllocStats *stats, void *ptr, size_t old_size, size_t size) {
+    void *new_ptr = a->realloc_fn(a->ctx, ptr, size);
+    if (new_ptr && stats) {
+        stats->realloc_count++;
+        if (size > old_size) stats_grow(stats, size - old_size);
+        else stats_shrink(stats, old_size - size);
+    }
+    return new_ptr;
+}
+
+/**
+ * 释放内存，size 未知时传 0
+ */
+static void mem_free(const JsonAllocator *a, JsonAllocStats *stats, void *ptr, size_t size) {
+    if (!ptr) return;
+    a->free_fn(a->ctx, ptr);
+    if (stats) stats_shrink(stats, size);
+}
+
+static char *mem_strdup(const JsonAllocator *a, JsonAllocStats *stats, const char *str) {
+    size_t len = strlen(str) + 1;
+    char *copy = mem_malloc(a, stats, len);
+    if (copy) memcpy(copy, str, len);
+    return copy;
+}
+
+/**
+ * 释放字符串：文档中的字符串与键都按 strlen + 1 分配
+ */
+static void mem_free_string(const JsonAllocator *a, JsonAllocStats *stats, char *str) {
+    if (str) mem_free(a, stats, str, strlen(str) + 1);
+}
+
+// 全局分配器的便捷封装，供构建/修改接口使用
+static void *json_malloc(size_t size) {
+    return g_allocator.malloc_fn(g_allocator.ctx, size);
+}
+
+static void *json_realloc(void *ptr, size_t size) {
+    return g_allocator.realloc_fn(g_allocator.ctx, ptr, size);
+}
+
+static void json_mem_free(void *ptr) {
+    if (ptr) g_allocator.free_fn(g_allocator.ctx, ptr);
+}
+
+static char *json_strdup(const char *str) {
+    return mem_strdup(&g_allocator, NULL, str);
+}
+
+// ============================= 内存分配器 end ================================
+
+// ============================= 解析统计 start ================================
+
+#ifdef MJSON_STATS
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static _Thread_local JsonStats t_stats_last;
+static _Thread_local JsonStats t_stats_total;
+
+static uint64_t stats_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t stats_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return stats_ns();
+#endif
+}
+
+/**
+ * 开始一次解析的统计，清空本线程最近一次解析的记录
+ */
+static void stats_parse_begin(ParserContext *ctx, JsonAllocStats *local) {
+    // 借用分配统计取得 realloc 次数，调用方未要求分配统计时使用临时的一份
+    if (!ctx->stats) ctx->stats = local;
+    t_stats_last.parse = (JsonParseStats){0};
+    t_stats_last.parse.calls = 1;
+    t_stats_last.parse.reallocs = ctx->stats->realloc_count;
+    t_stats_last.parse.total_ns = stats_ns();
+    t_stats_last.parse.total_ticks = stats_ticks();
+    ctx->pstats = &t_stats_last.parse;
+}
+
+static void stats_parse_end(const ParserContext *ctx) {
+    JsonParseStats *last = &t_stats_last.parse, *total = &t_stats_total.parse;
+    last->bytes = (size_t)(ctx->pos - ctx->start);
+    last->reallocs = ctx->stats->realloc_count - last->reallocs;
+    last->total_ticks = stats_ticks() - last->total_ticks;
+    last->total_ns = stats_ns() - last->total_ns;
+
+    total->calls++;
+    total->bytes += last->bytes;
+    for (int i = 0; i < JSON_TYPE_COUNT; i++) total->nodes[i] += last->nodes[i];
+    if (last->max_depth > total->max_depth) total->max_depth = last->max_depth;
+    total->string_bytes += last->string_bytes;
+    total->escapes += last->escapes;
+    total->reallocs += last->reallocs;
+    total->total_ns += last->total_ns;
+    total->total_ticks += last->total_ticks;
+    total->string_ticks += last->string_ticks;
+    total->number_ticks += last->number_ticks;
+}
+
+static void stats_serialized(size_t bytes, uint64_t start_ns, uint64_t start, uint64_t measured) {
+    uint64_t end = stats_ticks();
+    JsonSerializeStats *last = &t_stats_last.serialize, *total = &t_stats_total.serialize;
+    *last = (JsonSerializeStats){1, bytes, stats_ns() - start_ns, end - start, measured - start, end - measured};
+    total->calls++;
+    total->bytes += bytes;
+    total->total_ns += last->total_ns;
+    total->total_ticks += last->total_ticks;
+    total->measure_ticks += last->measure_ticks;
+    total->write_ticks += last->write_ticks;
+}
+
+#define STATS_ADD(ctx, field, n) do { if ((ctx)->pstats) (ctx)->pstats->field += (n); } while (0)
+#define STATS_TICKS(var) uint64_t var = stats_ticks()
+#define STATS_NS(var) uint64_t var = stats_ns()
+#define STATS_SPAN(ctx, field, since) STATS_ADD(ctx, field, stats_ticks() - (since))
+#define STATS_SERIALIZED(bytes, start_ns, start, measured) stats_serialized(bytes, start_ns, start, measured)
+#else
+#define STATS_ADD(ctx, field, n) ((void)0)
+#define STATS_TICKS(var) ((void)0)
+#define STATS_NS(var) ((void)0)
+#define STATS_SPAN(ctx, field, since) ((void)0)
+#define STATS_SERIALIZED(bytes, start_ns, start, measured) ((void)0)
+#endif
+
+bool json_stats_enabled(void) {
+#ifdef MJSON_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * 本线程最近一次解析与最近一次序列化的统计
+ * @param out 未开启统计时填 0
+ */
+void json_stats_last(JsonStats* out) {
+    if (!out) return;
+#ifdef MJSON_STATS
+    *out = t_stats_last;
+#else
+    memset(out, 0, sizeof(*out));
+#endif
+}
+
+/**
+ * 本线程的累计统计
+ * @param out 未开启统计时填 0
+ */
+void json_stats_thread(JsonStats* out) {
+    if (!out) return;
+#ifdef MJSON_STATS
+    *out = t_stats_total;
+#else
+    memset(out, 0, sizeof(*out));
+#endif
+}
+
+void json_stats_reset(void) {
+#ifdef MJSON_STATS
+    t_stats_last = (JsonStats){0};
+    t_stats_total = (JsonStats){0};
+#endif
+}
+
+// ============================= 解析统计 end ================================
+
+// ============================= 容器存储块 start ================================
+
+#define BLOCK_SORTED  0x1u  // 键值对按键物理有序
+#define BLOCK_INDEXED 0x2u  // 键值对保持原始顺序，order 记录按键排序后的下标
+#define BLOCK_PINNED  0x4u  // 位于单次分配的内存中（json_from_binary_flat），不单独释放，视为始终共享
+#define BLOCK_FROZEN  0x8u  // json_freeze 冻结：独占时拒绝一切修改，被共享时照常写时复制（副本不再冻结）
+
+// 容器上次序列化的文本（json_to_string_cached），存在即表示该容器未被修改；由存储块的分配器分配
+typedef struct {
+    size_t len;
+    char data[];
+} JsonTextCache;
+
+/**
+ * 数组/对象存储块头部，紧挨在 elements/pairs 指针之前，记录容量、对象的排序状态和共享计数
+ */
+typedef struct {
+    size_t capacity;
+    unsigned int flags;
+    atomic_uint shared; // 除第一个持有者外的持有者个数（json_clone 共享），0 表示独占
+    const JsonAllocator *allocator; // 分配本存储块的分配器，order、键以及直接存放在槽位中的字符串同样由它分配
+    uint32_t *order;    // BLOCK_INDEXED 时有效，长度为 capacity
+    _Atomic(JsonTextCache *) cache; // 序列化缓存，共享的存储块由各持有者共用
+    atomic_uint_least64_t hash;     // 键序无关的结构哈希（json_hash），0 表示未计算
+    _Atomic(void *) parent;  // 主持有者（第一个持有者）所在的存储块，NULL 表示根节点，BLOCK_PARENT_UNKNOWN 表示未知
+    atomic_bool nested;      // 共享期间有嵌套节点作为其他持有者（写时复制出的上层副本）
+} JsonBlock;
+
+#define BLOCK_OF(data) ((JsonBlock *)(data) - 1)
+// 主持有者已释放、剩余持有者中有嵌套节点时无法确定父存储块；再次经 json_get_mut 等路径写入时重新确定
+#define BLOCK_PARENT_UNKNOWN ((void *)(uintptr_t)1)
+
+static void block_init(JsonBlock *block, const JsonAllocator *allocator, size_t capacity, unsigned int flags) {
+    block->capacity = capacity;
+    block->flags = flags;
+    atomic_init(&block->shared, 0);
+    block->allocator = allocator;
+    block->order = NULL;
+    atomic_init(&block->cache, NULL);
+    atomic_init(&block->hash, 0);
+    atomic_init(&block->parent, NULL);
+    atomic_init(&block->nested, false);
+}
+
+static size_t block_capacity(const void *data) {
+    return data ? ((const JsonBlock *)data - 1)->capacity : 0;
+}
+
+/**
+ * 扩容后的容量：至少翻倍
+ */
+static size_t block_grown_capacity(size_t capacity, size_t min_capacity) {
+    return capacity * 2 > min_capacity ? capacity * 2 : min_capacity;
+}
+
+/**
+ * 确保存储块至少能容纳 min_capacity 个元素，容量不足时至少翻倍
+ * @param a 新建存储块使用的分配器；已有存储块总是用它自己的分配器扩容
+ * @param data 原数据指针，可为 NULL
+ * @return 新的数据指针，失败返回 NULL（原存储块保持不变）
+ */
+static void *block_reserve(const JsonAllocator *a, JsonAllocStats *stats, void *data,
+                           size_t elem_size, size_t min_capacity) {
+    size_t capacity = block_capacity(data);
+    if (min_capacity <= capacity) return data;
+    if (data) a = BLOCK_OF(data)->allocator;
+    size_t new_capacity = block_grown_capacity(capacity, min_capacity);
+    if (new_capacity > (SIZE_MAX - sizeof(JsonBlock)) / elem_size) return NULL;
+
+    size_t new_size = sizeof(JsonBlock) + new_capacity * elem_size;
+    JsonBlock *block = data
+            ? mem_realloc(a, stats, BLOCK_OF(data), sizeof(JsonBlock) + capacity * elem_size, new_size)
+            : mem_malloc(a, stats, new_size);
+    if (!block) return NULL;
+    if (!data) block_init(block, a, new_capacity, 0);
+    block->capacity = new_capacity;
+    return block + 1;
+}
+
+static void block_free_cache(const JsonBlock *block, JsonTextCache *cache) {
+    if (cache) mem_free(block->allocator, NULL, cache, sizeof(JsonTextCache) + cache->len);
+}
+
+static void block_free(JsonAllocStats *stats, void *data, size_t elem_size) {
+    if (!data) return;
+    JsonBlock *block = BLOCK_OF(data);
+    const JsonAllocator *a = block->allocator;
+    block_free_cache(block, atomic_load_explicit(&block->cache, memory_order_relaxed));
+    mem_free(a, stats, block->order, block->capacity * sizeof(uint32_t));
+    mem_free(a, stats, block, sizeof(JsonBlock) + block->capacity * elem_size);
+}
+
+static unsigned int block_flags(const void *data) {
+    return data ? ((const JsonBlock *)data - 1)->flags : 0;
+}
+
+/**
+ * 增加一个持有者
+ */
+static void block_retain(const void *data) {
+    if (!data || (block_flags(data) & BLOCK_PINNED)) return;
+    atomic_fetch_add_explicit(&BLOCK_OF((void *)data)->shared, 1, memory_order_relaxed);
+}
+
+/**
+ * 减少一个持有者
+ * @param holder 释放方节点所在的存储块，根节点为 NULL
+ * @return 调用方是最后一个持有者时返回 true，此时由调用方释放存储块及其内容
+ */
+static bool block_release(void *data, const void *holder) {
+    if (!data || (block_flags(data) & BLOCK_PINNED)) return false;
+    JsonBlock *block = BLOCK_OF(data);
+    if (atomic_load_explicit(&block->shared, memory_order_acquire) == 0) return true;
+    // 主持有者先交出父存储块，再减少计数：看到计数变化的一方同时看到新的父存储块
+    if (atomic_load_explicit(&block->parent, memory_order_relaxed) == holder) {
+        atomic_store_explicit(&block->parent,
+                              atomic_load_explicit(&block->nested, memory_order_relaxed) ? BLOCK_PARENT_UNKNOWN : NULL,
+                              memory_order_relaxed);
+    }
+    return atomic_fetch_sub_explicit(&block->shared, 1, memory_order_acq_rel) == 0;
+}
+
+/**
+ * 丢弃序列化缓存和结构哈希，只在独占的存储块上调用
+ */
+static void block_drop_cache(void *data) {
+    if (!data) return;
+    JsonBlock *block = BLOCK_OF(data);
+    atomic_store_explicit(&block->hash, 0, memory_order_relaxed);
+    JsonTextCache *cache = atomic_load_explicit(&block->cache, memory_order_relaxed);
+    if (cache) {
+        atomic_store_explicit(&block->cache, NULL, memory_order_relaxed);
+        block_free_cache(block, cache);
+    }
+}
+
+/**
+ * 数组、对象或紧凑数组的存储块数据指针，其他类型或空容器返回 NULL
+ */
+static void *value_block(const JsonValue *jv) {
+    switch (jv->type) {
+        case JSON_ARRAY:  return jv->value.array_value.elements;
+        case JSON_OBJECT: return jv->value.object_value.pairs;
+        case JSON_INT_ARRAY:
+        case JSON_INT64_ARRAY:
+        case JSON_FLOAT_ARRAY:
+        case JSON_DOUBLE_ARRAY:
+            return jv->value.packed_value.data;
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * 容器已计算的结构哈希，未计算返回 0
+ */
+static uint64_t block_hash(const JsonValue *jv) {
+    void *data = value_block(jv);
+    return data ? atomic_load_explicit(&BLOCK_OF(data)->hash, memory_order_acquire) : 0;
+}
+
+static bool block_is_shared(const void *data) {
+    if (!data) return false;
+    return (block_flags(data) & BLOCK_PINNED) ||
+           atomic_load_explicit(&BLOCK_OF((void *)data)->shared, memory_order_acquire) > 0;
+}
+
+// 根节点的 owner 最低位为 1 时，其余位是文档的分配器（json_parse_ex 指定了分配器）；owner 为 NULL 的根节点使用全局分配器
+#define OWNER_ALLOCATOR_TAG ((uintptr_t)1)
+
+/**
+ * 使用分配器 a 的根节点的 owner
+ */
+static void *root_owner(const JsonAllocator *a) {
+    return a == &g_allocator ? NULL : (void *)((uintptr_t)a | OWNER_ALLOCATOR_TAG);
+}
+
+/**
+ * 节点所在容器的存储块，根节点返回 NULL
+ */
+static void *owner_block(const JsonValue *jv) {
+    return ((uintptr_t)jv->owner & OWNER_ALLOCATOR_TAG) ? NULL : jv->owner;
+}
+
+/**
+ * 节点的字符串值所用的分配器：所在存储块的分配器，根节点取 owner 记录的分配器
+ */
+static const JsonAllocator *value_allocator(const JsonValue *jv) {
+    uintptr_t owner = (uintptr_t)jv->owner;
+    if (owner & OWNER_ALLOCATOR_TAG) return (const JsonAllocator *)(owner & ~OWNER_ALLOCATOR_TAG);
+    return owner ? BLOCK_OF(jv->owner)->allocator : &g_allocator;
+}
+
+/**
+ * 容器的存储块、键所用的分配器：已有存储块时取存储块的分配器，否则同 value_allocator
+ */
+static const JsonAllocator *node_allocator(const JsonValue *jv) {
+    void *data = value_block(jv);
+    return data ? BLOCK_OF(data)->allocator : value_allocator(jv);
+}
+
+/**
+ * jv 是否为其存储块的主持有者
+ */
+static bool block_is_primary(const void *data, const JsonValue *jv) {
+    return atomic_load_explicit(&BLOCK_OF((void *)data)->parent, memory_order_relaxed) == owner_block(jv);
+}
+
+/**
+ * 值按位移入槽位之后调用：slot 中仍是原位置的 owner，改为 owner 并把子存储块挂到新位置。
+ * 独占的子存储块直接以新位置的存储块为父；共享的子存储块只有由主持有者移入时才换父，否则记下有嵌套的其他持有者
+ * @param slot
+ * @param owner 新位置所在的存储块；移出为根节点时为 root_owner
+ */
+static void slot_attach(JsonValue *slot, void *owner) {
+    void *from = owner_block(slot);
+    slot->owner = owner;
+    void *data = owner_block(slot);
+    void *child = value_block(slot);
+    if (!child || (block_flags(child) & BLOCK_PINNED)) return;
+    JsonBlock *block = BLOCK_OF(child);
+    if (!block_is_shared(child)) {
+        atomic_store_explicit(&block->parent, data, memory_order_relaxed);
+        atomic_store_explicit(&block->nested, false, memory_order_relaxed);
+    } else if (atomic_load_explicit(&block->parent, memory_order_relaxed) == from) {
+        atomic_store_explicit(&block->parent, data, memory_order_relaxed);
+    } else if (data) {
+        atomic_store_explicit(&block->nested, true, memory_order_relaxed);
+    }
+}
+
+/**
+ * 移出容器（被删除或替换的值暂存在末尾空槽、补丁日志中）：之后作为根节点释放或再次移入容器，保留原文档的分配器
+ */
+static void value_detach(JsonValue *jv) {
+    slot_attach(jv, root_owner(value_allocator(jv)));
+}
+
+/**
+ * 把 value 的内容按位移入 slot（slot 原有内容已移走或释放），slot 保持在原来的位置
+ */
+static void slot_store(JsonValue *slot, const JsonValue *value) {
+    void *owner = slot->owner;
+    *slot = *value;
+    slot_attach(slot, owner);
+}
+
+/**
+ * 存储块新建或搬移（realloc）后调用：jv 是其唯一持有者，重新挂接每个槽位
+ */
+static void value_adopt(JsonValue *jv) {
+    void *data = value_block(jv);
+    if (!data) return;
+    JsonBlock *block = BLOCK_OF(data);
+    atomic_store_explicit(&block->parent, owner_block(jv), memory_order_relaxed);
+    atomic_store_explicit(&block->nested, false, memory_order_relaxed);
+    if (jv->type == JSON_ARRAY) {
+        for (size_t i = 0; i < jv->value.array_value.ele_count; i++) {
+            slot_attach(&jv->value.array_value.elements[i], data);
+        }
+    } else if (jv->type == JSON_OBJECT) {
+        for (size_t i = 0; i < jv->value.object_value.pair_count; i++) {
+            slot_attach(&jv->value.object_value.pairs[i].value, data);
+        }
+    }
+}
+
+/**
+ * 节点能否原地修改：从所在存储块沿父存储块到根，每一层都独占、未冻结且位置已知。
+ * json_clone 之后 json_get 取得的节点位于共享的存储块中，修改会被其他克隆看到，因此拒绝。
+ * 可修改时丢弃沿途的序列化缓存与结构哈希
+ * @param jv
+ * @return
+ */
+static bool value_chain_writable(const JsonValue *jv) {
+    void *data;
+    for (data = owner_block(jv); data; data = atomic_load_explicit(&BLOCK_OF(data)->parent, memory_order_relaxed)) {
+        if (data == BLOCK_PARENT_UNKNOWN || block_is_shared(data) || (block_flags(data) & BLOCK_FROZEN)) return false;
+    }
+    for (data = owner_block(jv); data; data = atomic_load_explicit(&BLOCK_OF(data)->parent, memory_order_relaxed)) {
+        block_drop_cache(data);
+    }
+    return true;
+}
+
+/**
+ * 对象键值对扩容，按键索引（order）随容量同步扩容
+ * @param a 对象尚无存储块时新建存储块使用的分配器
+ * @return
+ */
+static int pairs_reserve(const JsonAllocator *a, JsonAllocStats *stats, JsonValue *obj, size_t min_count) {
+    JsonPair *pairs = obj->value.object_value.pairs;
+    size_t capacity = block_capacity(pairs);
+    if (min_count <= capacity) return 1;
+    uint32_t *order = pairs ? BLOCK_OF(pairs)->order : NULL;
+    if (pairs) a = BLOCK_OF(pairs)->allocator;
+    size_t new_capacity = block_grown_capacity(capacity, min_count);
+    if (order) {
+        // 先扩容 order：键值对扩容失败时再缩回，容量与 order 长度始终一致
+        if (new_capacity > SIZE_MAX / sizeof(uint32_t)) return 0;
+        order = mem_realloc(a, stats, order, capacity * sizeof(uint32_t), new_capacity * sizeof(uint32_t));
+        if (!order) return 0;
+        BLOCK_OF(pairs)->order = order;
+    }
+    JsonPair *grown = block_reserve(a, stats, pairs, sizeof(JsonPair), new_capacity);
+    if (!grown) {
+        if (order) {
+            uint32_t *shrunk = mem_realloc(a, stats, order, new_capacity * sizeof(uint32_t),
+                                           capacity * sizeof(uint32_t));
+            // 缩小失败时保留较大的 order，只多占内存
+            if (shrunk) BLOCK_OF(pairs)->order = shrunk;
+        }
+        return 0;
+    }
+    obj->value.object_value.pairs = grown;
+    return 1;
+}
+
+// ============================= 容器存储块 end ================================
+
+// ============================= 对象键排序 start ================================
+
+static const char *sorted_key_at(const JsonPair *pairs, const uint32_t *order, size_t rank) {
+    return pairs[order ? order[rank] : rank].key;
+}
+
+/**
+ * 在按键有序的序列中二分查找
+ * @param upper false 返回第一个 >= key 的位置，true 返回第一个 > key 的位置
+ * @return
+ */
+static size_t sorted_bound(const JsonPair *pairs, const uint32_t *order, size_t count, const char *key, bool upper) {
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        int cmp = strcmp(key, sorted_key_at(pairs, order, mid));
+        if (cmp < 0 || (cmp == 0 && !upper)) high = mid;
+        else low = mid + 1;
+    }
+    return low;
+}
+
+/**
+ * 查找键对应的索引，有序对象使用二分查找，重复键返回第一个
+ * @param obj
+ * @param key
+ * @return
+ */
+static int find_key_index(const JsonValue* obj, const char* key) {
+    if (!obj || obj->type != JSON_OBJECT || !key) return -1;
+
+    const JsonPair *pairs = obj->value.object_value.pairs;
+    size_t count = obj->value.object_value.pair_count;
+    unsigned int flags = block_flags(pairs);
+    if (flags & (BLOCK_SORTED | BLOCK_INDEXED)) {
+        const uint32_t *order = (flags & BLOCK_INDEXED) ? BLOCK_OF(pairs)->order : NULL;
+        size_t rank = sorted_bound(pairs, order, count, key, false);
+        if (rank < count && strcmp(sorted_key_at(pairs, order, rank), key) == 0) {
+            return order ? (int)order[rank] : (int)rank;
+        }
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (strcmp(pairs[i].key, key) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void insertion_sort_order(const JsonPair *pairs, uint32_t *order, size_t low, size_t high) {
+    for (size_t i = low + 1; i < high; i++) {
+        uint32_t v = order[i];
+        size_t j = i;
+        while (j > low && strcmp(pairs[order[j - 1]].key, pairs[v].key) > 0) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = v;
+    }
+}
+
+/**
+ * 稳定归并排序：order 为键值对下标，按键排序，tmp 为等长临时空间
+ */
+static void sort_order(const JsonPair *pairs, uint32_t *order, uint32_t *tmp, size_t count) {
+    const size_t run = 16;
+    for (size_t low = 0; low < count; low += run) {
+        insertion_sort_order(pairs, order, low, low + run < count ? low + run : count);
+    }
+
+    uint32_t *src = order, *dst = tmp;
+    for (size_t width = run; width < count; width *= 2) {
+        for (size_t low = 0; low < count; low += 2 * width) {
+            size_t mid = low + width < count ? low + width : count;
+            size_t high = low + 2 * width < count ? low + 2 * width : count;
+            size_t i = low, j = mid, k = low;
+            while (i < mid && j < high) {
+                // 右侧严格小于时才先取，保证稳定
+                dst[k++] = strcmp(pairs[src[j]].key, pairs[src[i]].key) < 0 ? src[j++] : src[i++];
+            }
+            while (i < mid) dst[k++] = src[i++];
+            while (j < high) dst[k++] = src[j++];
+        }
+        uint32_t *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != order) memcpy(order, src, count * sizeof(uint32_t));
+}
+
+/**
+ * 对象按键排序
+ * @param a 对象尚无存储块时新建存储块使用的分配器
+ * @param keep_order true 时键值对保持原始顺序，仅建立按键排序的下标索引
+ * @return
+ */
+static int object_sort(const JsonAllocator *a, JsonAllocStats *stats, JsonValue *obj, bool keep_order) {
+    size_t count = obj->value.object_value.pair_count;
+    if (count > UINT32_MAX) return 0;
+    // 空对象也需要存储块来记录排序状态
+    if (!pairs_reserve(a, stats, obj, count ? count : 1)) return 0;
+    JsonPair *pairs = obj->value.object_value.pairs;
+    JsonBlock *block = BLOCK_OF(pairs);
+    a = block->allocator;
+
+    size_t order_size = (keep_order ? block->capacity : count) * sizeof(uint32_t);
+    uint32_t *order = (keep_order && block->order) ? block->order : mem_malloc(a, stats, order_size ? order_size : 1);
+    uint32_t *tmp = mem_malloc(a, stats, count * sizeof(uint32_t) + 1);
+    if (!order || !tmp) {
+        if (order != block->order) mem_free(a, stats, order, order_size);
+        mem_free(a, stats, tmp, count * sizeof(uint32_t) + 1);
+        return 0;
+    }
+    for (size_t i = 0; i < count; i++) order[i] = (uint32_t)i;
+    sort_order(pairs, order, tmp, count);
+    mem_free(a, stats, tmp, count * sizeof(uint32_t) + 1);
+
+    if (keep_order) {
+        block->order = order;
+        block->flags = (block->flags & ~BLOCK_SORTED) | BLOCK_INDEXED;
+        return 1;
+    }
+
+    // 按 order 原地置换键值对：位置 i 应放置原下标为 order[i] 的键值对
+    for (size_t i = 0; i < count; i++) {
+        if (order[i] == i) continue;
+        JsonPair saved = pairs[i];
+        size_t j = i;
+        while (order[j] != i) {
+            size_t next = order[j];
+            pairs[j] = pairs[next];
+            order[j] = (uint32_t)j;
+            j = next;
+        }
+        pairs[j] = saved;
+        order[j] = (uint32_t)j;
+    }
+    mem_free(a, stats, order, order_size);
+    if (block->order) {
+        mem_free(a, stats, block->order, block->capacity * sizeof(uint32_t));
+        block->order = NULL;
+    }
+    block->flags = (block->flags & ~BLOCK_INDEXED) | BLOCK_SORTED;
+    return 1;
+}
+
+// ============================= 对象键排序 end ================================
+
 /**
  * 词法分析
  * @param ctx
@@ -19,6 +754,8 @@ static void skip_whitespace(ParserContext *ctx) {
 
 // 递归解析
 static JsonValue parse_value(ParserContext *ctx, int *error);
+static uint64_t value_hash(const JsonValue *jv, bool unordered);
+static void free_value(JsonValue *value, JsonAllocStats *stats);
 
 static int parse_hex(ParserContext *ctx) {
     int hex = 0;
@@ -128,92 +865,290 @@ static int count_significant_digits(const char *start, const char *end) {
 }
 
 /**
- * 解析数字
- * @param ctx
- * @return
+ * 扫描数字并判断其类型（JSON_INT / JSON_FLOAT / JSON_DOUBLE）
+ * @param start
+ * @param end 返回数字结束位置
+ * @param value 返回 double 值
+ * @return 不是数字时返回 JSON_NULL
  */
-JsonValue parse_number(ParserContext *ctx) {
-    const char *start = ctx->pos;
+static JsonType scan_number(const char *start, const char **end, double *value) {
     char *end_ptr;
     double dbl_val = strtod(start, &end_ptr);
+    *end = end_ptr;
+    *value = dbl_val;
     if (end_ptr == start) {
-        return (JsonValue){JSON_NULL,{0}};
+        return JSON_NULL;
     }
-    ctx->pos = end_ptr;
     // --- 判断整数 ---
     bool is_integer = (fmod(dbl_val, 1.0) == 0.0);
     if (is_integer && dbl_val >= INT_MIN && dbl_val <= INT_MAX) {
-        return (JsonValue){JSON_INT, .value.int_value = (int)dbl_val};
+        return JSON_INT;
     }
     // --- 计算有效位数 ---
     int significant_digits = count_significant_digits(start, end_ptr);
     // --- 判断是否适合 float ---
     if (significant_digits <= FLT_DIG && dbl_val >= -FLT_MAX && dbl_val <= FLT_MAX) {
-        return (JsonValue){JSON_FLOAT, .value.float_value = (float)dbl_val};
+        return JSON_FLOAT;
     }
     // --- 默认返回 double ---
-    return (JsonValue){JSON_DOUBLE, .value.double_value = dbl_val};
+    return JSON_DOUBLE;
 }
 
 /**
- * 解析字符串
+ * 解析数字
  * @param ctx
- * @param error
  * @return
  */
-static char *parse_string(ParserContext *ctx, int *error) {
-    if (*ctx->pos != '"') {
-        *error = JSON_INVALID;
-        return NULL;
+JsonValue parse_number(ParserContext *ctx) {
+    STATS_TICKS(start);
+    double dbl_val;
+    const char *end;
+    JsonType type = scan_number(ctx->pos, &end, &dbl_val);
+    ctx->pos = end;
+    JsonValue result;
+    switch (type) {
+        case JSON_INT:   result = (JsonValue){.type = JSON_INT, .value.int_value = (int)dbl_val}; break;
+        case JSON_FLOAT: result = (JsonValue){.type = JSON_FLOAT, .value.float_value = (float)dbl_val}; break;
+        case JSON_DOUBLE:result = (JsonValue){.type = JSON_DOUBLE, .value.double_value = dbl_val}; break;
+        default:         result = (JsonValue){.type = JSON_NULL}; break;
     }
-    ctx->pos++;
+    STATS_SPAN(ctx, number_ticks, start);
+    return result;
+}
 
-    char *buffer = malloc(256);
-    size_t capacity = 256, length = 0;
+// ============================= 紧凑数值数组 start ================================
 
-    while (*ctx->pos != '"') {
-        if (*ctx->pos == '\\') {
+typedef struct {
+    double d;
+    int64_t i;
+} PackedSlot;
+
+static bool is_integer_literal(const char *start, const char *end) {
+    for (const char *p = start; p < end; p++) {
+        if (*p == '.' || *p == 'e' || *p == 'E') return false;
+    }
+    return true;
+}
+
+static size_t packed_elem_size(JsonType type) {
+    switch (type) {
+        case JSON_INT_ARRAY:    return sizeof(int32_t);
+        case JSON_INT64_ARRAY:  return sizeof(int64_t);
+        case JSON_FLOAT_ARRAY:  return sizeof(float);
+        case JSON_DOUBLE_ARRAY: return sizeof(double);
+        default: return 0;
+    }
+}
+
+/**
+ * 尝试将全数字数组解析为紧凑数组：元素类型取能无损容纳所有元素的最窄类型
+ * （全部 int → int32；有超出 int 的整数 → int64；含 float 且整数不超过 2^24 → float；否则 double）
+ * @param ctx pos 指向 '['
+ * @param out
+ * @return 1 成功；0 不满足条件（pos 已回退，交给通用路径解析）；-1 内存不足
+ */
+static int parse_packed_array(ParserContext *ctx, JsonValue *out) {
+    const char *array_start = ctx->pos;
+    PackedSlot *slots = NULL;
+    size_t count = 0, capacity = 0;
+    size_t int64_count = 0, float_count = 0, double_count = 0;
+    uint64_t max_abs_int = 0;
+    bool ints_fit_float = true;
+    bool closed = false;
+
+    ctx->pos++;  // 跳过'['
+    while (1) {
+        skip_whitespace(ctx);
+        if (*ctx->pos == ']' && count > 0) {
+            ctx->pos++;
+            closed = true;
+            break;
+        }
+        if (!isdigit((unsigned char)*ctx->pos) && *ctx->pos != '-') break;
+
+        const char *start = ctx->pos, *end;
+        PackedSlot slot = {0, 0};
+        JsonType type = scan_number(start, &end, &slot.d);
+        if (type == JSON_NULL) break;
+        ctx->pos = end;
+
+        if (type == JSON_INT) {
+            slot.i = (int64_t)slot.d;
+        } else if (is_integer_literal(start, end)) {
+            // 超出 int 范围的整数，尝试按 int64 精确解析
+            char *int_end;
+            errno = 0;
+            long long ll = strtoll(start, &int_end, 10);
+            if (errno == 0 && int_end == end) {
+                type = JSON_INT64_ARRAY;
+                slot.i = ll;
+            }
+        }
+        if (type == JSON_INT || type == JSON_INT64_ARRAY) {
+            uint64_t abs_val = slot.i < 0 ? (uint64_t)0 - (uint64_t)slot.i : (uint64_t)slot.i;
+            if (abs_val > max_abs_int) max_abs_int = abs_val;
+            if (type == JSON_INT64_ARRAY) int64_count++;
+            // FLOAT 元素按 %.6g 输出，超过 6 位的整数会变成科学计数法或丢位
+            if (abs_val >= 1000000) ints_fit_float = false;
+        } else if (type == JSON_FLOAT) {
+            float_count++;
+        } else {
+            double_count++;
+        }
+
+        if (count == capacity) {
+            size_t new_capacity = capacity ? capacity * 2 : 16;
+            PackedSlot *new_slots = mem_realloc(ctx->allocator, ctx->stats, slots,
+                                                capacity * sizeof(PackedSlot), new_capacity * sizeof(PackedSlot));
+            if (!new_slots) {
+                mem_free(ctx->allocator, ctx->stats, slots, capacity * sizeof(PackedSlot));
+                return -1;
+            }
+            slots = new_slots;
+            capacity = new_capacity;
+        }
+        slots[count++] = slot;
+
+        skip_whitespace(ctx);
+        if (*ctx->pos == ',') {
+            ctx->pos++;
+        } else if (*ctx->pos == ']') {
             ctx->pos++;
+            closed = true;
+            break;
+        } else {
+            break;
+        }
+    }
+
+    // 选择元素类型
+    JsonType packed_type = JSON_NULL;
+    if (closed) {
+        if (float_count == 0 && double_count == 0) {
+            packed_type = int64_count ? JSON_INT64_ARRAY : JSON_INT_ARRAY;
+        } else if (double_count == 0 && ints_fit_float && max_abs_int <= (1u << FLT_MANT_DIG)) {
+            packed_type = JSON_FLOAT_ARRAY;
+        } else if (max_abs_int <= ((uint64_t)1 << DBL_MANT_DIG)) {
+            packed_type = JSON_DOUBLE_ARRAY;
+        }
+    }
+    if (packed_type == JSON_NULL) {
+        mem_free(ctx->allocator, ctx->stats, slots, capacity * sizeof(PackedSlot));
+        ctx->pos = array_start;
+        return 0;
+    }
+
+    void *data = block_reserve(ctx->allocator, ctx->stats, NULL, packed_elem_size(packed_type), count);
+    if (!data) {
+        mem_free(ctx->allocator, ctx->stats, slots, capacity * sizeof(PackedSlot));
+        return -1;
+    }
+    // 整数槽位的 d 与 i 等值，浮点槽位只使用 d
+    for (size_t k = 0; k < count; k++) {
+        switch (packed_type) {
+            case JSON_INT_ARRAY:    ((int32_t *)data)[k] = (int32_t)slots[k].i; break;
+            case JSON_INT64_ARRAY:  ((int64_t *)data)[k] = slots[k].i; break;
+            case JSON_FLOAT_ARRAY:  ((float *)data)[k] = (float)slots[k].d; break;
+            default:                ((double *)data)[k] = slots[k].d; break;
+        }
+    }
+    mem_free(ctx->allocator, ctx->stats, slots, capacity * sizeof(PackedSlot));
+
+    out->type = packed_type;
+    out->value.packed_value.data = data;
+    out->value.packed_value.count = count;
+    return 1;
+}
+
+// ============================= 紧凑数值数组 end ================================
+
+/**
+ * 从 ctx->pos 解码字符串内容直到闭合引号（停在引号上）
+ * @param ctx
+ * @param out 解码结果，为 NULL 时只计算长度
+ * @param length 解码后的字节数
+ * @return 未闭合、非法转义时返回 JSON_INVALID
+ */
+static int decode_string(ParserContext *ctx, char *out, size_t *length) {
+    size_t n = 0;
+    while (*ctx->pos != '"') {
+        char c = *ctx->pos++;
+        if (c == '\0') return JSON_INVALID;  // 输入在字符串闭合前结束
+        if (c == '\\') {
+            if (out) STATS_ADD(ctx, escapes, 1);
             switch (*ctx->pos++) {
-                case '"':  buffer[length++] = '"';  break;
-                case '\\': buffer[length++] = '\\'; break;
-                case '/':  buffer[length++] = '/';  break;
-                case 'b':  buffer[length++] = '\b'; break;
-                case 'f':  buffer[length++] = '\f'; break;
-                case 'n':  buffer[length++] = '\n'; break;
-                case 'r':  buffer[length++] = '\r'; break;
-                case 't':  buffer[length++] = '\t'; break;
+                case '"':  c = '"';  break;
+                case '\\': c = '\\'; break;
+                case '/':  c = '/';  break;
+                case 'b':  c = '\b'; break;
+                case 'f':  c = '\f'; break;
+                case 'n':  c = '\n'; break;
+                case 'r':  c = '\r'; break;
+                case 't':  c = '\t'; break;
                 case 'u': {
                     int codepoint = parse_hex(ctx);
                     // 简化处理：只支持基本多语言平面
+                    if (codepoint < 0) return JSON_INVALID;
                     if (codepoint <= 0x7F) {
-                        buffer[length++] = codepoint;
+                        if (out) out[n] = (char)codepoint;
+                        n++;
                     } else if (codepoint <= 0x7FF) {
-                        buffer[length++] = 0xC0 | (codepoint >> 6);
-                        buffer[length++] = 0x80 | (codepoint & 0x3F);
+                        if (out) {
+                            out[n] = (char)(0xC0 | (codepoint >> 6));
+                            out[n + 1] = (char)(0x80 | (codepoint & 0x3F));
+                        }
+                        n += 2;
                     }
-                    break;
+                    continue;
                 }
-                default: *error = JSON_INVALID; break;
+                default: return JSON_INVALID;
             }
-        } else {
-            buffer[length++] = *ctx->pos++;
         }
+        if (out) out[n] = c;
+        n++;
+    }
+    *length = n;
+    return JSON_SUCCESS;
+}
 
-        // 动态扩容
-        if (length >= capacity - 4) {
-            capacity *= 2;
-            char *new_buf = realloc(buffer, capacity);
-            if (!new_buf) {
-                *error = JSON_MEM_ERROR;
-                free(buffer);
-                return NULL;
-            }
-            buffer = new_buf;
-        }
+/**
+ * 解析字符串
+ * @param ctx
+ * @param error
+ * @return 解码后的字符串；未闭合、非法转义时返回 NULL 并设置 error
+ */
+static char *parse_string(ParserContext *ctx, int *error) {
+    if (*ctx->pos != '"') {
+        *error = JSON_INVALID;
+        return NULL;
+    }
+    ctx->pos++;
+    STATS_TICKS(start);
+
+    // 先计算解码后的长度，按实际大小分配一次
+    const char *content = ctx->pos;
+    size_t length = 0;
+    int failure = decode_string(ctx, NULL, &length);
+    if (failure) {
+        *error = failure;
+        return NULL;
+    }
+    char *buffer = mem_malloc(ctx->allocator, ctx->stats, length + 1);
+    if (!buffer) {
+        *error = JSON_MEM_ERROR;
+        return NULL;
     }
+    ctx->pos = content;
+    decode_string(ctx, buffer, &length);
     ctx->pos++;
     buffer[length] = '\0';
+    if (strlen(buffer) != length) {
+        // \u0000 截断了字符串：收缩到 strlen + 1，与释放时统计的大小一致
+        char *shrunk = mem_realloc(ctx->allocator, ctx->stats, buffer, length + 1, strlen(buffer) + 1);
+        if (shrunk) buffer = shrunk;
+    }
+    STATS_ADD(ctx, string_bytes, length);
+    STATS_SPAN(ctx, string_ticks, start);
     return buffer;
 }
 
@@ -224,25 +1159,50 @@ static char *parse_string(ParserContext *ctx, int *error) {
  * @return
  */
 static JsonValue parse_array(ParserContext *ctx, int *error) {
-    JsonValue arr = {JSON_ARRAY, {.array_value = {NULL, 0}}};
+    JsonValue arr = {.type = JSON_ARRAY, .value.array_value = {NULL, 0}};
+    if (ctx->flags & JSON_PARSE_PACK_NUMBERS) {
+        STATS_TICKS(start);
+        int packed = parse_packed_array(ctx, &arr);
+        STATS_SPAN(ctx, number_ticks, start);
+        if (packed > 0) {
+            if (ctx->flags & JSON_PARSE_HASH) value_hash(&arr, true);
+            return arr;
+        }
+        if (packed < 0) {
+            *error = JSON_MEM_ERROR;
+            return (JsonValue){0};
+        }
+    }
     ctx->pos++;  // 跳过'['
 
     while (1) {
         skip_whitespace(ctx);
         if (*ctx->pos == ']') {
             ctx->pos++;
+            value_adopt(&arr);
+            // 子节点的哈希已在各自解析结束时算出，这里只做一次合并
+            if (ctx->flags & JSON_PARSE_HASH) value_hash(&arr, true);
             return arr;
         }
 
         JsonValue element = parse_value(ctx, error);
         if (*error) {
-            json_free(&arr);
+            free_value(&element, ctx->stats);
+            free_value(&arr, ctx->stats);
             return (JsonValue){0};
         }
 
         // 扩容数组
-        arr.value.array_value.elements = realloc(arr.value.array_value.elements,
-                                           (arr.value.array_value.ele_count + 1) * sizeof(JsonValue));
+        size_t count = arr.value.array_value.ele_count;
+        JsonValue *elements = block_reserve(ctx->allocator, ctx->stats, arr.value.array_value.elements,
+                                            sizeof(JsonValue), count + 1);
+        if (!elements) {
+            *error = JSON_MEM_ERROR;
+            free_value(&element, ctx->stats);
+            free_value(&arr, ctx->stats);
+            return (JsonValue){0};
+        }
+        arr.value.array_value.elements = elements;
         arr.value.array_value.elements[arr.value.array_value.ele_count++] = element;
 
         skip_whitespace(ctx);
@@ -257,13 +1217,22 @@ static JsonValue parse_array(ParserContext *ctx, int *error) {
  * @return
  */
 static JsonValue parse_object(ParserContext *ctx, int *error) {
-    JsonValue obj = {JSON_OBJECT, {.object_value = {NULL, 0}}};
+    JsonValue obj = {.type = JSON_OBJECT, .value.object_value = {NULL, 0}};
     ctx->pos++;  // 跳过'{'
 
     while (1) {
         skip_whitespace(ctx);
         if (*ctx->pos == '}') {
             ctx->pos++;
+            // 空对象同样建立存储块记录排序状态，之后的插入保持有序
+            if ((ctx->flags & JSON_PARSE_SORT_KEYS) &&
+                !object_sort(ctx->allocator, ctx->stats, &obj, (ctx->flags & JSON_PARSE_KEEP_ORDER) != 0)) {
+                *error = JSON_MEM_ERROR;
+                free_value(&obj, ctx->stats);
+                return (JsonValue){0};
+            }
+            value_adopt(&obj);
+            if (ctx->flags & JSON_PARSE_HASH) value_hash(&obj, true);
             return obj;
         }
 
@@ -272,15 +1241,16 @@ static JsonValue parse_object(ParserContext *ctx, int *error) {
         char *key = parse_string(ctx, &key_error);
         if (key_error) {
             *error = key_error;
-            json_free(&obj);
+            mem_free_string(ctx->allocator, ctx->stats, key);
+            free_value(&obj, ctx->stats);
             return (JsonValue){0};
         }
 
         skip_whitespace(ctx);
         if (*ctx->pos != ':') {
             *error = JSON_INVALID;
-            free(key);
-            json_free(&obj);
+            mem_free_string(ctx->allocator, ctx->stats, key);
+            free_value(&obj, ctx->stats);
             return (JsonValue){0};
         }
         ctx->pos++;
@@ -288,14 +1258,21 @@ static JsonValue parse_object(ParserContext *ctx, int *error) {
         // 解析value
         JsonValue value = parse_value(ctx, error);
         if (*error) {
-            free(key);
-            json_free(&obj);
+            mem_free_string(ctx->allocator, ctx->stats, key);
+            free_value(&value, ctx->stats);
+            free_value(&obj, ctx->stats);
             return (JsonValue){0};
         }
 
         // 添加键值对
-        obj.value.object_value.pairs = realloc(obj.value.object_value.pairs,
-                                         (obj.value.object_value.pair_count + 1) * sizeof(JsonPair));
+        size_t count = obj.value.object_value.pair_count;
+        if (!pairs_reserve(ctx->allocator, ctx->stats, &obj, count + 1)) {
+            *error = JSON_MEM_ERROR;
+            mem_free_string(ctx->allocator, ctx->stats, key);
+            free_value(&value, ctx->stats);
+            free_value(&obj, ctx->stats);
+            return (JsonValue){0};
+        }
         obj.value.object_value.pairs[obj.value.object_value.pair_count] = (JsonPair){
                 .key = key,
                 .value = value
@@ -313,32 +1290,32 @@ static JsonValue parse_object(ParserContext *ctx, int *error) {
  * @param error
  * @return
  */
-static JsonValue parse_value(ParserContext *ctx, int *error) {
+static JsonValue parse_token(ParserContext *ctx, int *error) {
     skip_whitespace(ctx);
     switch (*ctx->pos) {
         case '{': return parse_object(ctx, error);
         case '[': return parse_array(ctx, error);
         case '"': {
-            JsonValue str = {JSON_STRING,.value={0}};
+            JsonValue str = {.type = JSON_STRING};
             str.value.string_value = parse_string(ctx, error);
             return str;
         }
         case 't':  // true
             if (strncmp(ctx->pos, "true", 4) == 0) {
                 ctx->pos += 4;
-                return (JsonValue){JSON_BOOL, {.bool_value = true}};
+                return (JsonValue){.type = JSON_BOOL, .value.bool_value = true};
             }
             break;
         case 'f':  // false
             if (strncmp(ctx->pos, "false", 5) == 0) {
                 ctx->pos += 5;
-                return (JsonValue){JSON_BOOL, {.bool_value = false}};
+                return (JsonValue){.type = JSON_BOOL, .value.bool_value = false};
             }
             break;
         case 'n':  // null
             if (strncmp(ctx->pos, "null", 4) == 0) {
                 ctx->pos += 4;
-                return (JsonValue){JSON_NULL, {0}};
+                return (JsonValue){.type = JSON_NULL};
             }
             break;
         default: {
@@ -352,6 +1329,60 @@ static JsonValue parse_value(ParserContext *ctx, int *error) {
     return (JsonValue){0};
 }
 
+static JsonValue parse_value(ParserContext *ctx, int *error) {
+#ifdef MJSON_STATS
+    // 统计嵌套深度与各类型节点数
+    if (ctx->pstats && ++ctx->depth > ctx->pstats->max_depth) ctx->pstats->max_depth = ctx->depth;
+    JsonValue value = parse_token(ctx, error);
+    if (ctx->pstats) {
+        ctx->depth--;
+        if (!*error) ctx->pstats->nodes[value.type]++;
+    }
+#else
+    JsonValue value = parse_token(ctx, error);
+#endif
+    value.owner = ctx->owner;
+    return value;
+}
+
+/**
+ * 递归释放节点内容（不释放节点本身），字符串与存储块各自交还给分配它们的分配器
+ * @param value
+ * @param stats 非 NULL 时记录释放的字节数（解析失败时）
+ */
+static void free_value(JsonValue *value, JsonAllocStats *stats) {
+    switch (value->type) {
+        case JSON_STRING:
+            mem_free_string(value_allocator(value), stats, value->value.string_value);
+            break;
+        case JSON_ARRAY:
+            // 存储块仍被其他克隆共享时只减少计数
+            if (!block_release(value->value.array_value.elements, owner_block(value))) break;
+            for (size_t i = 0; i < value->value.array_value.ele_count; i++)
+                free_value(&value->value.array_value.elements[i], stats);
+            block_free(stats, value->value.array_value.elements, sizeof(JsonValue));
+            break;
+        case JSON_OBJECT: {
+            JsonPair *pairs = value->value.object_value.pairs;
+            if (!block_release(pairs, owner_block(value))) break;
+            for (size_t i = 0; i < value->value.object_value.pair_count; i++) {
+                mem_free_string(BLOCK_OF(pairs)->allocator, stats, pairs[i].key);
+                free_value(&pairs[i].value, stats);
+            }
+            block_free(stats, pairs, sizeof(JsonPair));
+            break;
+        }
+        case JSON_INT_ARRAY:
+        case JSON_INT64_ARRAY:
+        case JSON_FLOAT_ARRAY:
+        case JSON_DOUBLE_ARRAY:
+            if (!block_release(value->value.packed_value.data, owner_block(value))) break;
+            block_free(stats, value->value.packed_value.data, packed_elem_size(value->type));
+            break;
+        default: break;
+    }
+}
+
 /**
  * json字符串解析
  * @param json
@@ -359,109 +1390,334 @@ static JsonValue parse_value(ParserContext *ctx, int *error) {
  * @return
  */
 JsonValue json_parse(const char *json, int *error) {
-    ParserContext ctx = {json, json,NULL};
+    return json_parse_ex(json, NULL, error);
+}
+
+/**
+ * json字符串解析（可指定分配器与分配统计）
+ * 文档记住所用的分配器：之后的修改、克隆与 json_free 都使用同一个分配器，分配器须在文档释放前保持有效
+ * @param json
+ * @param options 可为 NULL
+ * @param error
+ * @return
+ */
+JsonValue json_parse_ex(const char *json, const JsonParseOptions *options, int *error) {
+    const JsonAllocator *allocator = resolve_allocator(options ? options->allocator : NULL);
+    ParserContext ctx = {.start = json, .pos = json, .allocator = allocator, .owner = root_owner(allocator),
+                         .stats = options ? options->stats : NULL, .flags = options ? options->flags : 0};
+#ifdef MJSON_STATS
+    JsonAllocStats local_stats = {0};
+    stats_parse_begin(&ctx, &local_stats);
+#endif
     int parse_error = JSON_SUCCESS;
     JsonValue result = parse_value(&ctx, &parse_error);
 
+    if (!parse_error) {
+        skip_whitespace(&ctx);
+        if (*ctx.pos != '\0') parse_error = JSON_INVALID;
+    }
+#ifdef MJSON_STATS
+    stats_parse_end(&ctx);
+#endif
     if (parse_error) {
-        json_free(&result);
+        free_value(&result, ctx.stats);
         *error = parse_error;
         return (JsonValue){0};
     }
 
-    skip_whitespace(&ctx);
-    if (*ctx.pos != '\0') {
-        json_free(&result);
-        *error = JSON_INVALID;
-    }
-
     *error = parse_error;
     return result;
 }
 
 void json_free(JsonValue *value) {
-    switch (value->type) {
+    free_value(value, NULL);
+}
+// ============================= 写时复制 start ================================
+
+/**
+ * 浅复制一个值：容器只增加存储块的共享计数，字符串重新复制；dst 为根节点，移入容器后用 slot_attach 挂接
+ * @param dst
+ * @param src
+ * @param a dst 所在文档的分配器，用于复制字符串
+ * @return
+ */
+static int value_share(JsonValue *dst, const JsonValue *src, const JsonAllocator *a) {
+    *dst = *src;
+    dst->owner = root_owner(a);
+    switch (src->type) {
         case JSON_STRING:
-            free(value->value.string_value);
-            break;
+            dst->value.string_value = mem_strdup(a, NULL, src->value.string_value);
+            return dst->value.string_value != NULL;
         case JSON_ARRAY:
-            for (size_t i = 0; i < value->value.array_value.ele_count; i++)
-                json_free(&value->value.array_value.elements[i]);
-            free(value->value.array_value.elements);
-            break;
+            block_retain(src->value.array_value.elements);
+            return 1;
         case JSON_OBJECT:
-            for (size_t i = 0; i < value->value.object_value.pair_count; i++) {
-                free(value->value.object_value.pairs[i].key);
-                json_free(&value->value.object_value.pairs[i].value);
-            }
-            free(value->value.object_value.pairs);
-            break;
-        default: break;
+            block_retain(src->value.object_value.pairs);
+            return 1;
+        case JSON_INT_ARRAY:
+        case JSON_INT64_ARRAY:
+        case JSON_FLOAT_ARRAY:
+        case JSON_DOUBLE_ARRAY:
+            block_retain(src->value.packed_value.data);
+            return 1;
+        default:
+            return 1;
     }
 }
+
 /**
- * 获取json值
- * @param obj
- * @param path
+ * 写时复制：为 jv 复制出一份独占的存储块（只复制这一层，子节点共享），释放对原存储块的持有。
+ * 副本使用原存储块的分配器
+ * @param jv
+ * @param min_capacity 新存储块的最小容量
  * @return
  */
-JsonValue *json_get(const JsonValue *obj, const char *path) {
-    if (!obj || !path) return NULL;
-    JsonValue *current = (JsonValue *)obj;
-    // strdup函数用于复制字符串的函数
-    char *token, *tmp = strdup(path);
-    char *saveptr = NULL;
-    // 分割路径为多级查询
-    for (token = strtok_r(tmp, ".", &saveptr); token; token = strtok_r(NULL, ".", &saveptr)) {
-        // 检查数组索引格式 [数字]
-        if (strchr(token, '[')) {
-            char *index_str = strtok(token, "[]");
-            if (!index_str) break;
-            // strtol() 函数用来将字符串转换为长整型数(long)
-            long  index = strtol(index_str, NULL, 10);
-            if (current->type != JSON_ARRAY || index < 0 || index >= (long int)current->value.array_value.ele_count) {
-                free(tmp);
-                return NULL;
+static int value_copy_block(JsonValue *jv, size_t min_capacity) {
+    if (jv->type == JSON_ARRAY) {
+        size_t count = jv->value.array_value.ele_count;
+        const JsonValue *src = jv->value.array_value.elements;
+        const JsonAllocator *a = BLOCK_OF((void *)src)->allocator;
+        size_t capacity = count > min_capacity ? count : min_capacity;
+        JsonValue *dst = block_reserve(a, NULL, NULL, sizeof(JsonValue), capacity ? capacity : 1);
+        if (!dst) return 0;
+        for (size_t i = 0; i < count; i++) {
+            if (!value_share(&dst[i], &src[i], a)) {
+                while (i > 0) json_free(&dst[--i]);
+                block_free(NULL, dst, sizeof(JsonValue));
+                return 0;
             }
-            current = &current->value.array_value.elements[index];
         }
-        // 处理对象键
-        else {
-            if (current->type != JSON_OBJECT) {
-                free(tmp);
-                return NULL;
+        JsonValue old = *jv;
+        jv->value.array_value.elements = dst;
+        value_adopt(jv);
+        json_free(&old);
+        return 1;
+    }
+    if (jv->type == JSON_OBJECT) {
+        size_t count = jv->value.object_value.pair_count;
+        const JsonPair *src = jv->value.object_value.pairs;
+        const JsonBlock *src_block = BLOCK_OF((void *)src);
+        const JsonAllocator *a = src_block->allocator;
+        size_t capacity = count > min_capacity ? count : min_capacity;
+        JsonPair *dst = block_reserve(a, NULL, NULL, sizeof(JsonPair), capacity ? capacity : 1);
+        if (!dst) return 0;
+        JsonBlock *block = BLOCK_OF(dst);
+        if (src_block->flags & BLOCK_INDEXED) {
+            block->order = mem_malloc(a, NULL, block->capacity * sizeof(uint32_t));
+            if (!block->order) {
+                block_free(NULL, dst, sizeof(JsonPair));
+                return 0;
             }
-            size_t i;
-            for (i = 0; i < current->value.object_value.pair_count; i++) {
-                // 比较两个字符串并根据比较结果返回整数
-                if (strcmp(current->value.object_value.pairs[i].key, token) == 0) {
-                    current = &current->value.object_value.pairs[i].value;
-                    break;
+            memcpy(block->order, src_block->order, count * sizeof(uint32_t));
+        }
+        block->flags = src_block->flags & (BLOCK_SORTED | BLOCK_INDEXED);
+
+        for (size_t i = 0; i < count; i++) {
+            dst[i].key = mem_strdup(a, NULL, src[i].key);
+            if (!dst[i].key || !value_share(&dst[i].value, &src[i].value, a)) {
+                mem_free_string(a, NULL, dst[i].key);
+                while (i > 0) {
+                    i--;
+                    mem_free_string(a, NULL, dst[i].key);
+                    json_free(&dst[i].value);
                 }
+                block_free(NULL, dst, sizeof(JsonPair));
+                return 0;
+            }
+        }
+        JsonValue old = *jv;
+        jv->value.object_value.pairs = dst;
+        value_adopt(jv);
+        json_free(&old);
+        return 1;
+    }
+    // 紧凑数组不会原地修改（展开时另建存储块），不需要复制
+    return 1;
+}
+
+/**
+ * 写时复制的单层部分：调用方已确认 jv 所在各层可写。
+ * jv 的存储块被其他克隆共享时复制一份；独占时丢弃序列化缓存并确认 jv 为其父节点。
+ * 冻结的存储块由冻结文档自身持有时返回 0，由克隆中复制出的上层持有时复制
+ * @param jv
+ * @param min_capacity 新存储块的最小容量
+ * @return
+ */
+static int value_unshare_block(JsonValue *jv, size_t min_capacity) {
+    void *data = value_block(jv);
+    if (!data) return 1;
+    if (block_flags(data) & BLOCK_FROZEN) {
+        return block_is_primary(data, jv) ? 0 : value_copy_block(jv, min_capacity);
+    }
+    if (block_is_shared(data)) return value_copy_block(jv, min_capacity);
+    block_drop_cache(data);
+    atomic_store_explicit(&BLOCK_OF(data)->parent, owner_block(jv), memory_order_relaxed);
+    atomic_store_explicit(&BLOCK_OF(data)->nested, false, memory_order_relaxed);
+    return 1;
+}
+
+/**
+ * 写时复制：所有修改接口在写入容器前调用。jv 位于共享或冻结的存储块中时返回 0，
+ * 否则按 value_unshare_block 使 jv 的存储块变为独占
+ * @param jv
+ * @param min_capacity 新存储块的最小容量
+ * @return
+ */
+static int value_unshare(JsonValue *jv, size_t min_capacity) {
+    return value_chain_writable(jv) && value_unshare_block(jv, min_capacity);
+}
+
+/**
+ * 克隆文档：与源文档共享全部子树，O(1)；之后任一方通过修改接口写入时才复制被修改的那一层。
+ * 嵌套节点需通过 json_get_mut 取得后再修改：json_get/array_get 返回的指针位于共享的存储块中，
+ * 修改接口对其返回失败。克隆使用源文档的分配器
+ * @param src
+ * @param error
+ * @return
+ */
+JsonValue json_clone(const JsonValue* src, int* error) {
+    JsonValue result = {.type = JSON_NULL};
+    if (!src) {
+        *error = JSON_INVALID;
+        return result;
+    }
+    if (!value_share(&result, src, value_allocator(src))) {
+        *error = JSON_MEM_ERROR;
+        return (JsonValue){0};
+    }
+    // 冻结文档的根存储块保持独占（仍拒绝修改），克隆立即复制根这一层，之后可以修改
+    if ((block_flags(value_block(src)) & BLOCK_FROZEN) && !value_copy_block(&result, 0)) {
+        json_free(&result);
+        *error = JSON_MEM_ERROR;
+        return (JsonValue){0};
+    }
+    *error = JSON_SUCCESS;
+    return result;
+}
+
+/**
+ * 按长度为 len 的键查找，不要求键以 NUL 结尾
+ */
+static int find_key_index_n(const JsonValue* obj, const char* key, size_t len) {
+    if (!obj || obj->type != JSON_OBJECT) return -1;
+
+    const JsonPair *pairs = obj->value.object_value.pairs;
+    size_t count = obj->value.object_value.pair_count;
+    unsigned int flags = block_flags(pairs);
+    if (flags & (BLOCK_SORTED | BLOCK_INDEXED)) {
+        const uint32_t *order = (flags & BLOCK_INDEXED) ? BLOCK_OF(pairs)->order : NULL;
+        size_t low = 0, high = count;
+        while (low < high) {
+            size_t mid = low + (high - low) / 2;
+            const char *mid_key = sorted_key_at(pairs, order, mid);
+            int cmp = strncmp(key, mid_key, len);
+            if (cmp == 0 && mid_key[len]) cmp = -1;
+            if (cmp <= 0) high = mid;
+            else low = mid + 1;
+        }
+        if (low < count) {
+            const char *found = sorted_key_at(pairs, order, low);
+            if (strncmp(key, found, len) == 0 && found[len] == '\0') {
+                return order ? (int)order[low] : (int)low;
+            }
+        }
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (strncmp(pairs[i].key, key, len) == 0 && pairs[i].key[len] == '\0') {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * 路径解析，不分配内存。语法 "a.b[2].c"，下标可紧跟在键后，也可写作 "a.[2]"
+ * @param current
+ * @param path
+ * @param len 只解析 path 的前 len 个字符
+ * @param unshare 为 true 时沿途复制被共享的存储块，返回的节点可以直接修改
+ * @return
+ */
+static JsonValue *path_resolve(JsonValue *current, const char *path, size_t len, bool unshare) {
+    const char *p = path;
+    const char *end = path + len;
+    if (unshare && !value_chain_writable(current)) return NULL;
+    while (p < end && current) {
+        if (*p == '.') {
+            p++;
+            continue;
+        }
+        if (unshare && !value_unshare_block(current, 0)) return NULL;
+        if (*p == '[') {
+            char *close;
+            unsigned long index = strtoul(p + 1, &close, 10);
+            if (close == p + 1 || close >= end || *close != ']' || current->type != JSON_ARRAY ||
+                index >= current->value.array_value.ele_count) {
+                return NULL;
             }
+            current = &current->value.array_value.elements[index];
+            p = close + 1;
+            continue;
         }
+        const char *key = p;
+        while (p < end && *p != '.' && *p != '[') p++;
+        int index = find_key_index_n(current, key, (size_t)(p - key));
+        if (index < 0) return NULL;
+        current = &current->value.object_value.pairs[index].value;
     }
-    free(tmp);
     return current;
 }
 
+// ============================= 写时复制 end ================================
+
+/**
+ * 获取json值
+ * @param obj
+ * @param path
+ * @return
+ */
+JsonValue *json_get(const JsonValue *obj, const char *path) {
+    if (!obj || !path) return NULL;
+    return path_resolve((JsonValue *)obj, path, strlen(path), false);
+}
+
+/**
+ * 获取用于修改的json值：沿路径把与克隆共享的存储块复制为独占，返回的节点可直接传给修改接口
+ * @param obj
+ * @param path
+ * @return
+ */
+JsonValue *json_get_mut(JsonValue *obj, const char *path) {
+    if (!obj || !path) return NULL;
+    return path_resolve(obj, path, strlen(path), true);
+}
+
 
-// 解析路径字符串，拆分为层级结构
+// 解析路径字符串，拆分为层级结构（可重入，不使用 strtok）
 char** parse_path(const char* path, int* depth) {
-    char* token;
+    const char* delims = ".[]";
     char** parts = NULL;
-    char* path_copy = strdup(path);
     *depth = 0;
 
-    token = strtok(path_copy, ".[]");
-    while (token != NULL) {
-        parts = realloc(parts, (*depth + 1) * sizeof(char*));
-        parts[*depth] = strdup(token);
-        (*depth)++;
-        token = strtok(NULL, ".[]");
+    const char* p = path + strspn(path, delims);
+    while (*p) {
+        size_t len = strcspn(p, delims);
+        char** grown = json_realloc(parts, (*depth + 1) * sizeof(char*));
+        char* token = grown ? json_malloc(len + 1) : NULL;
+        if (grown) parts = grown;
+        if (!token) {
+            while (*depth > 0) json_mem_free(parts[--(*depth)]);
+            json_mem_free(parts);
+            return NULL;
+        }
+        memcpy(token, p, len);
+        token[len] = '\0';
+        parts[(*depth)++] = token;
+        p += len;
+        p += strspn(p, delims);
     }
-
-    free(path_copy);
     return parts;
 }
 
@@ -473,37 +1729,32 @@ char** parse_path(const char* path, int* depth) {
  * @return
  */
 JsonValue* create_bool(bool val) {
-    JsonValue *jv = malloc(sizeof(JsonValue));
-    jv->type = JSON_BOOL;
-    jv->value.bool_value = val;
+    JsonValue *jv = json_malloc(sizeof(JsonValue));
+    *jv = (JsonValue){.type = JSON_BOOL, .value.bool_value = val};
     return jv;
 }
 
 JsonValue* create_int(int val) {
-    JsonValue *jv = malloc(sizeof(JsonValue));
-    jv->type = JSON_INT;
-    jv->value.int_value = val;
+    JsonValue *jv = json_malloc(sizeof(JsonValue));
+    *jv = (JsonValue){.type = JSON_INT, .value.int_value = val};
     return jv;
 }
 
 JsonValue* create_float(float val) {
-    JsonValue *jv = malloc(sizeof(JsonValue));
-    jv->type = JSON_FLOAT;
-    jv->value.float_value = val;
+    JsonValue *jv = json_malloc(sizeof(JsonValue));
+    *jv = (JsonValue){.type = JSON_FLOAT, .value.float_value = val};
     return jv;
 }
 
 JsonValue* create_double(double val) {
-    JsonValue *jv = malloc(sizeof(JsonValue));
-    jv->type = JSON_DOUBLE;
-    jv->value.double_value = val;
+    JsonValue *jv = json_malloc(sizeof(JsonValue));
+    *jv = (JsonValue){.type = JSON_DOUBLE, .value.double_value = val};
     return jv;
 }
 
 JsonValue* create_string(const char* val) {
-    JsonValue *jv = malloc(sizeof(JsonValue));
-    jv->type = JSON_STRING;
-    jv->value.string_value = strdup(val); // 存储原始字符串;
+    JsonValue *jv = json_malloc(sizeof(JsonValue));
+    *jv = (JsonValue){.type = JSON_STRING, .value.string_value = json_strdup(val)}; // 存储原始字符串
     return jv;
 }
 
@@ -512,11 +1763,9 @@ JsonValue* create_string(const char* val) {
  * @return
  */
 JsonValue* create_array() {
-    JsonValue* jv = malloc(sizeof(JsonValue));
+    JsonValue* jv = json_malloc(sizeof(JsonValue));
     if (!jv) return NULL;
-    jv->type = JSON_ARRAY;
-    jv->value.array_value.elements = NULL;
-    jv->value.array_value.ele_count = 0;
+    *jv = (JsonValue){.type = JSON_ARRAY, .value.array_value = {NULL, 0}};
     return jv;
 }
 
@@ -525,76 +1774,161 @@ JsonValue* create_array() {
  * @return
  */
 JsonValue* create_object() {
-    JsonValue *jv = malloc(sizeof(JsonValue));
+    JsonValue *jv = json_malloc(sizeof(JsonValue));
     if (!jv) return NULL;
-    jv->type = JSON_OBJECT;
-    jv->value.object_value.pairs = NULL;
-    jv->value.object_value.pair_count = 0;
+    *jv = (JsonValue){.type = JSON_OBJECT, .value.object_value = {NULL, 0}};
     return jv;
 }
 
 /**
- * 数组追加元素
+ * 数组扩容到至少 min_count 个元素
  * @param array
- * @param element
+ * @param min_count
  * @return
  */
-int array_append(JsonValue* array, JsonValue* element) {
-    if (!array || array->type != JSON_ARRAY) return 0;
-    size_t new_count = array->value.array_value.ele_count + 1;
-    JsonValue* new_elements = realloc(
-            array->value.array_value.elements,
-            sizeof(JsonValue*) * new_count
-    );
-
-    if (!new_elements) return 0;
-    new_elements[new_count-1] = *element;
-    array->value.array_value.elements = new_elements;
-    array->value.array_value.ele_count = new_count;
+static int array_grow(JsonValue* array, size_t min_count) {
+    if (!value_unshare(array, min_count)) return 0;
+    JsonValue* old = array->value.array_value.elements;
+    JsonValue* elements = block_reserve(node_allocator(array), NULL, old, sizeof(JsonValue), min_count);
+    if (!elements) return 0;
+    array->value.array_value.elements = elements;
+    if (elements != old) value_adopt(array);
+    return 1;
+}
+
+static int object_grow(JsonValue* obj, size_t min_count) {
+    if (!value_unshare(obj, min_count)) return 0;
+    JsonPair* old = obj->value.object_value.pairs;
+    if (!pairs_reserve(node_allocator(obj), NULL, obj, min_count)) return 0;
+    if (obj->value.object_value.pairs != old) value_adopt(obj);
     return 1;
 }
 
 /**
- * 对象添加键值对
- * @param obj
- * @param key
- * @param value
- * @return
+ * 有序对象中新键应插入的位置；无序对象追加到末尾
  */
-int object_add_pair(JsonValue* obj, const char* key, JsonValue* value) {
-    if (!obj || obj->type != JSON_OBJECT || !key) return 0;
-    size_t new_count = obj->value.object_value.pair_count + 1;
-    JsonPair* new_pairs = realloc(
-            obj->value.object_value.pairs,
-            sizeof(JsonPair) * new_count
-    );
-    if (!new_pairs) return 0;
-    char* key_copy = strdup(key);
-    if (!key_copy) return 0;
-    new_pairs[new_count-1] = (JsonPair){ key_copy, *value};
-    obj->value.object_value.pairs = new_pairs;
+static size_t object_append_position(const JsonValue* obj, const char* key) {
+    const JsonPair* pairs = obj->value.object_value.pairs;
+    size_t count = obj->value.object_value.pair_count;
+    if (block_flags(pairs) & BLOCK_SORTED) {
+        return sorted_bound(pairs, NULL, count, key, true);
+    }
+    return count;
+}
+
+/**
+ * 在 index 处插入键为 key（接管所有权）、值为 JSON_NULL 的键值对，并维护对象的排序状态
+ * @return 新键值对，失败返回 NULL（key 未被接管）
+ */
+static JsonPair* object_insert_slot(JsonValue* obj, size_t index, char* key) {
+    size_t count = obj->value.object_value.pair_count;
+    if (count >= UINT32_MAX || !object_grow(obj, count + 1)) return NULL;
+    JsonPair* pairs = obj->value.object_value.pairs;
+    JsonBlock* block = BLOCK_OF(pairs);
+
+    // 指定位置破坏了键序时退化为无序对象
+    if ((block->flags & BLOCK_SORTED) &&
+        ((index > 0 && strcmp(pairs[index-1].key, key) > 0) ||
+         (index < count && strcmp(key, pairs[index].key) > 0))) {
+        block->flags &= ~BLOCK_SORTED;
+    }
+
+    // 移动插入点之后的键值对
+    memmove(&pairs[index+1],
+            &pairs[index],
+            sizeof(JsonPair) * (count - index));
+    pairs[index] = (JsonPair){ key, {.type = JSON_NULL, .owner = pairs} };
+
+    if (block->flags & BLOCK_INDEXED) {
+        uint32_t* order = block->order;
+        for (size_t r = 0; r < count; r++) {
+            if (order[r] >= index) order[r]++;
+        }
+        // 相同键按原始位置排列
+        size_t rank = sorted_bound(pairs, order, count, key, false);
+        while (rank < count && order[rank] < index && strcmp(pairs[order[rank]].key, key) == 0) rank++;
+        memmove(&order[rank+1], &order[rank], sizeof(uint32_t) * (count - rank));
+        order[rank] = (uint32_t)index;
+    }
+    obj->value.object_value.pair_count = count + 1;
+    return &pairs[index];
+}
+
+/**
+ * 移除 index 处的键值对并维护排序状态，返回被移除的键值对（所有权交给调用方）
+ */
+static JsonPair object_remove_slot(JsonValue* obj, size_t index) {
+    JsonPair* pairs = obj->value.object_value.pairs;
+    JsonBlock* block = BLOCK_OF(pairs);
+    JsonPair removed = pairs[index];
+    const size_t new_count = obj->value.object_value.pair_count - 1;
+
+    if (block->flags & BLOCK_INDEXED) {
+        uint32_t* order = block->order;
+        size_t out = 0;
+        for (size_t r = 0; r <= new_count; r++) {
+            if (order[r] == index) continue;
+            order[out++] = order[r] > index ? order[r] - 1 : order[r];
+        }
+    }
+
+    // 移动后续键值对
+    memmove(&pairs[index],
+            &pairs[index+1],
+            sizeof(JsonPair) * (new_count - index));
     obj->value.object_value.pair_count = new_count;
+    return removed;
+}
+
+/**
+ * 数组追加元素
+ * @param array
+ * @param element
+ * @return
+ */
+int array_append(JsonValue* array, JsonValue* element) {
+    if (!array || array->type != JSON_ARRAY) return 0;
+    size_t new_count = array->value.array_value.ele_count + 1;
+    if (!array_grow(array, new_count)) return 0;
+    JsonValue* elements = array->value.array_value.elements;
+    elements[new_count-1] = *element;
+    slot_attach(&elements[new_count-1], elements);
+    array->value.array_value.ele_count = new_count;
     return 1;
 }
 
+/**
+ * 对象添加键值对
+ * @param obj
+ * @param key
+ * @param value
+ * @return
+ */
+int object_add_pair(JsonValue* obj, const char* key, JsonValue* value) {
+    if (!obj || obj->type != JSON_OBJECT || !key) return 0;
+    return object_insert_at(obj, object_append_position(obj, key), key, value);
+}
+
 
 /**
- * 批量添加
+ * 批量添加：按位复制各元素，容器接管其内容，源节点不置空（移动语义见 array_append_move）
  * @param arr
  * @param elements
  * @param num
+ * @return
  */
-void batch_append(JsonValue* arr, JsonValue** elements, size_t num) {
-    size_t new_count = arr->value.array_value.ele_count + num;
-    JsonValue** new_elements = realloc(
-            arr->value.array_value.elements,
-            sizeof(JsonValue*) * new_count
-    );
+int batch_append(JsonValue* arr, JsonValue** elements, size_t num) {
+    if (!arr || arr->type != JSON_ARRAY) return 0;
+    size_t count = arr->value.array_value.ele_count;
+    if (!array_grow(arr, count + num)) return 0;
 
-    memcpy(&new_elements[arr->value.array_value.ele_count],
-           elements,
-           sizeof(JsonValue*) * num);
-    arr->value.array_value.ele_count = new_count;
+    JsonValue* dst = arr->value.array_value.elements;
+    for (size_t i = 0; i < num; i++) {
+        dst[count + i] = *elements[i];
+        slot_attach(&dst[count + i], dst);
+    }
+    arr->value.array_value.ele_count = count + num;
+    return 1;
 }
 
 int array_insert_at(JsonValue* array, size_t index, JsonValue* element) {
@@ -602,19 +1936,16 @@ int array_insert_at(JsonValue* array, size_t index, JsonValue* element) {
     if (index > array->value.array_value.ele_count) return 0;
 
     const size_t new_count = array->value.array_value.ele_count + 1;
-    JsonValue** new_elements = realloc(
-            array->value.array_value.elements,
-            sizeof(JsonValue*) * new_count
-    );
-    if (!new_elements) return 0;
+    if (!array_grow(array, new_count)) return 0;
+    JsonValue* elements = array->value.array_value.elements;
 
     // 移动插入点之后的元素
-    memmove(&new_elements[index+1],
-            &new_elements[index],
-            sizeof(JsonValue*) * (array->value.array_value.ele_count - index));
+    memmove(&elements[index+1],
+            &elements[index],
+            sizeof(JsonValue) * (array->value.array_value.ele_count - index));
 
-    new_elements[index] = element;
-    array->value.array_value.elements = *new_elements;
+    elements[index] = *element;
+    slot_attach(&elements[index], elements);
     array->value.array_value.ele_count = new_count;
     return 1;
 }
@@ -623,26 +1954,17 @@ int object_insert_at(JsonValue* obj, size_t index, const char* key, JsonValue* v
     if (!obj || obj->type != JSON_OBJECT || !key) return 0;
     if (index > obj->value.object_value.pair_count) return 0;
 
-    const size_t new_count = obj->value.object_value.pair_count + 1;
-    JsonPair* new_pairs = realloc(
-            obj->value.object_value.pairs,
-            sizeof(JsonPair) * new_count
-    );
-    if (!new_pairs) return 0;
-
-    // 移动插入点之后的键值对
-    memmove(&new_pairs[index+1],
-            &new_pairs[index],
-            sizeof(JsonPair) * (obj->value.object_value.pair_count - index));
-
-    char* key_copy = strdup(key);
-    if (!key_copy) {
-        free(new_pairs); // 回滚内存分配
+    // 键与值槽位于同一存储块，由对象的分配器分配
+    const JsonAllocator* a = node_allocator(obj);
+    char* key_copy = mem_strdup(a, NULL, key);
+    if (!key_copy) return 0;
+    JsonPair* pair = object_insert_slot(obj, index, key_copy);
+    if (!pair) {
+        mem_free_string(a, NULL, key_copy); // 回滚内存分配
         return 0;
     }
-    new_pairs[index] = (JsonPair){ key_copy, *value };
-    obj->value.object_value.pairs = new_pairs;
-    obj->value.object_value.pair_count = new_count;
+    pair->value = *value;
+    slot_attach(&pair->value, obj->value.object_value.pairs);
     return 1;
 }
 /**
@@ -657,8 +1979,38 @@ JsonValue* array_get(JsonValue* arr, size_t index) {
            &arr->value.array_value.elements[index] :
            NULL;
 }
+
+/**
+ * 获取用于修改的数组元素：数组存储块与克隆共享时先复制
+ * @param arr
+ * @param index
+ * @return
+ */
+JsonValue* array_get_mut(JsonValue* arr, size_t index) {
+    CHECK_TYPE(arr, JSON_ARRAY);
+    if (index >= arr->value.array_value.ele_count || !value_unshare(arr, 0)) return NULL;
+    return &arr->value.array_value.elements[index];
+}
+
+/**
+ * 按长度为 len 的键查找对象成员，键不要求以 NUL 结尾
+ * @param obj
+ * @param key
+ * @param len
+ * @return
+ */
+JsonValue* object_get_n(const JsonValue* obj, const char* key, size_t len) {
+    int index = key ? find_key_index_n(obj, key, len) : -1;
+    return index < 0 ? NULL : &obj->value.object_value.pairs[index].value;
+}
+
+JsonValue* object_get_mut_n(JsonValue* obj, const char* key, size_t len) {
+    int index = key ? find_key_index_n(obj, key, len) : -1;
+    if (index < 0 || !value_unshare(obj, 0)) return NULL;
+    return &obj->value.object_value.pairs[index].value;
+}
 /**
- * ‌批量插入
+ * ‌批量插入：同 batch_append，源节点不置空
  * @param array
  * @param index
  * @param elements
@@ -670,23 +2022,20 @@ int array_insert_batch(JsonValue* array, size_t index, JsonValue** elements, siz
     if (index > array->value.array_value.ele_count) return 0;
 
     const size_t new_count = array->value.array_value.ele_count + num;
-    JsonValue** new_elements = realloc(
-            array->value.array_value.elements,
-            sizeof(JsonValue*) * new_count
-    );
-    if (!new_elements) return 0;
+    if (!array_grow(array, new_count)) return 0;
+    JsonValue* dst = array->value.array_value.elements;
 
     // 移动现有元素
-    memmove(&new_elements[index+num],
-            &new_elements[index],
-            sizeof(JsonValue*) * (array->value.array_value.ele_count - index));
+    memmove(&dst[index+num],
+            &dst[index],
+            sizeof(JsonValue) * (array->value.array_value.ele_count - index));
 
     // 拷贝新元素
-    memcpy(&new_elements[index],
-           elements,
-           sizeof(JsonValue*) * num);
+    for (size_t i = 0; i < num; i++) {
+        dst[index + i] = *elements[i];
+        slot_attach(&dst[index + i], dst);
+    }
 
-    array->value.array_value.elements = *new_elements;
     array->value.array_value.ele_count = new_count;
     return 1;
 }
@@ -698,6 +2047,11 @@ int array_insert_batch(JsonValue* array, size_t index, JsonValue** elements, siz
  * @return
  */
 int object_insert_sorted(JsonValue* obj, const char* key, JsonValue* value) {
+    if (!obj || obj->type != JSON_OBJECT || !key) return 0;
+    // 保持原始顺序的对象由索引维护键序，直接追加
+    if (block_flags(obj->value.object_value.pairs) & BLOCK_INDEXED) {
+        return object_insert_at(obj, obj->value.object_value.pair_count, key, value);
+    }
     // 二分查找插入位置
     size_t low = 0, high = obj->value.object_value.pair_count;
     while (low < high) {
@@ -718,12 +2072,17 @@ int object_insert_sorted(JsonValue* obj, const char* key, JsonValue* value) {
  */
 JsonValue* array_replace_at(JsonValue* array, size_t index, JsonValue* new_element) {
     if (!array || array->type != JSON_ARRAY) return NULL;
-    if (index >= array->value.array_value.ele_count) return NULL;
+    const size_t count = array->value.array_value.ele_count;
+    if (index >= count) return NULL;
+    // 预留一个空槽暂存旧元素（同 array_remove_at），直到下一次修改数组前有效
+    if (!array_grow(array, count + 1)) return NULL;
 
     JsonValue* elements = array->value.array_value.elements;
-    JsonValue* old = &elements[index];
+    elements[count] = elements[index];
+    value_detach(&elements[count]);
     elements[index] = *new_element;
-    return old;
+    slot_attach(&elements[index], elements);
+    return &elements[count];
 }
 
 /**
@@ -735,40 +2094,22 @@ JsonValue* array_replace_at(JsonValue* array, size_t index, JsonValue* new_eleme
 JsonValue* array_remove_at(JsonValue* array, size_t index) {
     if (!array || array->type != JSON_ARRAY) return NULL;
     if (index >= array->value.array_value.ele_count) return NULL;
+    if (!value_unshare(array, 0)) return NULL;
 
     JsonValue* elements = array->value.array_value.elements;
-    JsonValue* removed = &elements[index];
+    JsonValue removed = elements[index];
     const size_t new_count = array->value.array_value.ele_count - 1;
 
     // 移动后续元素
     memmove(&elements[index],
             &elements[index+1],
-            sizeof(JsonValue*) * (new_count - index));
-
-    // 缩小内存分配
-    JsonValue** new_elements = realloc(elements, sizeof(JsonValue*) * new_count);
-    if (new_elements || new_count == 0) { // 允许realloc(0)返回NULL
-        array->value.array_value.elements = *new_elements;
-        array->value.array_value.ele_count = new_count;
-    }
-    return removed;
-}
-
-/**
- * 查找键对应的索引
- * @param obj
- * @param key
- * @return
- */
-static int find_key_index(const JsonValue* obj, const char* key) {
-    if (!obj || obj->type != JSON_OBJECT) return -1;
+            sizeof(JsonValue) * (new_count - index));
 
-    for (size_t i = 0; i < obj->value.object_value.pair_count; ++i) {
-        if (strcmp(obj->value.object_value.pairs[i].key, key) == 0) {
-            return i;
-        }
-    }
-    return -1;
+    // 不缩小内存分配：被删除元素暂存到末尾空槽，直到下一次修改数组前有效
+    elements[new_count] = removed;
+    value_detach(&elements[new_count]);
+    array->value.array_value.ele_count = new_count;
+    return &elements[new_count];
 }
 
 /**
@@ -781,11 +2122,16 @@ static int find_key_index(const JsonValue* obj, const char* key) {
 JsonValue* object_update(JsonValue* obj, const char* key, JsonValue* new_value) {
     int index = find_key_index(obj, key);
     if (index == -1) return NULL;
+    // 同 array_replace_at：旧值暂存到末尾空槽
+    const size_t count = obj->value.object_value.pair_count;
+    if (!object_grow(obj, count + 1)) return NULL;
 
     JsonPair* pairs = obj->value.object_value.pairs;
-    JsonValue* old = &pairs[index].value;
+    pairs[count] = (JsonPair){NULL, pairs[index].value};
+    value_detach(&pairs[count].value);
     pairs[index].value = *new_value;
-    return old;
+    slot_attach(&pairs[index].value, pairs);
+    return &pairs[count].value;
 }
 
 /**
@@ -796,28 +2142,60 @@ JsonValue* object_update(JsonValue* obj, const char* key, JsonValue* new_value)
  */
 JsonValue* object_remove(JsonValue* obj, const char* key) {
     int index = find_key_index(obj, key);
-    if (index == -1) return NULL;
+    if (index == -1 || !value_unshare(obj, 0)) return NULL;
 
-    JsonPair* pairs = obj->value.object_value.pairs;
-    JsonValue* removed = &pairs[index].value;
-    const size_t new_count = obj->value.object_value.pair_count - 1;
+    JsonPair removed = object_remove_slot(obj, index);
+    const size_t new_count = obj->value.object_value.pair_count;
 
     // 释放键内存
-    free(pairs[index].key);
+    mem_free_string(node_allocator(obj), NULL, removed.key);
+    removed.key = NULL;
 
-    // 移动后续键值对
-    memmove(&pairs[index],
-            &pairs[index+1],
-            sizeof(JsonPair) * (new_count - index));
+    // 同 array_remove_at：被删除的值暂存到末尾空槽
+    JsonPair* pairs = obj->value.object_value.pairs;
+    pairs[new_count] = removed;
+    value_detach(&pairs[new_count].value);
+    return &pairs[new_count].value;
+}
+/**
+ * 整数格式化，结果与 "%lld" 一致
+ * @param buf 为 NULL 时只计算长度
+ * @param val
+ * @return 写入（或需要）的字符数
+ */
+static int format_int64(char* buf, int64_t val) {
+    char tmp[24];
+    int len = 0;
+    uint64_t abs_val = val < 0 ? (uint64_t)0 - (uint64_t)val : (uint64_t)val;
+    do {
+        tmp[len++] = (char)('0' + abs_val % 10);
+        abs_val /= 10;
+    } while (abs_val);
+    if (val < 0) tmp[len++] = '-';
+    if (buf) {
+        for (int i = 0; i < len; i++) buf[i] = tmp[len - 1 - i];
+    }
+    return len;
+}
 
-    // 调整内存分配
-    JsonPair* new_pairs = realloc(pairs, sizeof(JsonPair) * new_count);
-    if (new_pairs || new_count == 0) {
-        obj->value.object_value.pairs = new_pairs;
-        obj->value.object_value.pair_count = new_count;
+/**
+ * 紧凑数组第 i 个元素的格式化，与对应标量类型的输出一致
+ * @param buf 为 NULL 时只计算长度
+ */
+static int format_packed_elem(char* buf, const JsonValue* jv, size_t i) {
+    const void* data = jv->value.packed_value.data;
+    switch (jv->type) {
+        case JSON_INT_ARRAY:   return format_int64(buf, ((const int32_t*)data)[i]);
+        case JSON_INT64_ARRAY: return format_int64(buf, ((const int64_t*)data)[i]);
+        case JSON_FLOAT_ARRAY:
+            return buf ? sprintf(buf, "%.6g", ((const float*)data)[i])
+                       : snprintf(NULL, 0, "%.6g", ((const float*)data)[i]);
+        default:
+            return buf ? sprintf(buf, "%.14g", ((const double*)data)[i])
+                       : snprintf(NULL, 0, "%.14g", ((const double*)data)[i]);
     }
-    return removed;
 }
+
 /**
  * 计算所需字符串长度
  * @param jv
@@ -829,7 +2207,8 @@ static int json_value_length(const JsonValue* jv) {
     switch (jv->type) {
         case JSON_NULL:   return 4; // "null"
         case JSON_BOOL:   return jv->value.bool_value ? 4 : 5; // "true"/"false"
-        case JSON_INT:    return snprintf(NULL, 0, "%d", jv->value.int_value);
+        case JSON_INT:    return format_int64(NULL, jv->value.int_value);
+        case JSON_INT64:  return format_int64(NULL, jv->value.int64_value);
         case JSON_FLOAT:  return snprintf(NULL, 0, "%.6g", jv->value.float_value);
         case JSON_DOUBLE: return snprintf(NULL, 0, "%.14g", jv->value.double_value);
         case JSON_STRING: return strlen(jv->value.string_value) + 2; // 引号
@@ -837,13 +2216,6 @@ static int json_value_length(const JsonValue* jv) {
         case JSON_ARRAY: {
             int length = 2; // []
             for (size_t i = 0; i < jv->value.array_value.ele_count; ++i) {
-                //JsonValue* arr = create_array();
-                //array_append(arr, create_int(42));
-                printf("jv ->: %d\n", jv->value.array_value.elements[i].value.int_value);
-
-                JsonValue arr = jv->value.array_value.elements[i];
-                printf("arr ->: %d\n", arr.value.int_value);
-
                 int elem_len = json_value_length(&jv->value.array_value.elements[i]);
                 if (elem_len < 0) return -1;
                 length += elem_len + 1; // 元素+逗号
@@ -865,6 +2237,18 @@ static int json_value_length(const JsonValue* jv) {
             if (jv->value.object_value.pair_count > 0) length--; // 去掉最后一个逗号
             return length;
         }
+
+        case JSON_INT_ARRAY:
+        case JSON_INT64_ARRAY:
+        case JSON_FLOAT_ARRAY:
+        case JSON_DOUBLE_ARRAY: {
+            size_t count = jv->value.packed_value.count;
+            int length = 2 + (count > 0 ? (int)count - 1 : 0); // [] + 逗号
+            for (size_t i = 0; i < count; ++i) {
+                length += format_packed_elem(NULL, jv, i);
+            }
+            return length;
+        }
     }
     return -1;
 }
@@ -873,18 +2257,27 @@ static int json_value_length(const JsonValue* jv) {
  * 序列化实现
  * @param buf
  * @param jv
- * @return
+ * @return 写入结束位置
  */
 static char* json_value_serialize(char* buf, const JsonValue* jv) {
     switch (jv->type) {
-        case JSON_NULL:  return strcpy(buf, "null");
-        case JSON_BOOL:  return strcpy(buf, jv->value.bool_value ? "true" : "false");
-        case JSON_INT:   return buf + sprintf(buf, "%d", jv->value.int_value);
+        case JSON_NULL:  memcpy(buf, "null", 4); return buf + 4;
+        case JSON_BOOL:
+            if (jv->value.bool_value) {
+                memcpy(buf, "true", 4);
+                return buf + 4;
+            }
+            memcpy(buf, "false", 5);
+            return buf + 5;
+        case JSON_INT:   return buf + format_int64(buf, jv->value.int_value);
+        case JSON_INT64: return buf + format_int64(buf, jv->value.int64_value);
         case JSON_FLOAT: return buf + sprintf(buf, "%.6g", jv->value.float_value);
         case JSON_DOUBLE:return buf + sprintf(buf, "%.14g", jv->value.double_value);
         case JSON_STRING: {
+            size_t len = strlen(jv->value.string_value);
             *buf++ = '"';
-            buf = strcpy(buf, jv->value.string_value);
+            memcpy(buf, jv->value.string_value, len);
+            buf += len;
             *buf++ = '"';
             return buf;
         }
@@ -905,9 +2298,11 @@ static char* json_value_serialize(char* buf, const JsonValue* jv) {
             *buf++ = '{';
             for (size_t i = 0; i < jv->value.object_value.pair_count; ++i) {
                 const JsonPair* pair = &jv->value.object_value.pairs[i];
+                size_t key_len = strlen(pair->key);
                 // 序列化key
                 *buf++ = '"';
-                buf = strcpy(buf, pair->key);
+                memcpy(buf, pair->key, key_len);
+                buf += key_len;
                 *buf++ = '"';
                 *buf++ = ':';
                 // 序列化value
@@ -919,21 +2314,4770 @@ static char* json_value_serialize(char* buf, const JsonValue* jv) {
             *buf++ = '}';
             return buf;
         }
+
+        case JSON_INT_ARRAY:
+        case JSON_INT64_ARRAY:
+        case JSON_FLOAT_ARRAY:
+        case JSON_DOUBLE_ARRAY: {
+            size_t count = jv->value.packed_value.count;
+            *buf++ = '[';
+            for (size_t i = 0; i < count; ++i) {
+                buf += format_packed_elem(buf, jv, i);
+                if (i != count - 1) {
+                    *buf++ = ',';
+                }
+            }
+            *buf++ = ']';
+            return buf;
+        }
     }
     return buf;
 }
 
 char* json_to_string(const JsonValue* jv) {
     if (!jv) return NULL;
+    STATS_NS(start_ns);
+    STATS_TICKS(start);
 
     int length = json_value_length(jv);
     if (length < 0) return NULL;
+    STATS_TICKS(measured);
 
-    char* result = malloc(length + 1);
+    char* result = json_malloc(length + 1);
     if (!result) return NULL;
 
-    json_value_serialize(result, jv);
+    char* end = json_value_serialize(result, jv);
+    *end = '\0';
+    STATS_SERIALIZED((size_t)length, start_ns, start, measured);
     return result;
 }
 
-// =============================  2025年3月26日 新增功能 end ================================
\ No newline at end of file
+// =============================  2025年3月26日 新增功能 end ================================
+
+// ============================= 节点池与原地构造 start ================================
+
+#define BUILDER_SLAB_NODES 256
+
+typedef union JsonPoolNode {
+    JsonValue value;
+    union JsonPoolNode *next;
+} JsonPoolNode;
+
+typedef struct JsonSlab {
+    struct JsonSlab *next;
+    JsonPoolNode nodes[BUILDER_SLAB_NODES];
+} JsonSlab;
+
+struct JsonBuilder {
+    JsonAllocator allocator;
+    JsonSlab *slabs;
+    size_t slab_used;       // 当前 slab 已分配的节点数
+    JsonPoolNode *free_list;
+};
+
+/**
+ * 创建构建器，节点从 slab 池中分配，池内存使用创建时的全局分配器
+ * @return
+ */
+JsonBuilder* json_builder_create(void) {
+    JsonBuilder *builder = json_malloc(sizeof(JsonBuilder));
+    if (!builder) return NULL;
+    builder->allocator = g_allocator;
+    builder->slabs = NULL;
+    builder->slab_used = BUILDER_SLAB_NODES;
+    builder->free_list = NULL;
+    return builder;
+}
+
+/**
+ * 销毁构建器，一次性归还所有 slab；节点内容需事先移入容器或通过 json_builder_release 释放
+ * @param builder
+ */
+void json_builder_destroy(JsonBuilder* builder) {
+    if (!builder) return;
+    JsonSlab *slab = builder->slabs;
+    while (slab) {
+        JsonSlab *next = slab->next;
+        mem_free(&builder->allocator, NULL, slab, sizeof(JsonSlab));
+        slab = next;
+    }
+    mem_free(&builder->allocator, NULL, builder, sizeof(JsonBuilder));
+}
+
+/**
+ * 从池中取一个节点，初始为 JSON_NULL
+ * @param builder
+ * @return
+ */
+JsonValue* json_builder_node(JsonBuilder* builder) {
+    if (!builder) return NULL;
+    JsonPoolNode *node = builder->free_list;
+    if (node) {
+        builder->free_list = node->next;
+    } else {
+        if (builder->slab_used == BUILDER_SLAB_NODES) {
+            JsonSlab *slab = mem_malloc(&builder->allocator, NULL, sizeof(JsonSlab));
+            if (!slab) return NULL;
+            slab->next = builder->slabs;
+            builder->slabs = slab;
+            builder->slab_used = 0;
+        }
+        node = &builder->slabs->nodes[builder->slab_used++];
+    }
+    node->value = (JsonValue){.type = JSON_NULL};
+    return &node->value;
+}
+
+/**
+ * 释放节点内容并将节点归还到空闲链表
+ * @param builder
+ * @param node
+ */
+void json_builder_release(JsonBuilder* builder, JsonValue* node) {
+    if (!builder || !node) return;
+    json_free(node);
+    JsonPoolNode *pool_node = (JsonPoolNode *)node;
+    pool_node->next = builder->free_list;
+    builder->free_list = pool_node;
+}
+
+/**
+ * 将池节点移入数组（转移所有权，不深拷贝），节点本身归还池
+ * @param builder
+ * @param array
+ * @param node
+ * @return
+ */
+int json_builder_append(JsonBuilder* builder, JsonValue* array, JsonValue* node) {
+    if (!builder || !node || !array_append(array, node)) return 0;
+    *node = (JsonValue){.type = JSON_NULL};
+    json_builder_release(builder, node);
+    return 1;
+}
+
+int json_builder_add_pair(JsonBuilder* builder, JsonValue* obj, const char* key, JsonValue* node) {
+    if (!builder || !node || !object_add_pair(obj, key, node)) return 0;
+    *node = (JsonValue){.type = JSON_NULL};
+    json_builder_release(builder, node);
+    return 1;
+}
+
+/**
+ * 在数组末尾原地构造一个 JSON_NULL 元素并返回其地址，之后用 json_set_* 赋值
+ * 返回的指针在下一次修改该数组前有效
+ * @param array
+ * @return
+ */
+JsonValue* array_emplace(JsonValue* array) {
+    if (!array || array->type != JSON_ARRAY) return NULL;
+    size_t count = array->value.array_value.ele_count;
+    if (!array_grow(array, count + 1)) return NULL;
+    JsonValue *slot = &array->value.array_value.elements[count];
+    *slot = (JsonValue){.type = JSON_NULL, .owner = array->value.array_value.elements};
+    array->value.array_value.ele_count = count + 1;
+    return slot;
+}
+
+/**
+ * 在对象末尾原地构造键值对，返回值槽地址
+ * @param obj
+ * @param key
+ * @return
+ */
+JsonValue* object_emplace(JsonValue* obj, const char* key) {
+    if (!obj || obj->type != JSON_OBJECT || !key) return NULL;
+    const JsonAllocator *a = node_allocator(obj);
+    char *key_copy = mem_strdup(a, NULL, key);
+    if (!key_copy) return NULL;
+    JsonPair *pair = object_insert_slot(obj, object_append_position(obj, key), key_copy);
+    if (!pair) {
+        mem_free_string(a, NULL, key_copy);
+        return NULL;
+    }
+    return &pair->value;
+}
+
+/**
+ * 原地赋值前的检查：节点所在各层可写（见 value_chain_writable），节点本身不是冻结容器的持有者；
+ * 通过后释放节点原有内容，节点保留所在位置
+ */
+static bool value_reset(JsonValue* jv) {
+    if (!jv || !value_chain_writable(jv)) return false;
+    void* data = value_block(jv);
+    if ((block_flags(data) & BLOCK_FROZEN) && block_is_primary(data, jv)) return false;
+    json_free(jv);
+    return true;
+}
+
+// 原地赋值，会先释放节点原有内容
+int json_set_null(JsonValue* jv) {
+    if (!value_reset(jv)) return 0;
+    *jv = (JsonValue){.type = JSON_NULL, .owner = jv->owner};
+    return 1;
+}
+
+int json_set_bool(JsonValue* jv, bool val) {
+    if (!value_reset(jv)) return 0;
+    *jv = (JsonValue){.type = JSON_BOOL, .value.bool_value = val, .owner = jv->owner};
+    return 1;
+}
+
+int json_set_int(JsonValue* jv, int val) {
+    if (!value_reset(jv)) return 0;
+    *jv = (JsonValue){.type = JSON_INT, .value.int_value = val, .owner = jv->owner};
+    return 1;
+}
+
+int json_set_float(JsonValue* jv, float val) {
+    if (!value_reset(jv)) return 0;
+    *jv = (JsonValue){.type = JSON_FLOAT, .value.float_value = val, .owner = jv->owner};
+    return 1;
+}
+
+int json_set_double(JsonValue* jv, double val) {
+    if (!value_reset(jv)) return 0;
+    *jv = (JsonValue){.type = JSON_DOUBLE, .value.double_value = val, .owner = jv->owner};
+    return 1;
+}
+
+int json_set_string(JsonValue* jv, const char* val) {
+    return val && json_set_string_n(jv, val, strlen(val));
+}
+
+/**
+ * 赋值长度为 len 的字符串，val 不要求以 NUL 结尾
+ */
+int json_set_string_n(JsonValue* jv, const char* val, size_t len) {
+    if (!jv || !val) return 0;
+    const JsonAllocator *a = value_allocator(jv);
+    char *copy = mem_malloc(a, NULL, len + 1);
+    if (!copy) return 0;
+    memcpy(copy, val, len);
+    copy[len] = '\0';
+    if (!value_reset(jv)) {
+        mem_free_string(a, NULL, copy);
+        return 0;
+    }
+    *jv = (JsonValue){.type = JSON_STRING, .value.string_value = copy, .owner = jv->owner};
+    return 1;
+}
+
+int json_set_array(JsonValue* jv) {
+    if (!value_reset(jv)) return 0;
+    *jv = (JsonValue){.type = JSON_ARRAY, .value.array_value = {NULL, 0}, .owner = jv->owner};
+    return 1;
+}
+
+int json_set_object(JsonValue* jv) {
+    if (!value_reset(jv)) return 0;
+    *jv = (JsonValue){.type = JSON_OBJECT, .value.object_value = {NULL, 0}, .owner = jv->owner};
+    return 1;
+}
+
+// ============================= 节点池与原地构造 end ================================
+
+
+// ============================= 批量构建 start ================================
+
+/**
+ * 预留数组容量，之后的追加在容量内不再分配内存
+ * @param array
+ * @param capacity
+ * @return
+ */
+int array_reserve(JsonValue* array, size_t capacity) {
+    if (!array || array->type != JSON_ARRAY) return 0;
+    return array_grow(array, capacity);
+}
+
+int object_reserve(JsonValue* obj, size_t capacity) {
+    if (!obj || obj->type != JSON_OBJECT) return 0;
+    return object_grow(obj, capacity);
+}
+
+/**
+ * 批量追加并转移所有权：values 中的元素按位移入数组，原位置被置为 JSON_NULL
+ * 整个批次只做一次容量预留，不做深拷贝
+ * @param array
+ * @param values
+ * @param num
+ * @return
+ */
+int array_append_move(JsonValue* array, JsonValue* values, size_t num) {
+    if (!array || array->type != JSON_ARRAY || (!values && num)) return 0;
+    size_t count = array->value.array_value.ele_count;
+    if (!array_grow(array, count + num)) return 0;
+
+    JsonValue* elements = array->value.array_value.elements;
+    memcpy(&elements[count], values, sizeof(JsonValue) * num);
+    for (size_t i = 0; i < num; i++) {
+        slot_attach(&elements[count + i], elements);
+        values[i] = (JsonValue){.type = JSON_NULL, .owner = values[i].owner};
+    }
+    array->value.array_value.ele_count = count + num;
+    return 1;
+}
+
+/**
+ * 用对象的分配器 a 复制 num 个键，失败时回滚已复制的键
+ */
+static char** copy_keys(const JsonAllocator* a, const char* const* keys, size_t num) {
+    char** copies = json_malloc(sizeof(char*) * (num ? num : 1));
+    if (!copies) return NULL;
+    for (size_t i = 0; i < num; i++) {
+        copies[i] = keys[i] ? mem_strdup(a, NULL, keys[i]) : NULL;
+        if (!copies[i]) {
+            while (i > 0) mem_free_string(a, NULL, copies[--i]);
+            json_mem_free(copies);
+            return NULL;
+        }
+    }
+    return copies;
+}
+
+/**
+ * 批量添加键值对：键被复制，值转移所有权（原位置置为 JSON_NULL）
+ * @param obj
+ * @param keys
+ * @param values
+ * @param num
+ * @return
+ */
+int object_add_pairs(JsonValue* obj, const char* const* keys, JsonValue* values, size_t num) {
+    if (!obj || obj->type != JSON_OBJECT || ((!keys || !values) && num)) return 0;
+    if (block_flags(obj->value.object_value.pairs) & BLOCK_SORTED) {
+        return object_insert_sorted_batch(obj, keys, values, num);
+    }
+    size_t count = obj->value.object_value.pair_count;
+    const JsonAllocator* a = node_allocator(obj);
+    char** key_copies = copy_keys(a, keys, num);
+    if (!key_copies) return 0;
+    if (!object_grow(obj, count + num)) {
+        for (size_t i = 0; i < num; i++) mem_free_string(a, NULL, key_copies[i]);
+        json_mem_free(key_copies);
+        return 0;
+    }
+
+    JsonPair* pairs = obj->value.object_value.pairs;
+    for (size_t i = 0; i < num; i++) {
+        pairs[count + i] = (JsonPair){key_copies[i], values[i]};
+        slot_attach(&pairs[count + i].value, pairs);
+        values[i] = (JsonValue){.type = JSON_NULL, .owner = values[i].owner};
+    }
+    obj->value.object_value.pair_count = count + num;
+    json_mem_free(key_copies);
+    // 保持原始顺序的对象重建按键索引，失败时退化为无序对象
+    if ((block_flags(pairs) & BLOCK_INDEXED) && !object_sort(a, NULL, obj, true)) {
+        BLOCK_OF(pairs)->flags &= ~BLOCK_INDEXED;
+    }
+    return 1;
+}
+
+typedef struct {
+    const char* key;
+    size_t index;
+} SortedKey;
+
+// 按键排序，键相同时按原下标保证稳定
+static int compare_sorted_key(const void* a, const void* b) {
+    const SortedKey* ka = a;
+    const SortedKey* kb = b;
+    int cmp = strcmp(ka->key, kb->key);
+    if (cmp != 0) return cmp;
+    return (ka->index > kb->index) - (ka->index < kb->index);
+}
+
+/**
+ * 批量有序插入：对象需已按键有序（如由 object_insert_sorted 构建），
+ * 新键值对先稳定排序，再从尾部与已有键值对归并，只做一次容量预留。
+ * 与 object_insert_sorted 一致，相同键的新值排在已有值之后；保持原始顺序（带索引）的对象
+ * 按给定顺序追加并重建索引；值转移所有权。
+ * @param obj
+ * @param keys
+ * @param values
+ * @param num
+ * @return
+ */
+int object_insert_sorted_batch(JsonValue* obj, const char* const* keys, JsonValue* values, size_t num) {
+    if (!obj || obj->type != JSON_OBJECT || ((!keys || !values) && num)) return 0;
+    if (num == 0) return 1;
+    // 与 object_insert_sorted 一致：键序由索引维护，物理上直接追加
+    if (block_flags(obj->value.object_value.pairs) & BLOCK_INDEXED) {
+        return object_add_pairs(obj, keys, values, num);
+    }
+
+    SortedKey* order = json_malloc(sizeof(SortedKey) * num);
+    if (!order) return 0;
+    for (size_t i = 0; i < num; i++) {
+        if (!keys[i]) {
+            json_mem_free(order);
+            return 0;
+        }
+        order[i] = (SortedKey){keys[i], i};
+    }
+    qsort(order, num, sizeof(SortedKey), compare_sorted_key);
+
+    const JsonAllocator* a = node_allocator(obj);
+    char** key_copies = copy_keys(a, keys, num);
+    if (!key_copies) {
+        json_mem_free(order);
+        return 0;
+    }
+    size_t count = obj->value.object_value.pair_count;
+    if (!object_grow(obj, count + num)) {
+        for (size_t i = 0; i < num; i++) mem_free_string(a, NULL, key_copies[i]);
+        json_mem_free(key_copies);
+        json_mem_free(order);
+        return 0;
+    }
+
+    // 从尾部归并，已有键值对只移动一次
+    JsonPair* pairs = obj->value.object_value.pairs;
+    size_t old_pos = count, new_pos = num, out = count + num;
+    while (new_pos > 0) {
+        const SortedKey* next = &order[new_pos - 1];
+        if (old_pos > 0 && strcmp(pairs[old_pos - 1].key, next->key) > 0) {
+            pairs[--out] = pairs[--old_pos];
+        } else {
+            pairs[--out] = (JsonPair){key_copies[next->index], values[next->index]};
+            slot_attach(&pairs[out].value, pairs);
+            new_pos--;
+        }
+    }
+    for (size_t i = 0; i < num; i++) {
+        values[i] = (JsonValue){.type = JSON_NULL, .owner = values[i].owner};
+    }
+    obj->value.object_value.pair_count = count + num;
+    json_mem_free(key_copies);
+    json_mem_free(order);
+    if ((block_flags(pairs) & BLOCK_INDEXED) && !object_sort(a, NULL, obj, true)) {
+        BLOCK_OF(pairs)->flags &= ~BLOCK_INDEXED;
+    }
+    return 1;
+}
+
+// ============================= 批量构建 end ================================
+
+// ============================= 有序对象 start ================================
+
+/**
+ * 将对象标记为按键有序，之后的查找、更新、删除使用二分查找
+ * @param obj
+ * @param keep_order true 时键值对保持原始顺序（序列化顺序不变），额外维护按键排序的下标索引
+ * @return
+ */
+int json_object_sort(JsonValue* obj, bool keep_order) {
+    if (!obj || obj->type != JSON_OBJECT || !value_unshare(obj, 0)) return 0;
+    JsonPair* old = obj->value.object_value.pairs;
+    if (!object_sort(node_allocator(obj), NULL, obj, keep_order)) return 0;
+    // 空对象新建了存储块
+    if (obj->value.object_value.pairs != old) value_adopt(obj);
+    return 1;
+}
+
+bool json_object_is_sorted(const JsonValue* obj) {
+    if (!obj || obj->type != JSON_OBJECT) return false;
+    return (block_flags(obj->value.object_value.pairs) & (BLOCK_SORTED | BLOCK_INDEXED)) != 0;
+}
+
+// ============================= 有序对象 end ================================
+
+// ============================= 紧凑数值数组访问 start ================================
+
+bool json_is_packed_array(const JsonValue* jv) {
+    return jv && packed_elem_size(jv->type) != 0;
+}
+
+/**
+ * 数组长度，普通数组与紧凑数组通用
+ * @param jv
+ * @return
+ */
+size_t json_array_size(const JsonValue* jv) {
+    if (!jv) return 0;
+    if (jv->type == JSON_ARRAY) return jv->value.array_value.ele_count;
+    if (json_is_packed_array(jv)) return jv->value.packed_value.count;
+    return 0;
+}
+
+static const void* packed_data(const JsonValue* jv, JsonType type, size_t* count) {
+    if (!jv || jv->type != type) {
+        if (count) *count = 0;
+        return NULL;
+    }
+    if (count) *count = jv->value.packed_value.count;
+    return jv->value.packed_value.data;
+}
+
+/**
+ * 取得紧凑数组的连续存储，类型不符时返回 NULL
+ * @param jv
+ * @param count 返回元素个数，可为 NULL
+ * @return
+ */
+const int32_t* json_int_array(const JsonValue* jv, size_t* count) {
+    return packed_data(jv, JSON_INT_ARRAY, count);
+}
+
+const int64_t* json_int64_array(const JsonValue* jv, size_t* count) {
+    return packed_data(jv, JSON_INT64_ARRAY, count);
+}
+
+const float* json_float_array(const JsonValue* jv, size_t* count) {
+    return packed_data(jv, JSON_FLOAT_ARRAY, count);
+}
+
+const double* json_double_array(const JsonValue* jv, size_t* count) {
+    return packed_data(jv, JSON_DOUBLE_ARRAY, count);
+}
+
+/**
+ * 紧凑数组第 i 个元素转为数值节点
+ * int64 元素超出 int 范围时为 JSON_INT64，不丢失精度
+ */
+static JsonValue packed_element(const JsonValue* jv, size_t i) {
+    const void* data = jv->value.packed_value.data;
+    switch (jv->type) {
+        case JSON_INT_ARRAY:
+            return (JsonValue){.type = JSON_INT, .value.int_value = ((const int32_t*)data)[i]};
+        case JSON_INT64_ARRAY: {
+            int64_t val = ((const int64_t*)data)[i];
+            return val >= INT_MIN && val <= INT_MAX ? (JsonValue){.type = JSON_INT, .value.int_value = (int)val}
+                                                    : (JsonValue){.type = JSON_INT64, .value.int64_value = val};
+        }
+        case JSON_FLOAT_ARRAY:
+            return (JsonValue){.type = JSON_FLOAT, .value.float_value = ((const float*)data)[i]};
+        default:
+            return (JsonValue){.type = JSON_DOUBLE, .value.double_value = ((const double*)data)[i]};
+    }
+}
+
+/**
+ * 展开紧凑数组
+ * @param saved 不为 NULL 时原紧凑数组移出到 saved（供补丁回滚恢复），否则释放
+ * @return
+ */
+static int packed_unpack(JsonValue* jv, JsonValue* saved) {
+    if (!value_unshare(jv, 0)) return 0;
+    size_t count = jv->value.packed_value.count;
+    JsonValue* elements = block_reserve(node_allocator(jv), NULL, NULL, sizeof(JsonValue), count ? count : 1);
+    if (!elements) return 0;
+
+    for (size_t i = 0; i < count; i++) elements[i] = packed_element(jv, i);
+    if (saved) {
+        *saved = *jv;
+        value_detach(saved);
+    } else {
+        json_free(jv);
+    }
+    jv->type = JSON_ARRAY;
+    jv->value.array_value.elements = elements;
+    jv->value.array_value.ele_count = count;
+    value_adopt(jv);
+    return 1;
+}
+
+/**
+ * 紧凑数组展开为普通 JSON_ARRAY，以便使用数组修改接口
+ * @param jv
+ * @return
+ */
+int json_array_unpack(JsonValue* jv) {
+    if (!json_is_packed_array(jv)) return jv && jv->type == JSON_ARRAY;
+    return packed_unpack(jv, NULL);
+}
+
+// ============================= 紧凑数值数组访问 end ================================
+
+// ============================= 只校验快速路径 start ================================
+
+#define VALIDATE_MAX_DEPTH 1024
+
+/**
+ * 跳过 JSON 空白（空格、\t、\n、\r），长空白段使用 SSE2 每次比较 16 字节
+ */
+static const unsigned char *validate_skip_ws(const unsigned char *p, const unsigned char *end) {
+#if defined(__SSE2__)
+    if (end - p >= 16 && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+        const __m128i space = _mm_set1_epi8(' '), lf = _mm_set1_epi8('\n');
+        const __m128i cr = _mm_set1_epi8('\r'), tab = _mm_set1_epi8('\t');
+        while (end - p >= 16) {
+            __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+            __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, lf)),
+                                      _mm_or_si128(_mm_cmpeq_epi8(chunk, cr), _mm_cmpeq_epi8(chunk, tab)));
+            int mask = ~_mm_movemask_epi8(ws) & 0xFFFF;
+            if (mask) return p + __builtin_ctz(mask);
+            p += 16;
+        }
+    }
+#endif
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) p++;
+    return p;
+}
+
+/**
+ * 跳过字符串中无需特殊处理的 ASCII 字节，停在 '"'、'\\'、控制字符或非 ASCII 字节处
+ */
+static const unsigned char *validate_scan_plain(const unsigned char *p, const unsigned char *end) {
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"'), backslash = _mm_set1_epi8('\\');
+    const __m128i ctrl = _mm_set1_epi8(0x1F);
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+        // 无符号 chunk <= 0x1F 即控制字符；最高位为 1 的字节由 movemask(chunk) 标出
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_max_epu8(chunk, ctrl), ctrl));
+        int mask = _mm_movemask_epi8(special) | _mm_movemask_epi8(chunk);
+        if (mask) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+#endif
+    while (p < end && *p >= 0x20 && *p < 0x80 && *p != '"' && *p != '\\') p++;
+    return p;
+}
+
+/**
+ * 校验一个 UTF-8 多字节序列（拒绝超长编码、代理区和超出 U+10FFFF 的码点）
+ * @return 序列长度，非法返回 0
+ */
+static size_t validate_utf8(const unsigned char *p, const unsigned char *end) {
+    unsigned char c = p[0];
+    size_t len;
+    unsigned char lo = 0x80, hi = 0xBF;  // 第二个字节的合法范围
+    if (c >= 0xC2 && c <= 0xDF) len = 2;
+    else if (c >= 0xE0 && c <= 0xEF) {
+        len = 3;
+        if (c == 0xE0) lo = 0xA0;
+        else if (c == 0xED) hi = 0x9F;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        len = 4;
+        if (c == 0xF0) lo = 0x90;
+        else if (c == 0xF4) hi = 0x8F;
+    } else return 0;
+
+    if ((size_t)(end - p) < len) return 0;
+    if (p[1] < lo || p[1] > hi) return 0;
+    for (size_t i = 2; i < len; i++) {
+        if ((p[i] & 0xC0) != 0x80) return 0;
+    }
+    return len;
+}
+
+static int validate_hex4(const unsigned char *p, const unsigned char *end) {
+    if (end - p < 4) return -1;
+    int hex = 0;
+    for (int i = 0; i < 4; i++) {
+        unsigned char c = p[i];
+        hex *= 16;
+        if (c >= '0' && c <= '9') hex += c - '0';
+        else if (c >= 'a' && c <= 'f') hex += 10 + c - 'a';
+        else if (c >= 'A' && c <= 'F') hex += 10 + c - 'A';
+        else return -1;
+    }
+    return hex;
+}
+
+/**
+ * 校验字符串，p 指向起始引号
+ * @return 结束引号之后的位置，出错返回 NULL 并通过 err 返回出错位置
+ */
+static const unsigned char *validate_string(const unsigned char *p, const unsigned char *end,
+                                            const unsigned char **err) {
+    p++;  // 跳过起始引号
+    while (1) {
+        p = validate_scan_plain(p, end);
+        if (p >= end) {
+            *err = end;
+            return NULL;
+        }
+        unsigned char c = *p;
+        if (c == '"') return p + 1;
+        if (c < 0x20) {
+            *err = p;
+            return NULL;
+        }
+        if (c >= 0x80) {
+            size_t len = validate_utf8(p, end);
+            if (!len) {
+                *err = p;
+                return NULL;
+            }
+            p += len;
+            continue;
+        }
+
+        // 转义序列
+        const unsigned char *escape = p;
+        if (end - p < 2) {
+            *err = end;
+            return NULL;
+        }
+        switch (p[1]) {
+            case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+                p += 2;
+                break;
+            case 'u': {
+                int code = validate_hex4(p + 2, end);
+                if (code < 0 || (code >= 0xDC00 && code <= 0xDFFF)) {
+                    *err = escape;
+                    return NULL;
+                }
+                p += 6;
+                if (code >= 0xD800 && code <= 0xDBFF) {
+                    // 高代理项之后必须紧跟 \u 低代理项
+                    int low = (end - p >= 2 && p[0] == '\\' && p[1] == 'u') ? validate_hex4(p + 2, end) : -1;
+                    if (low < 0xDC00 || low > 0xDFFF) {
+                        *err = escape;
+                        return NULL;
+                    }
+                    p += 6;
+                }
+                break;
+            }
+            default:
+                *err = escape;
+                return NULL;
+        }
+    }
+}
+
+/**
+ * 校验数字：-?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+ */
+static const unsigned char *validate_number(const unsigned char *p, const unsigned char *end,
+                                            const unsigned char **err) {
+    if (p < end && *p == '-') p++;
+    if (p >= end || !isdigit(*p)) {
+        *err = p;
+        return NULL;
+    }
+    if (*p == '0') p++;
+    else while (p < end && isdigit(*p)) p++;
+
+    if (p < end && *p == '.') {
+        p++;
+        if (p >= end || !isdigit(*p)) {
+            *err = p;
+            return NULL;
+        }
+        while (p < end && isdigit(*p)) p++;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) p++;
+        if (p >= end || !isdigit(*p)) {
+            *err = p;
+            return NULL;
+        }
+        while (p < end && isdigit(*p)) p++;
+    }
+    return p;
+}
+
+static const unsigned char *validate_literal(const unsigned char *p, const unsigned char *end,
+                                             const char *literal, size_t len, const unsigned char **err) {
+    for (size_t i = 0; i < len; i++) {
+        if (p + i >= end || p[i] != (unsigned char)literal[i]) {
+            *err = p + i;
+            return NULL;
+        }
+    }
+    return p + len;
+}
+
+/**
+ * 按 RFC 8259 严格校验 JSON 文本（含转义、代理对和 UTF-8），不分配任何内存
+ * 嵌套用位栈记录，最大深度 VALIDATE_MAX_DEPTH
+ * @param json
+ * @param len
+ * @param err_offset 出错时返回第一个错误字节的偏移，可为 NULL
+ * @return JSON_SUCCESS / JSON_INVALID / JSON_TOO_DEEP
+ */
+int json_validate(const char *json, size_t len, size_t *err_offset) {
+    const unsigned char *start = (const unsigned char *)json;
+    const unsigned char *p = start, *end = start + len, *err = NULL;
+    uint64_t stack[VALIDATE_MAX_DEPTH / 64];  // 1 表示对象，0 表示数组
+    size_t depth = 0;
+    int result = JSON_INVALID;
+
+    if (!json) {
+        if (err_offset) *err_offset = 0;
+        return JSON_INVALID;
+    }
+
+    // 期望一个值
+value:
+    p = validate_skip_ws(p, end);
+    if (p >= end) {
+        err = p;
+        goto fail;
+    }
+    switch (*p) {
+        case '{':
+        case '[': {
+            if (depth == VALIDATE_MAX_DEPTH) {
+                err = p;
+                result = JSON_TOO_DEEP;
+                goto fail;
+            }
+            bool is_object = *p == '{';
+            if (is_object) stack[depth / 64] |= (uint64_t)1 << (depth % 64);
+            else stack[depth / 64] &= ~((uint64_t)1 << (depth % 64));
+            depth++;
+            p = validate_skip_ws(p + 1, end);
+            if (p < end && *p == (is_object ? '}' : ']')) {
+                depth--;
+                p++;
+                goto after_value;
+            }
+            if (is_object) goto key;
+            goto value;
+        }
+        case '"':  p = validate_string(p, end, &err); break;
+        case 't':  p = validate_literal(p, end, "true", 4, &err); break;
+        case 'f':  p = validate_literal(p, end, "false", 5, &err); break;
+        case 'n':  p = validate_literal(p, end, "null", 4, &err); break;
+        default:   p = validate_number(p, end, &err); break;
+    }
+    if (!p) goto fail;
+
+after_value:
+    p = validate_skip_ws(p, end);
+    if (depth == 0) {
+        if (p != end) {
+            err = p;
+            goto fail;
+        }
+        return JSON_SUCCESS;
+    }
+    if (p >= end) {
+        err = p;
+        goto fail;
+    }
+    bool in_object = (stack[(depth - 1) / 64] >> ((depth - 1) % 64)) & 1;
+    if (*p == ',') {
+        p++;
+        if (in_object) goto key;
+        goto value;
+    }
+    if (*p == (in_object ? '}' : ']')) {
+        depth--;
+        p++;
+        goto after_value;
+    }
+    err = p;
+    goto fail;
+
+    // 期望 "key":
+key:
+    p = validate_skip_ws(p, end);
+    if (p >= end || *p != '"') {
+        err = p;
+        goto fail;
+    }
+    p = validate_string(p, end, &err);
+    if (!p) goto fail;
+    p = validate_skip_ws(p, end);
+    if (p >= end || *p != ':') {
+        err = p;
+        goto fail;
+    }
+    p++;
+    goto value;
+
+fail:
+    if (err_offset) *err_offset = (size_t)(err - start);
+    return result;
+}
+
+// ============================= 只校验快速路径 end ================================
+
+// ============================= 二进制编码（CBOR） start ================================
+
+#define CBOR_UINT     0
+#define CBOR_NEGINT   1
+#define CBOR_BYTES    2
+#define CBOR_TEXT     3
+#define CBOR_ARRAY    4
+#define CBOR_MAP      5
+#define CBOR_TAG      6
+#define CBOR_SIMPLE   7
+
+#define CBOR_FALSE    0xF4
+#define CBOR_TRUE     0xF5
+#define CBOR_NULL     0xF6
+#define CBOR_HALF     0xF9
+#define CBOR_FLOAT    0xFA
+#define CBOR_DOUBLE   0xFB
+
+// RFC 8746 类型化数组标签：0b010_f_s_e_ll，e=1 表示小端
+#define CBOR_TAG_SINT32_BE 74
+#define CBOR_TAG_SINT64_BE 75
+#define CBOR_TAG_SINT32_LE 78
+#define CBOR_TAG_SINT64_LE 79
+#define CBOR_TAG_FLOAT32_BE 81
+#define CBOR_TAG_FLOAT64_BE 82
+#define CBOR_TAG_FLOAT32_LE 85
+#define CBOR_TAG_FLOAT64_LE 86
+
+#define BINARY_MAX_DEPTH 1024
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define CBOR_HOST_LITTLE_ENDIAN 0
+#else
+#define CBOR_HOST_LITTLE_ENDIAN 1
+#endif
+
+static size_t cbor_head_size(uint64_t arg) {
+    if (arg < 24) return 1;
+    if (arg <= 0xFF) return 2;
+    if (arg <= 0xFFFF) return 3;
+    if (arg <= 0xFFFFFFFFu) return 5;
+    return 9;
+}
+
+static unsigned char *cbor_write_uint(unsigned char *p, uint64_t val, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) {
+        *p++ = (unsigned char)(val >> (i * 8));
+    }
+    return p;
+}
+
+static unsigned char *cbor_write_head(unsigned char *p, int major, uint64_t arg) {
+    unsigned char type = (unsigned char)(major << 5);
+    if (arg < 24) {
+        *p++ = type | (unsigned char)arg;
+        return p;
+    }
+    if (arg <= 0xFF) {
+        *p++ = type | 24;
+        return cbor_write_uint(p, arg, 1);
+    }
+    if (arg <= 0xFFFF) {
+        *p++ = type | 25;
+        return cbor_write_uint(p, arg, 2);
+    }
+    if (arg <= 0xFFFFFFFFu) {
+        *p++ = type | 26;
+        return cbor_write_uint(p, arg, 4);
+    }
+    *p++ = type | 27;
+    return cbor_write_uint(p, arg, 8);
+}
+
+static int packed_cbor_tag(JsonType type) {
+    switch (type) {
+        case JSON_INT_ARRAY:    return CBOR_HOST_LITTLE_ENDIAN ? CBOR_TAG_SINT32_LE : CBOR_TAG_SINT32_BE;
+        case JSON_INT64_ARRAY:  return CBOR_HOST_LITTLE_ENDIAN ? CBOR_TAG_SINT64_LE : CBOR_TAG_SINT64_BE;
+        case JSON_FLOAT_ARRAY:  return CBOR_HOST_LITTLE_ENDIAN ? CBOR_TAG_FLOAT32_LE : CBOR_TAG_FLOAT32_BE;
+        default:                return CBOR_HOST_LITTLE_ENDIAN ? CBOR_TAG_FLOAT64_LE : CBOR_TAG_FLOAT64_BE;
+    }
+}
+
+/**
+ * 计算编码后字节数
+ * @param jv
+ * @return
+ */
+static size_t binary_size(const JsonValue *jv) {
+    switch (jv->type) {
+        case JSON_NULL:
+        case JSON_BOOL:   return 1;
+        case JSON_INT:    return cbor_head_size(jv->value.int_value < 0 ? (uint64_t)(-1 - (int64_t)jv->value.int_value)
+                                                                      : (uint64_t)jv->value.int_value);
+        case JSON_INT64:  return cbor_head_size(jv->value.int64_value < 0 ? (uint64_t)(-1 - jv->value.int64_value)
+                                                                          : (uint64_t)jv->value.int64_value);
+        case JSON_FLOAT:  return 5;
+        case JSON_DOUBLE: return 9;
+        case JSON_STRING: {
+            size_t len = strlen(jv->value.string_value);
+            return cbor_head_size(len) + len;
+        }
+        case JSON_ARRAY: {
+            size_t size = cbor_head_size(jv->value.array_value.ele_count);
+            for (size_t i = 0; i < jv->value.array_value.ele_count; i++) {
+                size += binary_size(&jv->value.array_value.elements[i]);
+            }
+            return size;
+        }
+        case JSON_OBJECT: {
+            size_t size = cbor_head_size(jv->value.object_value.pair_count);
+            for (size_t i = 0; i < jv->value.object_value.pair_count; i++) {
+                size_t key_len = strlen(jv->value.object_value.pairs[i].key);
+                size += cbor_head_size(key_len) + key_len + binary_size(&jv->value.object_value.pairs[i].value);
+            }
+            return size;
+        }
+        case JSON_INT_ARRAY:
+        case JSON_INT64_ARRAY:
+        case JSON_FLOAT_ARRAY:
+        case JSON_DOUBLE_ARRAY: {
+            size_t bytes = jv->value.packed_value.count * packed_elem_size(jv->type);
+            return cbor_head_size(packed_cbor_tag(jv->type)) + cbor_head_size(bytes) + bytes;
+        }
+    }
+    return 0;
+}
+
+static unsigned char *binary_write(unsigned char *p, const JsonValue *jv) {
+    switch (jv->type) {
+        case JSON_NULL:
+            *p++ = CBOR_NULL;
+            return p;
+        case JSON_BOOL:
+            *p++ = jv->value.bool_value ? CBOR_TRUE : CBOR_FALSE;
+            return p;
+        case JSON_INT:
+            if (jv->value.int_value < 0) return cbor_write_head(p, CBOR_NEGINT, (uint64_t)(-1 - (int64_t)jv->value.int_value));
+            return cbor_write_head(p, CBOR_UINT, (uint64_t)jv->value.int_value);
+        case JSON_INT64:
+            if (jv->value.int64_value < 0) return cbor_write_head(p, CBOR_NEGINT, (uint64_t)(-1 - jv->value.int64_value));
+            return cbor_write_head(p, CBOR_UINT, (uint64_t)jv->value.int64_value);
+        case JSON_FLOAT: {
+            uint32_t bits;
+            memcpy(&bits, &jv->value.float_value, sizeof(bits));
+            *p++ = CBOR_FLOAT;
+            return cbor_write_uint(p, bits, 4);
+        }
+        case JSON_DOUBLE: {
+            uint64_t bits;
+            memcpy(&bits, &jv->value.double_value, sizeof(bits));
+            *p++ = CBOR_DOUBLE;
+            return cbor_write_uint(p, bits, 8);
+        }
+        case JSON_STRING: {
+            size_t len = strlen(jv->value.string_value);
+            p = cbor_write_head(p, CBOR_TEXT, len);
+            memcpy(p, jv->value.string_value, len);
+            return p + len;
+        }
+        case JSON_ARRAY:
+            p = cbor_write_head(p, CBOR_ARRAY, jv->value.array_value.ele_count);
+            for (size_t i = 0; i < jv->value.array_value.ele_count; i++) {
+                p = binary_write(p, &jv->value.array_value.elements[i]);
+            }
+            return p;
+        case JSON_OBJECT:
+            p = cbor_write_head(p, CBOR_MAP, jv->value.object_value.pair_count);
+            for (size_t i = 0; i < jv->value.object_value.pair_count; i++) {
+                const JsonPair *pair = &jv->value.object_value.pairs[i];
+                size_t key_len = strlen(pair->key);
+                p = cbor_write_head(p, CBOR_TEXT, key_len);
+                memcpy(p, pair->key, key_len);
+                p = binary_write(p + key_len, &pair->value);
+            }
+            return p;
+        case JSON_INT_ARRAY:
+        case JSON_INT64_ARRAY:
+        case JSON_FLOAT_ARRAY:
+        case JSON_DOUBLE_ARRAY: {
+            size_t bytes = jv->value.packed_value.count * packed_elem_size(jv->type);
+            p = cbor_write_head(p, CBOR_TAG, packed_cbor_tag(jv->type));
+            p = cbor_write_head(p, CBOR_BYTES, bytes);
+            if (bytes) memcpy(p, jv->value.packed_value.data, bytes);
+            return p + bytes;
+        }
+    }
+    return p;
+}
+
+/**
+ * 编码为 CBOR，使用全局分配器分配结果
+ * @param jv
+ * @param out_len 返回字节数
+ * @return
+ */
+unsigned char* json_to_binary(const JsonValue* jv, size_t* out_len) {
+    if (!jv || !out_len) return NULL;
+    size_t size = binary_size(jv);
+    unsigned char *buf = json_malloc(size ? size : 1);
+    if (!buf) return NULL;
+    binary_write(buf, jv);
+    *out_len = size;
+    return buf;
+}
+
+typedef struct {
+    const unsigned char *pos;
+    const unsigned char *end;
+    int depth;
+    bool measure;          // 只校验并统计所需空间，不写入
+    bool flat;             // 从 node_cursor/string_cursor 中切分，而非逐个分配
+    size_t node_bytes;
+    size_t string_bytes;
+    char *node_cursor;
+    char *string_cursor;
+} BinaryReader;
+
+#define ALIGN8(n) (((n) + 7) & ~(size_t)7)
+
+static int cbor_read_head(BinaryReader *r, int *major, uint64_t *arg) {
+    if (r->pos >= r->end) return 0;
+    unsigned char initial = *r->pos++;
+    *major = initial >> 5;
+    unsigned char info = initial & 0x1F;
+    if (info < 24) {
+        *arg = info;
+        return 1;
+    }
+    if (info > 27) return 0;  // 不支持不定长
+    size_t bytes = (size_t)1 << (info - 24);
+    if ((size_t)(r->end - r->pos) < bytes) return 0;
+    uint64_t val = 0;
+    for (size_t i = 0; i < bytes; i++) val = (val << 8) | *r->pos++;
+    *arg = val;
+    return 1;
+}
+
+static void *reader_block(BinaryReader *r, size_t elem_size, size_t count) {
+    if (r->measure) {
+        r->node_bytes += ALIGN8(sizeof(JsonBlock) + elem_size * count);
+        return NULL;
+    }
+    if (r->flat) {
+        JsonBlock *block = (JsonBlock *)r->node_cursor;
+        r->node_cursor += ALIGN8(sizeof(JsonBlock) + elem_size * count);
+        block_init(block, &g_allocator, count, BLOCK_PINNED);
+        return block + 1;
+    }
+    return block_reserve(&g_allocator, NULL, NULL, elem_size, count);
+}
+
+static char *reader_string(BinaryReader *r, const unsigned char *src, size_t len) {
+    if (memchr(src, '\0', len)) return NULL;  // C 字符串不能包含 NUL
+    char *str;
+    if (r->measure) {
+        r->string_bytes += len + 1;
+        return (char *)src;
+    }
+    if (r->flat) {
+        str = r->string_cursor;
+        r->string_cursor += len + 1;
+    } else {
+        str = json_malloc(len + 1);
+        if (!str) return NULL;
+    }
+    memcpy(str, src, len);
+    str[len] = '\0';
+    return str;
+}
+
+static float cbor_half_to_float(uint16_t half) {
+    int exp = (half >> 10) & 0x1F;
+    int mant = half & 0x3FF;
+    float val;
+    if (exp == 0) val = ldexpf((float)mant, -24);
+    else if (exp == 31) val = mant ? NAN : INFINITY;
+    else val = ldexpf((float)(mant + 1024), exp - 25);
+    return (half & 0x8000) ? -val : val;
+}
+
+static int binary_decode_value(BinaryReader *r, JsonValue *out);
+
+static int binary_decode_packed(BinaryReader *r, uint64_t tag, JsonValue *out) {
+    JsonType type;
+    bool little;
+    switch (tag) {
+        case CBOR_TAG_SINT32_LE:  type = JSON_INT_ARRAY;    little = true;  break;
+        case CBOR_TAG_SINT32_BE:  type = JSON_INT_ARRAY;    little = false; break;
+        case CBOR_TAG_SINT64_LE:  type = JSON_INT64_ARRAY;  little = true;  break;
+        case CBOR_TAG_SINT64_BE:  type = JSON_INT64_ARRAY;  little = false; break;
+        case CBOR_TAG_FLOAT32_LE: type = JSON_FLOAT_ARRAY;  little = true;  break;
+        case CBOR_TAG_FLOAT32_BE: type = JSON_FLOAT_ARRAY;  little = false; break;
+        case CBOR_TAG_FLOAT64_LE: type = JSON_DOUBLE_ARRAY; little = true;  break;
+        case CBOR_TAG_FLOAT64_BE: type = JSON_DOUBLE_ARRAY; little = false; break;
+        default: return JSON_INVALID;
+    }
+    int major;
+    uint64_t bytes;
+    size_t elem_size = packed_elem_size(type);
+    if (!cbor_read_head(r, &major, &bytes) || major != CBOR_BYTES) return JSON_INVALID;
+    if (bytes > (uint64_t)(r->end - r->pos) || bytes % elem_size) return JSON_INVALID;
+
+    size_t count = bytes / elem_size;
+    void *data = reader_block(r, elem_size, count);
+    if (!r->measure) {
+        if (!data) return JSON_MEM_ERROR;
+        memcpy(data, r->pos, bytes);
+        if (little != CBOR_HOST_LITTLE_ENDIAN) {
+            unsigned char *b = data;
+            for (size_t i = 0; i < count; i++, b += elem_size) {
+                for (size_t j = 0; j < elem_size / 2; j++) {
+                    unsigned char t = b[j];
+                    b[j] = b[elem_size - 1 - j];
+                    b[elem_size - 1 - j] = t;
+                }
+            }
+        }
+    }
+    r->pos += bytes;
+    out->type = type;
+    out->value.packed_value.data = data;
+    out->value.packed_value.count = count;
+    return JSON_SUCCESS;
+}
+
+static int binary_decode_value(BinaryReader *r, JsonValue *out) {
+    int major;
+    uint64_t arg;
+    const unsigned char *head = r->pos;
+    *out = (JsonValue){.type = JSON_NULL};
+    if (!cbor_read_head(r, &major, &arg)) return JSON_INVALID;
+
+    switch (major) {
+        case CBOR_UINT:
+            if (arg <= INT_MAX) *out = (JsonValue){.type = JSON_INT, .value.int_value = (int)arg};
+            else if (arg <= INT64_MAX) *out = (JsonValue){.type = JSON_INT64, .value.int64_value = (int64_t)arg};
+            else *out = (JsonValue){.type = JSON_DOUBLE, .value.double_value = (double)arg};
+            return JSON_SUCCESS;
+        case CBOR_NEGINT:
+            // 值为 -1 - arg
+            if (arg <= (uint64_t)INT_MAX) *out = (JsonValue){.type = JSON_INT, .value.int_value = -1 - (int)arg};
+            else if (arg <= INT64_MAX) *out = (JsonValue){.type = JSON_INT64, .value.int64_value = -1 - (int64_t)arg};
+            else *out = (JsonValue){.type = JSON_DOUBLE, .value.double_value = -1.0 - (double)arg};
+            return JSON_SUCCESS;
+        case CBOR_TEXT: {
+            if (arg > (uint64_t)(r->end - r->pos)) return JSON_INVALID;
+            char *str = reader_string(r, r->pos, (size_t)arg);
+            if (!str) return memchr(r->pos, '\0', (size_t)arg) ? JSON_INVALID : JSON_MEM_ERROR;
+            r->pos += arg;
+            out->type = JSON_STRING;
+            out->value.string_value = r->measure ? NULL : str;
+            return JSON_SUCCESS;
+        }
+        case CBOR_ARRAY:
+        case CBOR_MAP: {
+            // 每个元素至少 1 字节，借此拒绝伪造的超大长度
+            if (arg > (uint64_t)(r->end - r->pos)) return JSON_INVALID;
+            if (r->depth >= BINARY_MAX_DEPTH) return JSON_TOO_DEEP;
+            size_t count = (size_t)arg;
+            bool is_map = major == CBOR_MAP;
+            size_t elem_size = is_map ? sizeof(JsonPair) : sizeof(JsonValue);
+            void *data = count ? reader_block(r, elem_size, count) : NULL;
+            if (!r->measure && count && !data) return JSON_MEM_ERROR;
+
+            // 先以空容器占位，元素逐个计入，出错时可由 free_value 回收
+            if (is_map) *out = (JsonValue){.type = JSON_OBJECT, .value.object_value = {data, 0}};
+            else *out = (JsonValue){.type = JSON_ARRAY, .value.array_value = {data, 0}};
+            r->depth++;
+            for (size_t i = 0; i < count; i++) {
+                JsonValue value;
+                char *key = NULL;
+                if (is_map) {
+                    int key_major;
+                    uint64_t key_len;
+                    if (!cbor_read_head(r, &key_major, &key_len) || key_major != CBOR_TEXT ||
+                        key_len > (uint64_t)(r->end - r->pos)) return JSON_INVALID;
+                    key = reader_string(r, r->pos, (size_t)key_len);
+                    if (!key) return memchr(r->pos, '\0', (size_t)key_len) ? JSON_INVALID : JSON_MEM_ERROR;
+                    r->pos += key_len;
+                }
+                int error = binary_decode_value(r, &value);
+                if (r->measure) {
+                    if (error) return error;
+                    continue;
+                }
+                if (error) {
+                    if (!r->flat) {
+                        free_value(&value, NULL);
+                        json_mem_free(key);
+                    }
+                    return error;
+                }
+                if (is_map) {
+                    out->value.object_value.pairs[i] = (JsonPair){key, value};
+                    out->value.object_value.pair_count = i + 1;
+                    slot_attach(&out->value.object_value.pairs[i].value, data);
+                } else {
+                    out->value.array_value.elements[i] = value;
+                    out->value.array_value.ele_count = i + 1;
+                    slot_attach(&out->value.array_value.elements[i], data);
+                }
+            }
+            r->depth--;
+            if (r->measure) *out = (JsonValue){.type = JSON_NULL};
+            return JSON_SUCCESS;
+        }
+        case CBOR_TAG:
+            return binary_decode_packed(r, arg, out);
+        case CBOR_SIMPLE:
+            switch (*head) {
+                case CBOR_FALSE: *out = (JsonValue){.type = JSON_BOOL, .value.bool_value = false}; return JSON_SUCCESS;
+                case CBOR_TRUE:  *out = (JsonValue){.type = JSON_BOOL, .value.bool_value = true};  return JSON_SUCCESS;
+                case CBOR_NULL:  return JSON_SUCCESS;
+                case CBOR_HALF:
+                    *out = (JsonValue){.type = JSON_FLOAT, .value.float_value = cbor_half_to_float((uint16_t)arg)};
+                    return JSON_SUCCESS;
+                case CBOR_FLOAT: {
+                    uint32_t bits = (uint32_t)arg;
+                    float val;
+                    memcpy(&val, &bits, sizeof(val));
+                    *out = (JsonValue){.type = JSON_FLOAT, .value.float_value = val};
+                    return JSON_SUCCESS;
+                }
+                case CBOR_DOUBLE: {
+                    double val;
+                    memcpy(&val, &arg, sizeof(val));
+                    *out = (JsonValue){.type = JSON_DOUBLE, .value.double_value = val};
+                    return JSON_SUCCESS;
+                }
+                default: return JSON_INVALID;
+            }
+        default:
+            return JSON_INVALID;
+    }
+}
+
+/**
+ * 从 CBOR 解码为普通文档，用 json_free 释放
+ * @param data
+ * @param len
+ * @param error
+ * @return
+ */
+JsonValue json_from_binary(const void* data, size_t len, int* error) {
+    BinaryReader r = {data, (const unsigned char *)data + len, 0, false, false, 0, 0, NULL, NULL};
+    JsonValue result;
+    int err = data ? binary_decode_value(&r, &result) : JSON_INVALID;
+    if (!err && r.pos != r.end) err = JSON_INVALID;
+    if (err) {
+        if (data) free_value(&result, NULL);
+        *error = err;
+        return (JsonValue){0};
+    }
+    *error = JSON_SUCCESS;
+    return result;
+}
+
+/**
+ * 从 CBOR 解码到单次分配的内存中：先扫描一遍统计所需空间，再一次性填充
+ * 结果只读，不能使用修改接口，整体用 json_free_flat 释放
+ * @param data
+ * @param len
+ * @param error
+ * @return
+ */
+JsonValue* json_from_binary_flat(const void* data, size_t len, int* error) {
+    if (!data) {
+        *error = JSON_INVALID;
+        return NULL;
+    }
+    BinaryReader r = {data, (const unsigned char *)data + len, 0, true, true, 0, 0, NULL, NULL};
+    JsonValue scratch;
+    int err = binary_decode_value(&r, &scratch);
+    if (!err && r.pos != r.end) err = JSON_INVALID;
+    if (err) {
+        *error = err;
+        return NULL;
+    }
+
+    size_t header = ALIGN8(sizeof(JsonValue));
+    char *memory = json_malloc(header + r.node_bytes + r.string_bytes);
+    if (!memory) {
+        *error = JSON_MEM_ERROR;
+        return NULL;
+    }
+    r.pos = data;
+    r.measure = false;
+    r.node_cursor = memory + header;
+    r.string_cursor = memory + header + r.node_bytes;
+    JsonValue *root = (JsonValue *)memory;
+    binary_decode_value(&r, root);  // 第一遍已校验，不会失败
+    *error = JSON_SUCCESS;
+    return root;
+}
+
+void json_free_flat(JsonValue* root) {
+    json_mem_free(root);
+}
+
+// ============================= 二进制编码（CBOR） end ================================
+
+// ============================= 可映射快照 start ================================
+
+#define SNAPSHOT_MAGIC "MJSNAP01"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+
+/**
+ * 快照文件布局（全部 8 字节对齐，所有引用都是相对引用者自身地址的偏移，与映射地址无关）：
+ *   SnapHeader | 根节点 | 各容器、字符串、紧凑数组的负载
+ * 数组负载：uint64 count + JsonSnapNode[count]
+ * 对象负载：uint64 count + SnapEntry[count] + uint32 按键排序的下标[count]
+ * 字符串负载：以 NUL 结尾的字节，长度记录在节点 aux 中
+ * 紧凑数组负载：uint64 count + 连续元素
+ */
+typedef struct {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    uint64_t root_offset;
+    uint64_t file_size;
+} SnapHeader;
+
+struct JsonSnapNode {
+    uint32_t type;
+    uint32_t aux;        // 字符串长度
+    int64_t payload;     // 标量值，或负载相对本节点的偏移
+};
+
+typedef struct {
+    int64_t key;         // 键相对本条目的偏移
+    uint64_t key_len;
+    JsonSnapNode value;
+} SnapEntry;
+
+struct JsonSnapshot {
+    const unsigned char *base;
+    size_t size;
+    bool mapped;
+};
+
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+} SnapWriter;
+
+static int64_t snap_rel(size_t from, size_t to) {
+    return (int64_t)to - (int64_t)from;
+}
+
+/**
+ * 在写缓冲末尾预留 8 字节对齐的空间
+ * @return 偏移，失败返回 SIZE_MAX
+ */
+static size_t snap_reserve(SnapWriter *w, size_t size) {
+    size_t offset = w->size;
+    size_t new_size = offset + ALIGN8(size);
+    if (new_size > w->capacity) {
+        size_t capacity = w->capacity ? w->capacity * 2 : 4096;
+        while (capacity < new_size) capacity *= 2;
+        unsigned char *data = json_realloc(w->data, capacity);
+        if (!data) return SIZE_MAX;
+        w->data = data;
+        w->capacity = capacity;
+    }
+    memset(w->data + offset, 0, new_size - offset);
+    w->size = new_size;
+    return offset;
+}
+
+static size_t snap_write_bytes(SnapWriter *w, const void *src, size_t len, bool terminate) {
+    size_t offset = snap_reserve(w, len + (terminate ? 1 : 0));
+    if (offset != SIZE_MAX && len) memcpy(w->data + offset, src, len);
+    return offset;
+}
+
+#define SNAP_NODE(w, offset) ((JsonSnapNode *)((w)->data + (offset)))
+
+/**
+ * 写入 node_offset 处的节点，负载追加到缓冲末尾
+ * @return
+ */
+static int snap_write_value(SnapWriter *w, size_t node_offset, const JsonValue *jv) {
+    JsonSnapNode node = {(uint32_t)jv->type, 0, 0};
+    switch (jv->type) {
+        case JSON_NULL: break;
+        case JSON_BOOL:   node.payload = jv->value.bool_value; break;
+        case JSON_INT:    node.payload = jv->value.int_value; break;
+        case JSON_INT64:  node.payload = (uint64_t)jv->value.int64_value; break;
+        case JSON_FLOAT:  memcpy(&node.payload, &jv->value.float_value, sizeof(float)); break;
+        case JSON_DOUBLE: memcpy(&node.payload, &jv->value.double_value, sizeof(double)); break;
+        case JSON_STRING: {
+            size_t len = strlen(jv->value.string_value);
+            if (len > UINT32_MAX) return JSON_INVALID;
+            size_t offset = snap_write_bytes(w, jv->value.string_value, len, true);
+            if (offset == SIZE_MAX) return JSON_MEM_ERROR;
+            node.aux = (uint32_t)len;
+            node.payload = snap_rel(node_offset, offset);
+            break;
+        }
+        case JSON_ARRAY: {
+            size_t count = jv->value.array_value.ele_count;
+            size_t offset = snap_reserve(w, sizeof(uint64_t) + count * sizeof(JsonSnapNode));
+            if (offset == SIZE_MAX) return JSON_MEM_ERROR;
+            *(uint64_t *)(w->data + offset) = count;
+            for (size_t i = 0; i < count; i++) {
+                size_t child = offset + sizeof(uint64_t) + i * sizeof(JsonSnapNode);
+                int error = snap_write_value(w, child, &jv->value.array_value.elements[i]);
+                if (error) return error;
+            }
+            node.payload = snap_rel(node_offset, offset);
+            break;
+        }
+        case JSON_OBJECT: {
+            size_t count = jv->value.object_value.pair_count;
+            if (count > UINT32_MAX) return JSON_INVALID;
+            size_t entries = sizeof(uint64_t);
+            size_t index = entries + count * sizeof(SnapEntry);
+            size_t offset = snap_reserve(w, index + count * sizeof(uint32_t));
+            if (offset == SIZE_MAX) return JSON_MEM_ERROR;
+            *(uint64_t *)(w->data + offset) = count;
+
+            // 按键排序的下标，读取时用于二分查找
+            const JsonPair *pairs = jv->value.object_value.pairs;
+            uint32_t *tmp = json_malloc(count * sizeof(uint32_t) + 1);
+            if (!tmp) return JSON_MEM_ERROR;
+            uint32_t *order = (uint32_t *)(w->data + offset + index);
+            for (size_t i = 0; i < count; i++) order[i] = (uint32_t)i;
+            sort_order(pairs, order, tmp, count);
+            json_mem_free(tmp);
+
+            for (size_t i = 0; i < count; i++) {
+                size_t entry = offset + entries + i * sizeof(SnapEntry);
+                size_t key_len = strlen(pairs[i].key);
+                size_t key = snap_write_bytes(w, pairs[i].key, key_len, true);
+                if (key == SIZE_MAX) return JSON_MEM_ERROR;
+                SnapEntry *e = (SnapEntry *)(w->data + entry);
+                e->key = snap_rel(entry, key);
+                e->key_len = key_len;
+                int error = snap_write_value(w, entry + offsetof(SnapEntry, value), &pairs[i].value);
+                if (error) return error;
+            }
+            node.payload = snap_rel(node_offset, offset);
+            break;
+        }
+        case JSON_INT_ARRAY:
+        case JSON_INT64_ARRAY:
+        case JSON_FLOAT_ARRAY:
+        case JSON_DOUBLE_ARRAY: {
+            size_t count = jv->value.packed_value.count;
+            size_t bytes = count * packed_elem_size(jv->type);
+            size_t offset = snap_reserve(w, sizeof(uint64_t) + bytes);
+            if (offset == SIZE_MAX) return JSON_MEM_ERROR;
+            *(uint64_t *)(w->data + offset) = count;
+            if (bytes) memcpy(w->data + offset + sizeof(uint64_t), jv->value.packed_value.data, bytes);
+            node.payload = snap_rel(node_offset, offset);
+            break;
+        }
+    }
+    // 子节点写入可能导致缓冲重新分配，最后再写本节点
+    *SNAP_NODE(w, node_offset) = node;
+    return JSON_SUCCESS;
+}
+
+/**
+ * 把文档写为快照文件
+ * @param root
+ * @param path
+ * @return JSON_SUCCESS 或错误码
+ */
+int json_snapshot_write(const JsonValue* root, const char* path) {
+    if (!root || !path) return JSON_INVALID;
+    SnapWriter w = {NULL, 0, 0};
+    size_t header = snap_reserve(&w, sizeof(SnapHeader));
+    size_t node = snap_reserve(&w, sizeof(JsonSnapNode));
+    if (header == SIZE_MAX || node == SIZE_MAX) {
+        json_mem_free(w.data);
+        return JSON_MEM_ERROR;
+    }
+    int error = snap_write_value(&w, node, root);
+    if (error) {
+        json_mem_free(w.data);
+        return error;
+    }
+
+    SnapHeader *h = (SnapHeader *)(w.data + header);
+    memcpy(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic));
+    h->byte_order = SNAPSHOT_BYTE_ORDER;
+    h->version = SNAPSHOT_VERSION;
+    h->root_offset = node;
+    h->file_size = w.size;
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        json_mem_free(w.data);
+        return JSON_INVALID;
+    }
+    bool ok = fwrite(w.data, 1, w.size, fp) == w.size;
+    ok = (fclose(fp) == 0) && ok;
+    json_mem_free(w.data);
+    return ok ? JSON_SUCCESS : JSON_INVALID;
+}
+
+/**
+ * 只读打开快照：POSIX 平台使用 mmap 共享页缓存，其他平台整体读入内存
+ * 只校验文件头，快照文件应来自可信的 json_snapshot_write 输出
+ * @param path
+ * @param error
+ * @return
+ */
+JsonSnapshot* json_snapshot_open(const char* path, int* error) {
+    *error = JSON_INVALID;
+    if (!path) return NULL;
+    JsonSnapshot *snap = json_malloc(sizeof(JsonSnapshot));
+    if (!snap) {
+        *error = JSON_MEM_ERROR;
+        return NULL;
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapHeader)) {
+        if (fd >= 0) close(fd);
+        json_mem_free(snap);
+        return NULL;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        json_mem_free(snap);
+        return NULL;
+    }
+    snap->base = base;
+    snap->size = (size_t)st.st_size;
+    snap->mapped = true;
+#else
+    FILE *fp = fopen(path, "rb");
+    long size = -1;
+    if (fp && fseek(fp, 0, SEEK_END) == 0) size = ftell(fp);
+    if (size < (long)sizeof(SnapHeader) || fseek(fp, 0, SEEK_SET) != 0) {
+        if (fp) fclose(fp);
+        json_mem_free(snap);
+        return NULL;
+    }
+    unsigned char *base = json_malloc((size_t)size);
+    if (!base || fread(base, 1, (size_t)size, fp) != (size_t)size) {
+        fclose(fp);
+        json_mem_free(base);
+        json_mem_free(snap);
+        return NULL;
+    }
+    fclose(fp);
+    snap->base = base;
+    snap->size = (size_t)size;
+    snap->mapped = false;
+#endif
+
+    const SnapHeader *h = (const SnapHeader *)snap->base;
+    if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) != 0 || h->byte_order != SNAPSHOT_BYTE_ORDER ||
+        h->version != SNAPSHOT_VERSION || h->file_size != snap->size ||
+        h->root_offset < sizeof(SnapHeader) || h->root_offset > snap->size - sizeof(JsonSnapNode)) {
+        json_snapshot_close(snap);
+        return NULL;
+    }
+    *error = JSON_SUCCESS;
+    return snap;
+}
+
+void json_snapshot_close(JsonSnapshot* snap) {
+    if (!snap) return;
+#if defined(__unix__) || defined(__APPLE__)
+    if (snap->mapped) munmap((void *)snap->base, snap->size);
+#else
+    json_mem_free((void *)snap->base);
+#endif
+    json_mem_free(snap);
+}
+
+const JsonSnapNode* json_snapshot_root(const JsonSnapshot* snap) {
+    if (!snap) return NULL;
+    const SnapHeader *h = (const SnapHeader *)snap->base;
+    return (const JsonSnapNode *)(snap->base + h->root_offset);
+}
+
+static const unsigned char *snap_payload(const JsonSnapNode *node) {
+    return (const unsigned char *)node + node->payload;
+}
+
+JsonType json_snap_type(const JsonSnapNode* node) {
+    return node ? (JsonType)node->type : JSON_NULL;
+}
+
+bool json_snap_bool(const JsonSnapNode* node) {
+    return node && node->type == JSON_BOOL && node->payload;
+}
+
+int json_snap_int(const JsonSnapNode* node) {
+    return (node && node->type == JSON_INT) ? (int)node->payload : 0;
+}
+
+/**
+ * 整数节点的值，int 与 int64 节点均可读取
+ */
+int64_t json_snap_int64(const JsonSnapNode* node) {
+    if (!node) return 0;
+    if (node->type == JSON_INT) return (int)node->payload;
+    return node->type == JSON_INT64 ? (int64_t)node->payload : 0;
+}
+
+float json_snap_float(const JsonSnapNode* node) {
+    float val = 0;
+    if (node && node->type == JSON_FLOAT) memcpy(&val, &node->payload, sizeof(val));
+    return val;
+}
+
+double json_snap_double(const JsonSnapNode* node) {
+    double val = 0;
+    if (node && node->type == JSON_DOUBLE) memcpy(&val, &node->payload, sizeof(val));
+    return val;
+}
+
+const char* json_snap_string(const JsonSnapNode* node, size_t* len) {
+    if (!node || node->type != JSON_STRING) return NULL;
+    if (len) *len = node->aux;
+    return (const char *)snap_payload(node);
+}
+
+/**
+ * 数组、对象、紧凑数组的元素个数
+ */
+size_t json_snap_size(const JsonSnapNode* node) {
+    if (!node) return 0;
+    // 只有容器的负载是偏移；标量（含排在容器之后的 JSON_INT64）的负载是值本身
+    if (node->type != JSON_ARRAY && node->type != JSON_OBJECT && packed_elem_size((JsonType)node->type) == 0) {
+        return 0;
+    }
+    return (size_t)*(const uint64_t *)snap_payload(node);
+}
+
+const JsonSnapNode* json_snap_array_get(const JsonSnapNode* node, size_t index) {
+    if (!node || node->type != JSON_ARRAY || index >= json_snap_size(node)) return NULL;
+    return (const JsonSnapNode *)(snap_payload(node) + sizeof(uint64_t)) + index;
+}
+
+static const SnapEntry *snap_entries(const JsonSnapNode *node) {
+    return (const SnapEntry *)(snap_payload(node) + sizeof(uint64_t));
+}
+
+static const char *snap_entry_key(const SnapEntry *entry) {
+    return (const char *)entry + entry->key;
+}
+
+/**
+ * 按位置遍历对象
+ * @param node
+ * @param index
+ * @param key 返回键，可为 NULL
+ * @return
+ */
+const JsonSnapNode* json_snap_object_at(const JsonSnapNode* node, size_t index, const char** key) {
+    if (!node || node->type != JSON_OBJECT || index >= json_snap_size(node)) return NULL;
+    const SnapEntry *entry = &snap_entries(node)[index];
+    if (key) *key = snap_entry_key(entry);
+    return &entry->value;
+}
+
+/**
+ * 比较长度为 len 的键片段与快照中的键
+ */
+static int snap_key_compare(const char *key, size_t len, const SnapEntry *entry) {
+    size_t entry_len = (size_t)entry->key_len;
+    int cmp = memcmp(key, snap_entry_key(entry), len < entry_len ? len : entry_len);
+    if (cmp != 0) return cmp;
+    return (len > entry_len) - (len < entry_len);
+}
+
+static const JsonSnapNode *snap_find(const JsonSnapNode *node, const char *key, size_t len) {
+    if (!node || node->type != JSON_OBJECT) return NULL;
+    size_t count = json_snap_size(node);
+    const SnapEntry *entries = snap_entries(node);
+    const uint32_t *order = (const uint32_t *)(entries + count);
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (snap_key_compare(key, len, &entries[order[mid]]) > 0) low = mid + 1;
+        else high = mid;
+    }
+    if (low < count && snap_key_compare(key, len, &entries[order[low]]) == 0) {
+        return &entries[order[low]].value;
+    }
+    return NULL;
+}
+
+/**
+ * 对象键查找（二分查找），重复键返回第一个
+ */
+const JsonSnapNode* json_snap_find(const JsonSnapNode* node, const char* key) {
+    return key ? snap_find(node, key, strlen(key)) : NULL;
+}
+
+/**
+ * 按路径查询，语法与 json_get 相同（"a.b[2].c"），不分配内存
+ * @param node
+ * @param path
+ * @return
+ */
+const JsonSnapNode* json_snap_get(const JsonSnapNode* node, const char* path) {
+    if (!node || !path) return NULL;
+    const char *p = path;
+    while (*p && node) {
+        if (*p == '.') {
+            p++;
+            continue;
+        }
+        if (*p == '[') {
+            char *end;
+            unsigned long index = strtoul(p + 1, &end, 10);
+            if (end == p + 1 || *end != ']') return NULL;
+            node = json_snap_array_get(node, index);
+            p = end + 1;
+            continue;
+        }
+        size_t len = strcspn(p, ".[");
+        node = snap_find(node, p, len);
+        p += len;
+    }
+    return node;
+}
+
+/**
+ * 紧凑数组的连续存储
+ * @param node
+ * @param count
+ * @return
+ */
+const void* json_snap_packed(const JsonSnapNode* node, size_t* count) {
+    if (!node || packed_elem_size((JsonType)node->type) == 0) return NULL;
+    if (count) *count = json_snap_size(node);
+    return snap_payload(node) + sizeof(uint64_t);
+}
+
+// ============================= 可映射快照 end ================================
+
+// ============================= JSON Patch start ================================
+
+/**
+ * 值比较：数值按数值比较（不区分 int/float/double），紧凑数组与普通数组按元素比较，
+ * 对象比较键集合（与顺序无关）
+ */
+static bool value_number(const JsonValue *jv, long double *out) {
+    switch (jv->type) {
+        case JSON_INT:    *out = jv->value.int_value; return true;
+        case JSON_INT64:  *out = jv->value.int64_value; return true;
+        case JSON_FLOAT:  *out = jv->value.float_value; return true;
+        case JSON_DOUBLE: *out = jv->value.double_value; return true;
+        default: return false;
+    }
+}
+
+static bool list_number(const JsonValue *jv, size_t i, long double *out) {
+    const void *data = jv->value.packed_value.data;
+    switch (jv->type) {
+        case JSON_ARRAY:        return value_number(&jv->value.array_value.elements[i], out);
+        case JSON_INT_ARRAY:    *out = ((const int32_t *)data)[i]; return true;
+        case JSON_INT64_ARRAY:  *out = ((const int64_t *)data)[i]; return true;
+        case JSON_FLOAT_ARRAY:  *out = ((const float *)data)[i]; return true;
+        case JSON_DOUBLE_ARRAY: *out = ((const double *)data)[i]; return true;
+        default: return false;
+    }
+}
+
+static bool value_equal(const JsonValue *a, const JsonValue *b) {
+    long double x, y;
+    if (value_number(a, &x) && value_number(b, &y)) return x == y;
+
+    // 克隆共享同一存储块时内容必然相同；两边都有结构哈希且不同时必然不等
+    const void *a_data = value_block(a);
+    if (a_data && a->type == b->type && a_data == value_block(b) &&
+        json_array_size(a) == json_array_size(b) &&
+        (a->type != JSON_OBJECT || a->value.object_value.pair_count == b->value.object_value.pair_count)) {
+        return true;
+    }
+    uint64_t a_hash = block_hash(a), b_hash = block_hash(b);
+    if (a_hash && b_hash && a_hash != b_hash) return false;
+
+    bool a_list = a->type == JSON_ARRAY || json_is_packed_array(a);
+    bool b_list = b->type == JSON_ARRAY || json_is_packed_array(b);
+    if (a_list && b_list) {
+        size_t count = json_array_size(a);
+        if (count != json_array_size(b)) return false;
+        for (size_t i = 0; i < count; i++) {
+            if (a->type == JSON_ARRAY && b->type == JSON_ARRAY) {
+                if (!value_equal(&a->value.array_value.elements[i], &b->value.array_value.elements[i])) return false;
+            } else if (!list_number(a, i, &x) || !list_number(b, i, &y) || x != y) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (a->type != b->type) return false;
+
+    switch (a->type) {
+        case JSON_NULL:   return true;
+        case JSON_BOOL:   return a->value.bool_value == b->value.bool_value;
+        case JSON_STRING: return strcmp(a->value.string_value, b->value.string_value) == 0;
+        case JSON_OBJECT: {
+            size_t count = a->value.object_value.pair_count;
+            if (count != b->value.object_value.pair_count) return false;
+            for (size_t i = 0; i < count; i++) {
+                const JsonPair *pair = &a->value.object_value.pairs[i];
+                int index = find_key_index(b, pair->key);
+                if (index < 0 || !value_equal(&pair->value, &b->value.object_value.pairs[index].value)) return false;
+            }
+            return true;
+        }
+        default: return false;
+    }
+}
+
+enum {
+    UNDO_INSERTED,  // index 处插入了元素/键值对，回滚时移除并释放
+    UNDO_REMOVED,   // index 处移除了元素/键值对，回滚时放回
+    UNDO_REPLACED,  // index 处的值被替换，回滚时恢复旧值
+    UNDO_ROOT,      // 整个文档被替换
+    UNDO_UNPACKED   // 位置路径所指的紧凑数组被展开，回滚时恢复紧凑形式
+};
+
+typedef struct {
+    int kind;
+    size_t path_start;  // 父容器位置路径在 positions 中的起点
+    size_t depth;       // 位置路径长度
+    size_t index;
+    char *key;          // UNDO_REMOVED：被移除的对象键
+    JsonValue saved;    // 旧值，提交时释放
+} PatchUndo;
+
+/**
+ * 补丁回滚日志。修改过程中容器可能被重新分配，因此不记录指针，
+ * 只记录从根开始逐层的位置（数组下标或键值对下标），回滚时按相反顺序重新定位
+ */
+typedef struct {
+    JsonValue *root;
+    const JsonAllocator *allocator;  // 文档的分配器：补丁中的字符串与新键按它复制
+    PatchUndo *entries;
+    size_t count, capacity;
+    size_t *positions;
+    size_t pos_count, pos_capacity;
+    size_t *stack;      // 当前节点的位置路径
+    size_t depth, stack_capacity;
+} PatchLog;
+
+static int log_reserve(size_t **data, size_t *capacity, size_t min_capacity) {
+    if (min_capacity <= *capacity) return 1;
+    size_t new_capacity = *capacity ? *capacity * 2 : 16;
+    if (new_capacity < min_capacity) new_capacity = min_capacity;
+    size_t *new_data = json_realloc(*data, new_capacity * sizeof(size_t));
+    if (!new_data) return 0;
+    *data = new_data;
+    *capacity = new_capacity;
+    return 1;
+}
+
+static int log_push(PatchLog *log, size_t index) {
+    if (!log_reserve(&log->stack, &log->stack_capacity, log->depth + 1)) return 0;
+    log->stack[log->depth++] = index;
+    return 1;
+}
+
+/**
+ * 追加一条回滚记录，父容器的位置路径取当前路径的前 depth 层
+ * @return 新记录，失败返回 NULL（此时还未修改文档）
+ */
+static PatchUndo *log_add(PatchLog *log, int kind, size_t depth, size_t index) {
+    if (log->count == log->capacity) {
+        size_t capacity = log->capacity ? log->capacity * 2 : 8;
+        PatchUndo *entries = json_realloc(log->entries, capacity * sizeof(PatchUndo));
+        if (!entries) return NULL;
+        log->entries = entries;
+        log->capacity = capacity;
+    }
+    if (!log_reserve(&log->positions, &log->pos_capacity, log->pos_count + depth)) return NULL;
+    if (depth) memcpy(&log->positions[log->pos_count], log->stack, depth * sizeof(size_t));
+
+    PatchUndo *u = &log->entries[log->count++];
+    *u = (PatchUndo){kind, log->pos_count, depth, index, NULL, {.type = JSON_NULL}};
+    log->pos_count += depth;
+    return u;
+}
+
+// 撤销最近一次 log_add（对应的修改未能执行）
+static void log_drop(PatchLog *log) {
+    log->count--;
+    log->pos_count = log->entries[log->count].path_start;
+}
+
+/**
+ * 用 value 替换 slot 的内容，旧值移出到回滚记录中
+ */
+static void log_save(PatchUndo *u, JsonValue *slot, const JsonValue *value) {
+    u->saved = *slot;
+    value_detach(&u->saved);
+    slot_store(slot, value);
+}
+
+static JsonValue *container_child(JsonValue *container, size_t index) {
+    return container->type == JSON_ARRAY
+           ? &container->value.array_value.elements[index]
+           : &container->value.object_value.pairs[index].value;
+}
+
+/**
+ * 按相反顺序撤销全部修改。删除不缩小容量，放回时不会分配内存
+ */
+static void log_rollback(PatchLog *log) {
+    while (log->count > 0) {
+        PatchUndo *u = &log->entries[--log->count];
+        if (u->kind == UNDO_ROOT) {
+            json_free(log->root);
+            slot_store(log->root, &u->saved);
+            continue;
+        }
+        JsonValue *parent = log->root;
+        for (size_t i = 0; i < u->depth; i++) {
+            parent = container_child(parent, log->positions[u->path_start + i]);
+        }
+        switch (u->kind) {
+            case UNDO_UNPACKED:
+                // 位置路径指向被展开的数组本身
+                json_free(parent);
+                slot_store(parent, &u->saved);
+                break;
+            case UNDO_INSERTED:
+                if (parent->type == JSON_ARRAY) {
+                    json_free(array_remove_at(parent, u->index));
+                } else {
+                    JsonPair pair = object_remove_slot(parent, u->index);
+                    mem_free_string(node_allocator(parent), NULL, pair.key);
+                    json_free(&pair.value);
+                }
+                break;
+            case UNDO_REMOVED: {
+                // 放回失败时文档已无法复原，释放旧值以免泄漏
+                if (parent->type == JSON_ARRAY) {
+                    if (!array_insert_at(parent, u->index, &u->saved)) json_free(&u->saved);
+                    break;
+                }
+                JsonPair *pair = object_insert_slot(parent, u->index, u->key);
+                if (pair) {
+                    slot_store(&pair->value, &u->saved);
+                } else {
+                    mem_free_string(value_allocator(&u->saved), NULL, u->key);
+                    json_free(&u->saved);
+                }
+                break;
+            }
+            default: {
+                JsonValue *slot = container_child(parent, u->index);
+                json_free(slot);
+                slot_store(slot, &u->saved);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * 释放日志；仍在日志中的记录视为已提交，释放其保存的旧值
+ */
+static void log_free(PatchLog *log) {
+    for (size_t i = 0; i < log->count; i++) {
+        // 被移除的键与旧值来自同一存储块，旧值移出时记下了它的分配器
+        mem_free_string(value_allocator(&log->entries[i].saved), NULL, log->entries[i].key);
+        json_free(&log->entries[i].saved);
+    }
+    json_mem_free(log->entries);
+    json_mem_free(log->positions);
+    json_mem_free(log->stack);
+}
+
+/**
+ * JSON Pointer（RFC 6901）片段中的 '~' 只能后跟 '0' 或 '1'
+ */
+static bool pointer_segment_valid(const char *seg, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (seg[i] == '~' && (i + 1 >= len || (seg[i + 1] != '0' && seg[i + 1] != '1'))) return false;
+    }
+    return true;
+}
+
+static bool pointer_key_equal(const char *seg, size_t len, const char *key) {
+    size_t k = 0;
+    for (size_t i = 0; i < len; i++, k++) {
+        char c = seg[i];
+        if (c == '~') c = seg[++i] == '0' ? '~' : '/';
+        if (key[k] != c) return false;
+    }
+    return key[k] == '\0';
+}
+
+static int pointer_find_key(const JsonValue *obj, const char *seg, size_t len) {
+    if (!memchr(seg, '~', len)) return find_key_index_n(obj, seg, len);
+    for (size_t i = 0; i < obj->value.object_value.pair_count; i++) {
+        if (pointer_key_equal(seg, len, obj->value.object_value.pairs[i].key)) return (int)i;
+    }
+    return -1;
+}
+
+static char *pointer_unescape(const JsonAllocator *a, const char *seg, size_t len) {
+    char *key = mem_malloc(a, NULL, len + 1);
+    if (!key) return NULL;
+    size_t k = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = seg[i];
+        if (c == '~') c = seg[++i] == '0' ? '~' : '/';
+        key[k++] = c;
+    }
+    key[k] = '\0';
+    return key;
+}
+
+/**
+ * 数组下标片段：十进制，不允许前导零
+ */
+static bool pointer_index(const char *seg, size_t len, size_t *index) {
+    if (len == 0 || (len > 1 && seg[0] == '0')) return false;
+    size_t val = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (seg[i] < '0' || seg[i] > '9' || val > (SIZE_MAX - 9) / 10) return false;
+        val = val * 10 + (size_t)(seg[i] - '0');
+    }
+    *index = val;
+    return true;
+}
+
+/**
+ * 在容器中定位片段，只读取不修改；紧凑数组按元素下标定位
+ * @param index 返回元素下标或键值对下标
+ * @return 错误码
+ */
+static int pointer_child(const JsonValue *container, const char *seg, size_t len, size_t *index) {
+    if (container->type == JSON_ARRAY || json_is_packed_array(container)) {
+        if (!pointer_index(seg, len, index) || *index >= json_array_size(container)) return JSON_INVALID;
+        return JSON_SUCCESS;
+    }
+    if (container->type == JSON_OBJECT) {
+        int found = pointer_find_key(container, seg, len);
+        if (found < 0) return JSON_INVALID;
+        *index = (size_t)found;
+        return JSON_SUCCESS;
+    }
+    return JSON_INVALID;
+}
+
+/**
+ * 定位非空 JSON Pointer 所指节点的父容器，位置路径记录在 log->stack 中
+ * @param write 为 true 时沿途复制共享存储块（包括父容器本身），父容器为紧凑数组时展开，可直接修改；
+ *              为 false 时不修改文档，父容器可能是紧凑数组
+ * @param parent 返回父容器
+ * @param last 返回最后一个片段
+ * @return 错误码
+ */
+static int pointer_parent(PatchLog *log, const char *ptr, bool write,
+                          JsonValue **parent, const char **last, size_t *last_len) {
+    if (*ptr != '/') return JSON_INVALID;
+    log->depth = 0;
+    JsonValue *current = log->root;
+    const char *seg = ptr + 1;
+    for (;;) {
+        size_t len = strcspn(seg, "/");
+        if (!pointer_segment_valid(seg, len)) return JSON_INVALID;
+        if (write && !value_unshare_block(current, 0)) return JSON_MEM_ERROR;
+        if (seg[len] == '\0') {
+            // 展开前保留紧凑形式，补丁失败时恢复
+            if (write && json_is_packed_array(current)) {
+                PatchUndo *u = log_add(log, UNDO_UNPACKED, log->depth, 0);
+                if (!u) return JSON_MEM_ERROR;
+                if (!packed_unpack(current, &u->saved)) {
+                    log_drop(log);
+                    return JSON_MEM_ERROR;
+                }
+            }
+            *parent = current;
+            *last = seg;
+            *last_len = len;
+            return JSON_SUCCESS;
+        }
+        // 紧凑数组的元素是数值，路径无法继续向下
+        if (json_is_packed_array(current)) return JSON_INVALID;
+        size_t index;
+        int error = pointer_child(current, seg, len, &index);
+        if (error) return error;
+        if (!log_push(log, index)) return JSON_MEM_ERROR;
+        current = container_child(current, index);
+        seg += len + 1;
+    }
+}
+
+/**
+ * 读取 JSON Pointer 所指节点，不修改文档
+ * @param tmp 节点是紧凑数组的元素时写入 tmp，*out 指向 tmp
+ */
+static int patch_get(PatchLog *log, const char *ptr, const JsonValue **out, JsonValue *tmp) {
+    if (*ptr == '\0') {
+        *out = log->root;
+        return JSON_SUCCESS;
+    }
+    JsonValue *parent;
+    const char *seg;
+    size_t len, index;
+    int error = pointer_parent(log, ptr, false, &parent, &seg, &len);
+    if (!error) error = pointer_child(parent, seg, len, &index);
+    if (error) return error;
+    if (json_is_packed_array(parent)) {
+        *tmp = packed_element(parent, index);
+        *out = tmp;
+    } else {
+        *out = container_child(parent, index);
+    }
+    return JSON_SUCCESS;
+}
+
+/**
+ * add：数组中插入（"-" 表示末尾），对象中添加或替换
+ * @param value 成功时内容转移给文档，失败时仍归调用方
+ * @return 错误码
+ */
+static int patch_add(PatchLog *log, const char *ptr, JsonValue *value) {
+    PatchUndo *u;
+    if (*ptr == '\0') {
+        if (!(u = log_add(log, UNDO_ROOT, 0, 0))) return JSON_MEM_ERROR;
+        log_save(u, log->root, value);
+        return JSON_SUCCESS;
+    }
+    JsonValue *parent;
+    const char *seg;
+    size_t len;
+    int error = pointer_parent(log, ptr, true, &parent, &seg, &len);
+    if (error) return error;
+
+    if (parent->type == JSON_ARRAY) {
+        size_t count = parent->value.array_value.ele_count, index;
+        if (len == 1 && seg[0] == '-') index = count;
+        else if (!pointer_index(seg, len, &index) || index > count) return JSON_INVALID;
+        if (!(u = log_add(log, UNDO_INSERTED, log->depth, index))) return JSON_MEM_ERROR;
+        if (!array_insert_at(parent, index, value)) {
+            log_drop(log);
+            return JSON_MEM_ERROR;
+        }
+        return JSON_SUCCESS;
+    }
+    if (parent->type != JSON_OBJECT) return JSON_INVALID;
+
+    int found = pointer_find_key(parent, seg, len);
+    if (found >= 0) {
+        if (!(u = log_add(log, UNDO_REPLACED, log->depth, (size_t)found))) return JSON_MEM_ERROR;
+        log_save(u, &parent->value.object_value.pairs[found].value, value);
+        return JSON_SUCCESS;
+    }
+    char *key = pointer_unescape(log->allocator, seg, len);
+    if (!key) return JSON_MEM_ERROR;
+    size_t index = object_append_position(parent, key);
+    JsonPair *pair = NULL;
+    if ((u = log_add(log, UNDO_INSERTED, log->depth, index)) && !(pair = object_insert_slot(parent, index, key))) {
+        log_drop(log);
+    }
+    if (!pair) {
+        mem_free_string(log->allocator, NULL, key);
+        return JSON_MEM_ERROR;
+    }
+    slot_store(&pair->value, value);
+    return JSON_SUCCESS;
+}
+
+static int patch_remove(PatchLog *log, const char *ptr) {
+    if (*ptr == '\0') return JSON_INVALID;
+    JsonValue *parent;
+    const char *seg;
+    size_t len, index;
+    int error = pointer_parent(log, ptr, true, &parent, &seg, &len);
+    if (!error) error = pointer_child(parent, seg, len, &index);
+    if (error) return error;
+
+    PatchUndo *u = log_add(log, UNDO_REMOVED, log->depth, index);
+    if (!u) return JSON_MEM_ERROR;
+    if (parent->type == JSON_ARRAY) {
+        u->saved = *array_remove_at(parent, index);
+    } else {
+        JsonPair pair = object_remove_slot(parent, index);
+        u->key = pair.key;
+        u->saved = pair.value;
+        value_detach(&u->saved);
+    }
+    return JSON_SUCCESS;
+}
+
+static int patch_replace(PatchLog *log, const char *ptr, JsonValue *value) {
+    PatchUndo *u;
+    if (*ptr == '\0') return patch_add(log, ptr, value);
+    JsonValue *parent;
+    const char *seg;
+    size_t len, index;
+    int error = pointer_parent(log, ptr, true, &parent, &seg, &len);
+    if (!error) error = pointer_child(parent, seg, len, &index);
+    if (error) return error;
+
+    if (!(u = log_add(log, UNDO_REPLACED, log->depth, index))) return JSON_MEM_ERROR;
+    log_save(u, container_child(parent, index), value);
+    return JSON_SUCCESS;
+}
+
+static const char *patch_member_string(const JsonValue *op, const char *name) {
+    int index = find_key_index(op, name);
+    if (index < 0) return NULL;
+    const JsonValue *member = &op->value.object_value.pairs[index].value;
+    return member->type == JSON_STRING ? member->value.string_value : NULL;
+}
+
+/**
+ * 执行一个补丁操作。补丁中的值以共享方式加入文档（容器 O(1)，只复制字符串）
+ */
+static int patch_operation(PatchLog *log, const JsonValue *op) {
+    if (op->type != JSON_OBJECT) return JSON_INVALID;
+    const char *name = patch_member_string(op, "op");
+    const char *path = patch_member_string(op, "path");
+    if (!name || !path) return JSON_INVALID;
+    int value_index = find_key_index(op, "value");
+    const JsonValue *value = value_index >= 0 ? &op->value.object_value.pairs[value_index].value : NULL;
+
+    bool add = strcmp(name, "add") == 0;
+    if (add || strcmp(name, "replace") == 0) {
+        JsonValue copy;
+        if (!value) return JSON_INVALID;
+        if (!value_share(&copy, value, log->allocator)) return JSON_MEM_ERROR;
+        int error = add ? patch_add(log, path, &copy) : patch_replace(log, path, &copy);
+        if (error) json_free(&copy);
+        return error;
+    }
+    if (strcmp(name, "remove") == 0) {
+        return patch_remove(log, path);
+    }
+    if (strcmp(name, "test") == 0) {
+        const JsonValue *target;
+        JsonValue tmp;
+        if (!value) return JSON_INVALID;
+        int error = patch_get(log, path, &target, &tmp);
+        if (error) return error;
+        return value_equal(target, value) ? JSON_SUCCESS : JSON_INVALID;
+    }
+
+    bool move = strcmp(name, "move") == 0;
+    if (!move && strcmp(name, "copy") != 0) return JSON_INVALID;
+    const char *from = patch_member_string(op, "from");
+    if (!from) return JSON_INVALID;
+    const JsonValue *source;
+    JsonValue tmp;
+    int error = patch_get(log, from, &source, &tmp);
+    if (error) return error;
+    if (move) {
+        size_t from_len = strlen(from);
+        if (strcmp(from, path) == 0) return JSON_SUCCESS;
+        // 不能移动到自身的子节点中
+        if (strncmp(from, path, from_len) == 0 && path[from_len] == '/') return JSON_INVALID;
+    }
+
+    // 移动时先共享一份再删除源节点：源节点的旧值留在日志中，提交时释放后副本即为独占
+    JsonValue copy;
+    if (!value_share(&copy, source, log->allocator)) return JSON_MEM_ERROR;
+    if (move) error = patch_remove(log, from);
+    if (!error) error = patch_add(log, path, &copy);
+    if (error) json_free(&copy);
+    return error;
+}
+
+/**
+ * 应用 JSON Patch（RFC 6902）：原地修改文档，任一操作失败时回滚全部修改
+ * 开销只与补丁大小及路径深度有关；被写入的紧凑数组展开为普通数组（回滚时恢复紧凑形式），test 与 copy 只原地读取
+ * @param doc
+ * @param patch 操作数组
+ * @return JSON_SUCCESS；操作无效或 test 不满足时返回 JSON_INVALID
+ */
+int json_patch_apply(JsonValue* doc, const JsonValue* patch) {
+    if (!doc || !patch || patch->type != JSON_ARRAY || json_is_frozen(doc) || !value_chain_writable(doc)) {
+        return JSON_INVALID;
+    }
+    PatchLog log = {doc, node_allocator(doc), NULL, 0, 0, NULL, 0, 0, NULL, 0, 0};
+    int error = JSON_SUCCESS;
+    for (size_t i = 0; i < patch->value.array_value.ele_count && !error; i++) {
+        error = patch_operation(&log, &patch->value.array_value.elements[i]);
+    }
+    if (error) log_rollback(&log);
+    log_free(&log);
+    return error;
+}
+
+/**
+ * 用新值替换当前节点（位置路径为 log->stack），记录回滚
+ */
+static int merge_replace(PatchLog *log, JsonValue *target, JsonValue *value) {
+    PatchUndo *u = log->depth
+                   ? log_add(log, UNDO_REPLACED, log->depth - 1, log->stack[log->depth - 1])
+                   : log_add(log, UNDO_ROOT, 0, 0);
+    if (!u) return JSON_MEM_ERROR;
+    log_save(u, target, value);
+    return JSON_SUCCESS;
+}
+
+static int merge_value(PatchLog *log, JsonValue *target, const JsonValue *patch) {
+    if (patch->type != JSON_OBJECT) {
+        JsonValue copy;
+        if (!value_share(&copy, patch, log->allocator)) return JSON_MEM_ERROR;
+        int error = merge_replace(log, target, &copy);
+        if (error) json_free(&copy);
+        return error;
+    }
+    if (target->type != JSON_OBJECT) {
+        JsonValue empty = {.type = JSON_OBJECT, .value.object_value = {NULL, 0}};
+        int error = merge_replace(log, target, &empty);
+        if (error) return error;
+    }
+    if (!value_unshare_block(target, 0)) return JSON_MEM_ERROR;
+
+    for (size_t i = 0; i < patch->value.object_value.pair_count; i++) {
+        const JsonPair *change = &patch->value.object_value.pairs[i];
+        int index = find_key_index(target, change->key);
+        PatchUndo *u;
+
+        if (change->value.type == JSON_NULL) {
+            if (index < 0) continue;
+            if (!(u = log_add(log, UNDO_REMOVED, log->depth, (size_t)index))) return JSON_MEM_ERROR;
+            JsonPair pair = object_remove_slot(target, (size_t)index);
+            u->key = pair.key;
+            u->saved = pair.value;
+            value_detach(&u->saved);
+            continue;
+        }
+        if (index < 0) {
+            char *key = mem_strdup(log->allocator, NULL, change->key);
+            if (!key) return JSON_MEM_ERROR;
+            size_t pos = object_append_position(target, key);
+            JsonPair *pair = NULL;
+            if ((u = log_add(log, UNDO_INSERTED, log->depth, pos)) && !(pair = object_insert_slot(target, pos, key))) {
+                log_drop(log);
+            }
+            if (!pair) {
+                mem_free_string(log->allocator, NULL, key);
+                return JSON_MEM_ERROR;
+            }
+            index = (int)pos;
+            // 新键的值为标量或数组时直接共享，插入记录回滚时一并释放
+            if (change->value.type != JSON_OBJECT) {
+                JsonValue copy;
+                if (!value_share(&copy, &change->value, log->allocator)) return JSON_MEM_ERROR;
+                slot_store(&pair->value, &copy);
+                continue;
+            }
+        }
+        if (!log_push(log, (size_t)index)) return JSON_MEM_ERROR;
+        int error = merge_value(log, &target->value.object_value.pairs[index].value, &change->value);
+        log->depth--;
+        if (error) return error;
+    }
+    return JSON_SUCCESS;
+}
+
+/**
+ * 应用 JSON Merge Patch（RFC 7396）：原地修改文档，失败时回滚全部修改
+ * @param doc
+ * @param patch
+ * @return 错误码
+ */
+int json_merge_patch_apply(JsonValue* doc, const JsonValue* patch) {
+    if (!doc || !patch || json_is_frozen(doc) || !value_chain_writable(doc)) return JSON_INVALID;
+    PatchLog log = {doc, node_allocator(doc), NULL, 0, 0, NULL, 0, 0, NULL, 0, 0};
+    int error = merge_value(&log, doc, patch);
+    if (error) log_rollback(&log);
+    log_free(&log);
+    return error;
+}
+
+/**
+ * 按 json_get 路径插入：末段为键时添加键值对（已存在则替换并释放旧值），
+ * 末段为 [n] 时插入到数组第 n 个位置；new_item 的内容转移给文档（同 array_append）
+ * @param root
+ * @param path
+ * @param new_item
+ * @return
+ */
+int json_insert(JsonValue** root, const char* path, JsonValue* new_item) {
+    if (!root || !*root || !path || !new_item) return 0;
+    size_t len = strlen(path);
+    if (len == 0) return 0;
+
+    if (path[len - 1] == ']') {
+        size_t open = len - 1;
+        while (open > 0 && path[open] != '[') open--;
+        if (path[open] != '[') return 0;
+        size_t index;
+        if (!pointer_index(path + open + 1, len - open - 2, &index)) return 0;
+        JsonValue *parent = path_resolve(*root, path, open, true);
+        return parent && json_array_unpack(parent) && array_insert_at(parent, index, new_item);
+    }
+
+    size_t dot = len;
+    while (dot > 0 && path[dot - 1] != '.' && path[dot - 1] != ']') dot--;
+    const char *key = path + dot;
+    JsonValue *parent = path_resolve(*root, path, dot, true);
+    if (!parent || parent->type != JSON_OBJECT) return 0;
+
+    int index = find_key_index(parent, key);
+    if (index < 0) return object_add_pair(parent, key, new_item);
+    if (!value_unshare(parent, 0)) return 0;
+    JsonValue *slot = &parent->value.object_value.pairs[index].value;
+    json_free(slot);
+    slot_store(slot, new_item);
+    return 1;
+}
+
+// ============================= JSON Patch end ================================
+
+// ============================= 结构哈希与差异 start ================================
+
+#define HASH_SEED_NULL   0x6e756c6c00000001ULL
+#define HASH_SEED_BOOL   0x626f6f6c00000002ULL
+#define HASH_SEED_NUMBER 0x6e756d6200000003ULL
+#define HASH_SEED_STRING 0x7374726900000004ULL
+#define HASH_SEED_LIST   0x6c69737400000005ULL
+#define HASH_SEED_OBJECT 0x6f626a6500000006ULL
+#define HASH_SEED_KEY    0x6b65790000000007ULL
+#define HASH_MULTIPLIER  0x9e3779b97f4a7c15ULL
+
+/**
+ * 64 位混合（splitmix64 的收尾变换）
+ */
+static uint64_t hash_mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t hash_bytes(const char *data, size_t len, uint64_t seed) {
+    uint64_t h = seed ^ (len * HASH_MULTIPLIER);
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        h = hash_mix(h ^ word);
+        data += 8;
+        len -= 8;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, data, len);
+    return hash_mix(h ^ tail);
+}
+
+/**
+ * 数值哈希与 value_equal 一致：不区分 int/float/double，整数值按 int64 计算
+ */
+static uint64_t hash_number(long double x) {
+    if (x >= -9223372036854775808.0L && x < 9223372036854775808.0L && x == (long double)(int64_t)x) {
+        return hash_mix(HASH_SEED_NUMBER ^ (uint64_t)(int64_t)x);
+    }
+    double d = (double)x;
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return hash_mix(HASH_SEED_NUMBER ^ hash_mix(bits));
+}
+
+/**
+ * 结构哈希：相等（value_equal）的值哈希相同，紧凑数组与同元素的普通数组哈希相同
+ * 键序无关的哈希缓存在存储块中，修改接口经写时复制路径使其失效；结果不为 0
+ * @param jv
+ * @param unordered 对象哈希与键值对顺序无关
+ * @return
+ */
+static uint64_t value_hash(const JsonValue *jv, bool unordered) {
+    long double number;
+    if (value_number(jv, &number)) return hash_number(number);
+    switch (jv->type) {
+        case JSON_NULL:   return hash_mix(HASH_SEED_NULL);
+        case JSON_BOOL:   return hash_mix(HASH_SEED_BOOL + jv->value.bool_value);
+        case JSON_STRING: {
+            const char *str = jv->value.string_value;
+            return hash_bytes(str, strlen(str), HASH_SEED_STRING);
+        }
+        default: break;
+    }
+
+    void *data = value_block(jv);
+    if (unordered && data) {
+        uint64_t cached = atomic_load_explicit(&BLOCK_OF(data)->hash, memory_order_acquire);
+        if (cached) return cached;
+    }
+
+    uint64_t h;
+    if (jv->type == JSON_OBJECT) {
+        size_t count = jv->value.object_value.pair_count;
+        h = HASH_SEED_OBJECT;
+        for (size_t i = 0; i < count; i++) {
+            const JsonPair *pair = &jv->value.object_value.pairs[i];
+            uint64_t pair_hash = hash_mix(hash_bytes(pair->key, strlen(pair->key), HASH_SEED_KEY) +
+                                          value_hash(&pair->value, unordered) * HASH_MULTIPLIER);
+            // 键序无关时用加法合并，与遍历顺序无关
+            h = unordered ? h + pair_hash : hash_mix(h ^ pair_hash);
+        }
+        h = hash_mix(h ^ count);
+    } else {
+        size_t count = json_array_size(jv);
+        h = HASH_SEED_LIST;
+        for (size_t i = 0; i < count; i++) {
+            long double x;
+            uint64_t elem_hash = jv->type == JSON_ARRAY
+                    ? value_hash(&jv->value.array_value.elements[i], unordered)
+                    : (list_number(jv, i, &x), hash_number(x));
+            h = hash_mix(h ^ elem_hash);
+        }
+        h = hash_mix(h ^ count);
+    }
+    if (h == 0) h = 1;
+
+    // 多个线程同时计算得到的是同一个值，直接覆盖
+    if (unordered && data) atomic_store_explicit(&BLOCK_OF(data)->hash, h, memory_order_release);
+    return h;
+}
+
+/**
+ * 文档的结构哈希，可用于去重和变化检测
+ * @param jv
+ * @param flags JSON_HASH_* 组合
+ * @return
+ */
+uint64_t json_hash(const JsonValue* jv, unsigned int flags) {
+    if (!jv) return 0;
+    return value_hash(jv, (flags & JSON_HASH_UNORDERED) != 0);
+}
+
+/**
+ * 比较两个文档：数值不区分 int/float/double，对象与键序无关；
+ * 共享同一存储块的子树直接视为相等，已缓存的哈希不同时立即返回
+ * @param a
+ * @param b
+ * @return
+ */
+bool json_equal(const JsonValue* a, const JsonValue* b) {
+    if (!a || !b) return a == b;
+    return a == b || value_equal(a, b);
+}
+
+typedef struct {
+    JsonValue ops;   // 生成的补丁数组
+    char *path;      // 当前 JSON Pointer
+    size_t len, capacity;
+    int error;
+} DiffContext;
+
+static bool diff_path_reserve(DiffContext *ctx, size_t extra) {
+    if (ctx->len + extra + 1 <= ctx->capacity) return true;
+    size_t capacity = ctx->capacity ? ctx->capacity * 2 : 64;
+    while (capacity < ctx->len + extra + 1) capacity *= 2;
+    char *path = json_realloc(ctx->path, capacity);
+    if (!path) {
+        ctx->error = JSON_MEM_ERROR;
+        return false;
+    }
+    ctx->path = path;
+    ctx->capacity = capacity;
+    return true;
+}
+
+/**
+ * 追加一段对象键（按 RFC 6901 转义 ~ 与 /）
+ */
+static bool diff_push_key(DiffContext *ctx, const char *key) {
+    size_t key_len = strlen(key);
+    if (!diff_path_reserve(ctx, key_len * 2 + 1)) return false;
+    ctx->path[ctx->len++] = '/';
+    for (size_t i = 0; i < key_len; i++) {
+        if (key[i] == '~' || key[i] == '/') {
+            ctx->path[ctx->len++] = '~';
+            ctx->path[ctx->len++] = key[i] == '~' ? '0' : '1';
+        } else {
+            ctx->path[ctx->len++] = key[i];
+        }
+    }
+    ctx->path[ctx->len] = '\0';
+    return true;
+}
+
+static bool diff_push_index(DiffContext *ctx, size_t index) {
+    if (!diff_path_reserve(ctx, 24)) return false;
+    ctx->path[ctx->len++] = '/';
+    ctx->len += (size_t)format_int64(ctx->path + ctx->len, (int64_t)index);
+    ctx->path[ctx->len] = '\0';
+    return true;
+}
+
+/**
+ * 生成一个操作；value 以共享方式加入补丁（只增加存储块的共享计数）
+ */
+static void diff_emit(DiffContext *ctx, const char *op, const JsonValue *value) {
+    if (ctx->error) return;
+    JsonValue *entry = array_emplace(&ctx->ops);
+    if (!entry) {
+        ctx->error = JSON_MEM_ERROR;
+        return;
+    }
+    json_set_object(entry);
+    JsonValue *name = object_emplace(entry, "op");
+    if (!name || !json_set_string(name, op)) {
+        ctx->error = JSON_MEM_ERROR;
+        return;
+    }
+    JsonValue *path = object_emplace(entry, "path");
+    if (!path || !json_set_string_n(path, ctx->path ? ctx->path : "", ctx->len)) {
+        ctx->error = JSON_MEM_ERROR;
+        return;
+    }
+    if (value) {
+        JsonValue *slot = object_emplace(entry, "value");
+        JsonValue copy;
+        if (!slot || !value_share(&copy, value, value_allocator(slot))) {
+            ctx->error = JSON_MEM_ERROR;
+            return;
+        }
+        slot_store(slot, &copy);
+    }
+}
+
+static void diff_value(DiffContext *ctx, const JsonValue *a, const JsonValue *b) {
+    if (ctx->error) return;
+    // 结构哈希不同的容器必然不等，直接进入；哈希相同只作为提示，仍以 value_equal 确认，碰撞时照常生成差异
+    if (value_block(a) && value_block(b)) {
+        if (value_hash(a, true) == value_hash(b, true) && value_equal(a, b)) return;
+    } else if (value_equal(a, b)) {
+        return;
+    }
+
+    size_t base = ctx->len;
+    if (a->type == JSON_OBJECT && b->type == JSON_OBJECT) {
+        const JsonPair *pairs = a->value.object_value.pairs;
+        const JsonPair *others = b->value.object_value.pairs;
+        for (size_t i = 0; i < a->value.object_value.pair_count && !ctx->error; i++) {
+            int index = find_key_index(b, pairs[i].key);
+            if (!diff_push_key(ctx, pairs[i].key)) return;
+            if (index < 0) diff_emit(ctx, "remove", NULL);
+            else diff_value(ctx, &pairs[i].value, &others[index].value);
+            ctx->len = base;
+        }
+        for (size_t i = 0; i < b->value.object_value.pair_count && !ctx->error; i++) {
+            if (find_key_index(a, others[i].key) >= 0) continue;
+            if (!diff_push_key(ctx, others[i].key)) return;
+            diff_emit(ctx, "add", &others[i].value);
+            ctx->len = base;
+        }
+        return;
+    }
+    if (a->type == JSON_ARRAY && b->type == JSON_ARRAY) {
+        // 按位置比较：公共部分逐个递归，多出的元素从尾部删除或追加
+        size_t a_count = a->value.array_value.ele_count;
+        size_t b_count = b->value.array_value.ele_count;
+        size_t common = a_count < b_count ? a_count : b_count;
+        for (size_t i = 0; i < common && !ctx->error; i++) {
+            if (!diff_push_index(ctx, i)) return;
+            diff_value(ctx, &a->value.array_value.elements[i], &b->value.array_value.elements[i]);
+            ctx->len = base;
+        }
+        for (size_t i = a_count; i > common && !ctx->error; i--) {
+            if (!diff_push_index(ctx, i - 1)) return;
+            diff_emit(ctx, "remove", NULL);
+            ctx->len = base;
+        }
+        for (size_t i = common; i < b_count && !ctx->error; i++) {
+            if (!diff_path_reserve(ctx, 2)) return;
+            memcpy(ctx->path + ctx->len, "/-", 3);
+            ctx->len += 2;
+            diff_emit(ctx, "add", &b->value.array_value.elements[i]);
+            ctx->len = base;
+        }
+        return;
+    }
+    // 类型不同、标量不等或紧凑数组不等：整体替换
+    diff_emit(ctx, "replace", b);
+}
+
+/**
+ * 生成把 from 变为 to 的 JSON Patch（RFC 6902），结构哈希不同的子树直接进入，哈希相同的子树逐值确认；
+ * 数组按位置比较。补丁中的值与 to 共享存储块，可在 to 释放后继续使用（flat 文档除外）
+ * @param from
+ * @param to
+ * @param error
+ * @return 操作数组，json_free 释放；相同时为空数组
+ */
+JsonValue json_diff(const JsonValue* from, const JsonValue* to, int* error) {
+    DiffContext ctx = {{.type = JSON_ARRAY, .value.array_value = {NULL, 0}}, NULL, 0, 0, JSON_SUCCESS};
+    if (!from || !to) {
+        *error = JSON_INVALID;
+        return (JsonValue){.type = JSON_NULL};
+    }
+    diff_value(&ctx, from, to);
+    json_mem_free(ctx.path);
+    *error = ctx.error;
+    if (ctx.error) {
+        json_free(&ctx.ops);
+        return (JsonValue){.type = JSON_NULL};
+    }
+    return ctx.ops;
+}
+
+// ============================= 结构哈希与差异 end ================================
+
+// ============================= 结构体绑定 start ================================
+
+#define BIND_MAX_DEPTH 1024
+
+static size_t field_elem_size(JsonFieldType type, const JsonStructDesc *desc) {
+    switch (type) {
+        case JSON_FIELD_BOOL:   return sizeof(bool);
+        case JSON_FIELD_INT:    return sizeof(int);
+        case JSON_FIELD_INT64:  return sizeof(int64_t);
+        case JSON_FIELD_FLOAT:  return sizeof(float);
+        case JSON_FIELD_DOUBLE: return sizeof(double);
+        case JSON_FIELD_STRING: return sizeof(char *);
+        case JSON_FIELD_STRUCT: return desc ? desc->size : 0;
+        default:                return 0;
+    }
+}
+
+static void bind_release_struct(const JsonStructDesc *desc, void *base);
+
+/**
+ * 释放一个槽位持有的内存并清零（重复键覆盖或出错时使用）
+ */
+static void bind_release(JsonFieldType type, const JsonStructDesc *desc, void *slot) {
+    if (type == JSON_FIELD_STRING) {
+        json_mem_free(*(char **)slot);
+        *(char **)slot = NULL;
+    } else if (type == JSON_FIELD_STRUCT && desc) {
+        bind_release_struct(desc, slot);
+        memset(slot, 0, desc->size);
+    }
+}
+
+static void bind_release_array(const JsonField *field, void *base) {
+    char **items = (char **)((char *)base + field->offset);
+    size_t *count = (size_t *)((char *)base + field->count_offset);
+    size_t elem_size = field_elem_size(field->elem_type, field->desc);
+    for (size_t i = 0; *items && i < *count; i++) {
+        bind_release(field->elem_type, field->desc, *items + i * elem_size);
+    }
+    json_mem_free(*items);
+    *items = NULL;
+    *count = 0;
+}
+
+static void bind_release_struct(const JsonStructDesc *desc, void *base) {
+    for (size_t i = 0; i < desc->field_count; i++) {
+        const JsonField *field = &desc->fields[i];
+        if (field->type == JSON_FIELD_ARRAY) bind_release_array(field, base);
+        else bind_release(field->type, field->desc, (char *)base + field->offset);
+    }
+}
+
+/**
+ * 释放 json_decode_struct 分配的字符串与数组，结构体本身由调用方管理
+ * @param desc
+ * @param obj
+ */
+void json_struct_free(const JsonStructDesc* desc, void* obj) {
+    if (!desc || !obj) return;
+    bind_release_struct(desc, obj);
+}
+
+/**
+ * 跳过一个值（未知键）：只做括号配对和字符串扫描，不分配内存，不校验字面量
+ */
+static int bind_skip_value(ParserContext *ctx) {
+    size_t depth = 0;
+    do {
+        skip_whitespace(ctx);
+        char c = *ctx->pos;
+        if (c == '"') {
+            ctx->pos++;
+            while (*ctx->pos != '"') {
+                if (*ctx->pos == '\0') return JSON_INVALID;
+                if (*ctx->pos == '\\' && ctx->pos[1] != '\0') ctx->pos++;
+                ctx->pos++;
+            }
+            ctx->pos++;
+        } else if (c == '{' || c == '[') {
+            depth++;
+            ctx->pos++;
+        } else if (c == '}' || c == ']' || c == ',' || c == ':') {
+            if (depth == 0) return JSON_INVALID;
+            if (c == '}' || c == ']') depth--;
+            ctx->pos++;
+        } else {
+            // 数字与字面量
+            const char *start = ctx->pos;
+            while (*ctx->pos && !strchr(",:]}\"{[", *ctx->pos) && !isspace((unsigned char)*ctx->pos)) ctx->pos++;
+            if (ctx->pos == start) return JSON_INVALID;
+        }
+    } while (depth > 0);
+    return JSON_SUCCESS;
+}
+
+/**
+ * 按键查找字段。键通常按字段表顺序出现，从上一次命中的下一个字段开始查找
+ */
+static const JsonField *bind_find_field(const JsonStructDesc *desc, const char *key, size_t len, size_t *hint) {
+    for (size_t n = 0; n < desc->field_count; n++) {
+        size_t i = (*hint + n) % desc->field_count;
+        const char *name = desc->fields[i].name;
+        if (strncmp(name, key, len) == 0 && name[len] == '\0') {
+            *hint = i + 1;
+            return &desc->fields[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * 读取键并查找字段：无转义的键直接在输入中比较，不分配内存
+ */
+static int bind_read_key(ParserContext *ctx, const JsonStructDesc *desc, size_t *hint, const JsonField **field) {
+    *field = NULL;
+    if (*ctx->pos != '"') return JSON_INVALID;
+    const char *start = ctx->pos + 1;
+    const char *p = start;
+    while (*p != '"' && *p != '\\' && *p != '\0') p++;
+    if (*p == '"') {
+        *field = bind_find_field(desc, start, (size_t)(p - start), hint);
+        ctx->pos = p + 1;
+        return JSON_SUCCESS;
+    }
+    int error = JSON_SUCCESS;
+    char *key = parse_string(ctx, &error);
+    if (error) return error;
+    *field = bind_find_field(desc, key, strlen(key), hint);
+    mem_free_string(ctx->allocator, ctx->stats, key);
+    return JSON_SUCCESS;
+}
+
+static int bind_decode_object(ParserContext *ctx, const JsonStructDesc *desc, void *base, int depth);
+
+/**
+ * 解码一个标量或嵌套结构体到 slot，null 使槽位清零
+ */
+static int bind_decode_value(ParserContext *ctx, JsonFieldType type, const JsonStructDesc *desc,
+                             size_t size, void *slot, int depth) {
+    skip_whitespace(ctx);
+    if (strncmp(ctx->pos, "null", 4) == 0) {
+        ctx->pos += 4;
+        bind_release(type, desc, slot);
+        memset(slot, 0, type == JSON_FIELD_CHARS ? size : field_elem_size(type, desc));
+        return JSON_SUCCESS;
+    }
+
+    switch (type) {
+        case JSON_FIELD_BOOL:
+            if (strncmp(ctx->pos, "true", 4) == 0) {
+                ctx->pos += 4;
+                *(bool *)slot = true;
+            } else if (strncmp(ctx->pos, "false", 5) == 0) {
+                ctx->pos += 5;
+                *(bool *)slot = false;
+            } else {
+                return JSON_INVALID;
+            }
+            return JSON_SUCCESS;
+
+        case JSON_FIELD_INT:
+        case JSON_FIELD_INT64:
+        case JSON_FIELD_FLOAT:
+        case JSON_FIELD_DOUBLE: {
+            if (!isdigit((unsigned char)*ctx->pos) && *ctx->pos != '-') return JSON_INVALID;
+            const char *end;
+            double dbl_val;
+            JsonType kind = scan_number(ctx->pos, &end, &dbl_val);
+            if (kind == JSON_NULL) return JSON_INVALID;
+            if (type == JSON_FIELD_INT) {
+                if (kind != JSON_INT) return JSON_INVALID;
+                *(int *)slot = (int)dbl_val;
+            } else if (type == JSON_FIELD_INT64) {
+                // 纯整数用 strtoll 保留 64 位精度
+                char *int_end;
+                errno = 0;
+                long long ll = strtoll(ctx->pos, &int_end, 10);
+                if (int_end == end && errno == 0) {
+                    *(int64_t *)slot = ll;
+                } else if (fmod(dbl_val, 1.0) == 0.0 && dbl_val >= -9223372036854775808.0 &&
+                           dbl_val < 9223372036854775808.0) {
+                    *(int64_t *)slot = (int64_t)dbl_val;
+                } else {
+                    return JSON_INVALID;
+                }
+            } else if (type == JSON_FIELD_FLOAT) {
+                *(float *)slot = (float)dbl_val;
+            } else {
+                *(double *)slot = dbl_val;
+            }
+            ctx->pos = end;
+            return JSON_SUCCESS;
+        }
+
+        case JSON_FIELD_STRING:
+        case JSON_FIELD_CHARS: {
+            int error = JSON_SUCCESS;
+            char *str = parse_string(ctx, &error);
+            if (error) return error;
+            if (type == JSON_FIELD_STRING) {
+                json_mem_free(*(char **)slot);
+                *(char **)slot = str;
+                return JSON_SUCCESS;
+            }
+            // 定长缓冲放不下时报错，不截断
+            size_t len = strlen(str);
+            if (len >= size) error = JSON_INVALID;
+            else memcpy(slot, str, len + 1);
+            mem_free_string(ctx->allocator, ctx->stats, str);
+            return error;
+        }
+
+        case JSON_FIELD_STRUCT:
+            if (!desc) return JSON_INVALID;
+            return bind_decode_object(ctx, desc, slot, depth + 1);
+
+        default:
+            return JSON_INVALID;
+    }
+}
+
+static int bind_decode_array(ParserContext *ctx, const JsonField *field, void *base, int depth) {
+    skip_whitespace(ctx);
+    if (strncmp(ctx->pos, "null", 4) == 0) {
+        ctx->pos += 4;
+        bind_release_array(field, base);
+        return JSON_SUCCESS;
+    }
+    size_t elem_size = field_elem_size(field->elem_type, field->desc);
+    if (*ctx->pos != '[' || elem_size == 0) return JSON_INVALID;
+    ctx->pos++;
+
+    char *items = NULL;
+    size_t count = 0, capacity = 0;
+    int error = JSON_SUCCESS;
+    for (;;) {
+        skip_whitespace(ctx);
+        if (*ctx->pos == ']') {
+            ctx->pos++;
+            break;
+        }
+        if (count == capacity) {
+            size_t new_capacity = capacity ? capacity * 2 : 4;
+            char *new_items = json_realloc(items, new_capacity * elem_size);
+            if (!new_items) {
+                error = JSON_MEM_ERROR;
+                break;
+            }
+            items = new_items;
+            capacity = new_capacity;
+        }
+        char *slot = items + count * elem_size;
+        memset(slot, 0, elem_size);
+        count++;
+        error = bind_decode_value(ctx, field->elem_type, field->desc, elem_size, slot, depth);
+        if (error) break;
+
+        skip_whitespace(ctx);
+        if (*ctx->pos == ',') {
+            ctx->pos++;
+        } else if (*ctx->pos != ']') {
+            error = JSON_INVALID;
+            break;
+        }
+    }
+
+    if (error) {
+        for (size_t i = 0; i < count; i++) bind_release(field->elem_type, field->desc, items + i * elem_size);
+        json_mem_free(items);
+        return error;
+    }
+    // 重复键时后出现的值覆盖之前的数组
+    bind_release_array(field, base);
+    *(char **)((char *)base + field->offset) = items;
+    *(size_t *)((char *)base + field->count_offset) = count;
+    return JSON_SUCCESS;
+}
+
+static int bind_decode_object(ParserContext *ctx, const JsonStructDesc *desc, void *base, int depth) {
+    if (depth > BIND_MAX_DEPTH) return JSON_TOO_DEEP;
+    skip_whitespace(ctx);
+    if (*ctx->pos != '{') return JSON_INVALID;
+    ctx->pos++;
+
+    size_t hint = 0;
+    for (;;) {
+        skip_whitespace(ctx);
+        if (*ctx->pos == '}') {
+            ctx->pos++;
+            return JSON_SUCCESS;
+        }
+        const JsonField *field = NULL;
+        int error = bind_read_key(ctx, desc, &hint, &field);
+        if (error) return error;
+        skip_whitespace(ctx);
+        if (*ctx->pos != ':') return JSON_INVALID;
+        ctx->pos++;
+
+        if (!field) error = bind_skip_value(ctx);
+        else if (field->type == JSON_FIELD_ARRAY) error = bind_decode_array(ctx, field, base, depth);
+        else error = bind_decode_value(ctx, field->type, field->desc, field->size,
+                                       (char *)base + field->offset, depth);
+        if (error) return error;
+
+        skip_whitespace(ctx);
+        if (*ctx->pos == ',') {
+            ctx->pos++;
+        } else if (*ctx->pos != '}') {
+            return JSON_INVALID;
+        }
+    }
+}
+
+/**
+ * 按字段表把 JSON 对象直接解码到结构体，不构建 JsonValue 树
+ * out 先被清零，缺少的键保持为 0/NULL，未知键被跳过；失败时释放已分配的内容
+ * @param json
+ * @param desc
+ * @param out 大小为 desc->size 的结构体
+ * @return 错误码
+ */
+int json_decode_struct(const char* json, const JsonStructDesc* desc, void* out) {
+    if (!json || !desc || !out) return JSON_INVALID;
+    memset(out, 0, desc->size);
+    ParserContext ctx = {.start = json, .pos = json, .allocator = &g_allocator};
+    int error = bind_decode_object(&ctx, desc, out, 0);
+    if (!error) {
+        skip_whitespace(&ctx);
+        if (*ctx.pos != '\0') error = JSON_INVALID;
+    }
+    if (error) json_struct_free(desc, out);
+    return error;
+}
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} BindWriter;
+
+static char *bind_reserve(BindWriter *w, size_t n) {
+    if (w->failed) return NULL;
+    if (w->length + n > w->capacity) {
+        size_t capacity = w->capacity ? w->capacity * 2 : 256;
+        while (capacity < w->length + n) capacity *= 2;
+        char *data = json_realloc(w->data, capacity);
+        if (!data) {
+            w->failed = true;
+            return NULL;
+        }
+        w->data = data;
+        w->capacity = capacity;
+    }
+    return w->data + w->length;
+}
+
+static void bind_write(BindWriter *w, const char *s, size_t n) {
+    char *dst = bind_reserve(w, n);
+    if (!dst) return;
+    memcpy(dst, s, n);
+    w->length += n;
+}
+
+/**
+ * 写入带引号的字符串，转义引号、反斜杠和控制字符，解码后可还原
+ */
+static void bind_write_string(BindWriter *w, const char *s, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+    bind_write(w, "\"", 1);
+    size_t plain = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        bind_write(w, s + plain, i - plain);
+        plain = i + 1;
+        char esc[6] = {'\\', (char)c, 0, 0, 0, 0};
+        size_t esc_len = 2;
+        switch (c) {
+            case '"': case '\\': break;
+            case '\n': esc[1] = 'n'; break;
+            case '\r': esc[1] = 'r'; break;
+            case '\t': esc[1] = 't'; break;
+            case '\b': esc[1] = 'b'; break;
+            case '\f': esc[1] = 'f'; break;
+            default:
+                memcpy(esc + 1, "u00", 3);
+                esc[4] = hex[c >> 4];
+                esc[5] = hex[c & 0xF];
+                esc_len = 6;
+        }
+        bind_write(w, esc, esc_len);
+    }
+    bind_write(w, s + plain, len - plain);
+    bind_write(w, "\"", 1);
+}
+
+static void bind_encode_object(BindWriter *w, const JsonStructDesc *desc, const void *base);
+
+/**
+ * 数值格式与 json_to_string 一致
+ */
+static void bind_encode_value(BindWriter *w, JsonFieldType type, const JsonStructDesc *desc,
+                              size_t size, const void *slot) {
+    char num[64];
+    switch (type) {
+        case JSON_FIELD_BOOL:
+            if (*(const bool *)slot) bind_write(w, "true", 4);
+            else bind_write(w, "false", 5);
+            break;
+        case JSON_FIELD_INT:
+            bind_write(w, num, (size_t)format_int64(num, *(const int *)slot));
+            break;
+        case JSON_FIELD_INT64:
+            bind_write(w, num, (size_t)format_int64(num, *(const int64_t *)slot));
+            break;
+        case JSON_FIELD_FLOAT:
+            bind_write(w, num, (size_t)snprintf(num, sizeof(num), "%.6g", *(const float *)slot));
+            break;
+        case JSON_FIELD_DOUBLE:
+            bind_write(w, num, (size_t)snprintf(num, sizeof(num), "%.14g", *(const double *)slot));
+            break;
+        case JSON_FIELD_STRING: {
+            const char *str = *(char *const *)slot;
+            if (str) bind_write_string(w, str, strlen(str));
+            else bind_write(w, "null", 4);
+            break;
+        }
+        case JSON_FIELD_CHARS: {
+            const char *str = slot;
+            size_t len = 0;
+            while (len < size && str[len]) len++;
+            bind_write_string(w, str, len);
+            break;
+        }
+        case JSON_FIELD_STRUCT:
+            if (desc) bind_encode_object(w, desc, slot);
+            else bind_write(w, "null", 4);
+            break;
+        default:
+            bind_write(w, "null", 4);
+            break;
+    }
+}
+
+static void bind_encode_object(BindWriter *w, const JsonStructDesc *desc, const void *base) {
+    bind_write(w, "{", 1);
+    for (size_t i = 0; i < desc->field_count; i++) {
+        const JsonField *field = &desc->fields[i];
+        const char *slot = (const char *)base + field->offset;
+        if (i > 0) bind_write(w, ",", 1);
+        bind_write_string(w, field->name, strlen(field->name));
+        bind_write(w, ":", 1);
+        if (field->type != JSON_FIELD_ARRAY) {
+            bind_encode_value(w, field->type, field->desc, field->size, slot);
+            continue;
+        }
+        const char *items = *(char *const *)slot;
+        size_t count = *(const size_t *)((const char *)base + field->count_offset);
+        size_t elem_size = field_elem_size(field->elem_type, field->desc);
+        bind_write(w, "[", 1);
+        for (size_t k = 0; items && k < count; k++) {
+            if (k > 0) bind_write(w, ",", 1);
+            bind_encode_value(w, field->elem_type, field->desc, elem_size, items + k * elem_size);
+        }
+        bind_write(w, "]", 1);
+    }
+    bind_write(w, "}", 1);
+}
+
+/**
+ * 按字段表把结构体直接编码为 JSON 文本，不构建 JsonValue 树
+ * @param desc
+ * @param obj
+ * @return 以 NUL 结尾的字符串，释放方式同 json_to_string；失败返回 NULL
+ */
+char* json_encode_struct(const JsonStructDesc* desc, const void* obj) {
+    if (!desc || !obj) return NULL;
+    BindWriter w = {NULL, 0, 0, false};
+    bind_encode_object(&w, desc, obj);
+    bind_write(&w, "", 1);
+    if (w.failed) {
+        json_mem_free(w.data);
+        return NULL;
+    }
+    return w.data;
+}
+
+// ============================= 结构体绑定 end ================================
+
+// ============================= 并行序列化 start ================================
+
+#define SERIAL_MIN_SPLIT 4096        // 子元素数达到该值的容器才在内部拆分
+#define SERIAL_CHUNKS_PER_THREAD 4   // 每个拆分的容器按线程数的倍数分块，便于动态均衡
+#if defined(IOV_MAX) && IOV_MAX < 1024
+#define SERIAL_IOV_MAX IOV_MAX
+#else
+#define SERIAL_IOV_MAX 1024
+#endif
+
+typedef enum {
+    SEG_GLUE,    // 括号、逗号、键等连接文本，位于 glue 缓冲中
+    SEG_VALUE,   // 整个值
+    SEG_ARRAY,   // 数组元素区间 [begin, end)，元素间以逗号分隔
+    SEG_OBJECT,  // 对象键值对区间
+    SEG_PACKED   // 紧凑数组元素区间
+} SerialSegKind;
+
+typedef struct {
+    SerialSegKind kind;
+    const JsonValue *node;
+    size_t begin, end;  // 元素区间；GLUE 为 glue 缓冲中的字节区间
+    char *buf;          // 序列化结果，GLUE 指向 glue 缓冲
+    size_t len;
+} SerialSeg;
+
+typedef struct {
+    SerialSeg *segs;
+    size_t seg_count, seg_cap;
+    char *glue;
+    size_t glue_len, glue_cap;
+    size_t threads;
+    size_t min_split;
+    bool failed;
+    atomic_size_t next;  // 下一个待执行的段
+    atomic_bool task_failed;
+} SerialPlan;
+
+static SerialSeg *serial_add_seg(SerialPlan *p, SerialSegKind kind, const JsonValue *node, size_t begin, size_t end) {
+    if (p->failed) return NULL;
+    if (p->seg_count == p->seg_cap) {
+        size_t cap = p->seg_cap ? p->seg_cap * 2 : 64;
+        SerialSeg *segs = json_realloc(p->segs, cap * sizeof(SerialSeg));
+        if (!segs) {
+            p->failed = true;
+            return NULL;
+        }
+        p->segs = segs;
+        p->seg_cap = cap;
+    }
+    SerialSeg *seg = &p->segs[p->seg_count++];
+    seg->kind = kind;
+    seg->node = node;
+    seg->begin = begin;
+    seg->end = end;
+    seg->buf = NULL;
+    seg->len = 0;
+    return seg;
+}
+
+/**
+ * 追加连接文本，与前一个 GLUE 段相邻时合并
+ */
+static void serial_glue(SerialPlan *p, const char *text, size_t len) {
+    if (p->failed) return;
+    if (p->glue_len + len > p->glue_cap) {
+        size_t cap = p->glue_cap ? p->glue_cap * 2 : 256;
+        while (cap < p->glue_len + len) cap *= 2;
+        char *glue = json_realloc(p->glue, cap);
+        if (!glue) {
+            p->failed = true;
+            return;
+        }
+        p->glue = glue;
+        p->glue_cap = cap;
+    }
+    memcpy(p->glue + p->glue_len, text, len);
+    size_t begin = p->glue_len;
+    p->glue_len += len;
+    if (p->seg_count > 0 && p->segs[p->seg_count - 1].kind == SEG_GLUE) {
+        p->segs[p->seg_count - 1].end = p->glue_len;
+        return;
+    }
+    serial_add_seg(p, SEG_GLUE, NULL, begin, p->glue_len);
+}
+
+static size_t serial_child_count(const JsonValue *jv) {
+    switch (jv->type) {
+        case JSON_ARRAY:  return jv->value.array_value.ele_count;
+        case JSON_OBJECT: return jv->value.object_value.pair_count;
+        case JSON_INT_ARRAY:
+        case JSON_INT64_ARRAY:
+        case JSON_FLOAT_ARRAY:
+        case JSON_DOUBLE_ARRAY:
+            return jv->value.packed_value.count;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * 把连续的小元素 [begin, end) 按块大小切成若干段
+ */
+static void serial_plan_run(SerialPlan *p, const JsonValue *jv, SerialSegKind kind, size_t begin, size_t end) {
+    if (begin >= end) return;
+    size_t count = serial_child_count(jv);
+    size_t pieces = p->threads * SERIAL_CHUNKS_PER_THREAD;
+    size_t chunk = (count + pieces - 1) / pieces;
+    if (chunk == 0) chunk = 1;
+    for (size_t i = begin; i < end; i += chunk) {
+        if (i > 0) serial_glue(p, ",", 1);
+        serial_add_seg(p, kind, jv, i, i + chunk < end ? i + chunk : end);
+    }
+}
+
+static void serial_plan_value(SerialPlan *p, const JsonValue *jv, bool is_root);
+
+/**
+ * 拆分容器：子元素中的大容器递归拆分，其余元素按块划分
+ * 子元素较少但层层嵌套的深树不拆分，整体作为一段
+ */
+static void serial_plan_container(SerialPlan *p, const JsonValue *jv) {
+    size_t count = serial_child_count(jv);
+    if (jv->type != JSON_ARRAY && jv->type != JSON_OBJECT) {
+        serial_glue(p, "[", 1);
+        serial_plan_run(p, jv, SEG_PACKED, 0, count);
+        serial_glue(p, "]", 1);
+        return;
+    }
+
+    bool is_object = jv->type == JSON_OBJECT;
+    SerialSegKind kind = is_object ? SEG_OBJECT : SEG_ARRAY;
+    size_t run_start = 0;
+    serial_glue(p, is_object ? "{" : "[", 1);
+    for (size_t i = 0; i < count && !p->failed; i++) {
+        const JsonPair *pair = is_object ? &jv->value.object_value.pairs[i] : NULL;
+        const JsonValue *child = is_object ? &pair->value : &jv->value.array_value.elements[i];
+        if (serial_child_count(child) < p->min_split) continue;
+
+        serial_plan_run(p, jv, kind, run_start, i);
+        if (i > 0) serial_glue(p, ",", 1);
+        if (is_object) {
+            serial_glue(p, "\"", 1);
+            serial_glue(p, pair->key, strlen(pair->key));
+            serial_glue(p, "\":", 2);
+        }
+        serial_plan_value(p, child, false);
+        run_start = i + 1;
+    }
+    serial_plan_run(p, jv, kind, run_start, count);
+    serial_glue(p, is_object ? "}" : "]", 1);
+}
+
+static void serial_plan_value(SerialPlan *p, const JsonValue *jv, bool is_root) {
+    // 根容器总是展开，使 {"a": 大数组, "b": 大数组} 这类文档也能并行
+    size_t count = serial_child_count(jv);
+    if (count >= p->min_split || (is_root && count > 1)) {
+        serial_plan_container(p, jv);
+        return;
+    }
+    serial_add_seg(p, SEG_VALUE, jv, 0, 0);
+}
+
+/**
+ * 执行一个段：先计算长度，再写入独立缓冲
+ * @return 成功返回 1
+ */
+static int serial_run_seg(SerialPlan *p, SerialSeg *seg) {
+    const JsonValue *jv = seg->node;
+    size_t len = 0;
+    switch (seg->kind) {
+        case SEG_GLUE:
+            seg->buf = p->glue + seg->begin;
+            seg->len = seg->end - seg->begin;
+            return 1;
+        case SEG_VALUE: {
+            int n = json_value_length(jv);
+            if (n < 0) return 0;
+            len = (size_t)n;
+            break;
+        }
+        case SEG_ARRAY:
+        case SEG_OBJECT:
+            for (size_t i = seg->begin; i < seg->end; i++) {
+                int n;
+                if (seg->kind == SEG_ARRAY) {
+                    n = json_value_length(&jv->value.array_value.elements[i]);
+                } else {
+                    const JsonPair *pair = &jv->value.object_value.pairs[i];
+                    n = json_value_length(&pair->value);
+                    len += strlen(pair->key) + 3;
+                }
+                if (n < 0) return 0;
+                len += (size_t)n;
+            }
+            len += seg->end - seg->begin - 1;
+            break;
+        case SEG_PACKED:
+            for (size_t i = seg->begin; i < seg->end; i++) {
+                len += (size_t)format_packed_elem(NULL, jv, i);
+            }
+            len += seg->end - seg->begin - 1;
+            break;
+    }
+
+    // sprintf 写入结尾 NUL，多留一个字节
+    char *buf = json_malloc(len + 1);
+    if (!buf) return 0;
+    char *out = buf;
+    if (seg->kind == SEG_VALUE) {
+        out = json_value_serialize(out, jv);
+    } else {
+        for (size_t i = seg->begin; i < seg->end; i++) {
+            if (i > seg->begin) *out++ = ',';
+            if (seg->kind == SEG_ARRAY) {
+                out = json_value_serialize(out, &jv->value.array_value.elements[i]);
+            } else if (seg->kind == SEG_OBJECT) {
+                const JsonPair *pair = &jv->value.object_value.pairs[i];
+                size_t key_len = strlen(pair->key);
+                *out++ = '"';
+                memcpy(out, pair->key, key_len);
+                out += key_len;
+                *out++ = '"';
+                *out++ = ':';
+                out = json_value_serialize(out, &pair->value);
+            } else {
+                out += format_packed_elem(out, jv, i);
+            }
+        }
+    }
+    seg->buf = buf;
+    seg->len = (size_t)(out - buf);
+    return 1;
+}
+
+/**
+ * 工作线程：从共享计数器领取段直到取完
+ */
+static void *serial_worker(void *arg) {
+    SerialPlan *p = arg;
+    for (;;) {
+        size_t i = atomic_fetch_add_explicit(&p->next, 1, memory_order_relaxed);
+        if (i >= p->seg_count) break;
+        if (!serial_run_seg(p, &p->segs[i])) {
+            atomic_store_explicit(&p->task_failed, true, memory_order_relaxed);
+        }
+    }
+    return NULL;
+}
+
+static size_t serial_default_threads(void) {
+#if defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+#else
+    return 1;
+#endif
+}
+
+/**
+ * 用 threads 个线程（含当前线程）运行 worker，直到全部返回；
+ * 没有 pthread 的平台或线程创建失败时由已有线程完成剩余工作，worker 需自行从共享计数器领取任务
+ */
+static void parallel_run(size_t threads, void *(*worker)(void *), void *arg) {
+#if defined(MJSON_HAVE_PTHREAD)
+    pthread_t stack_tids[64];
+    pthread_t *tids = stack_tids;
+    size_t spawned = 0;
+    if (threads > 1 && threads - 1 > sizeof(stack_tids) / sizeof(stack_tids[0])) {
+        tids = json_malloc((threads - 1) * sizeof(pthread_t));
+        if (!tids) {
+            tids = stack_tids;
+            threads = sizeof(stack_tids) / sizeof(stack_tids[0]) + 1;
+        }
+    }
+    while (spawned + 1 < threads && pthread_create(&tids[spawned], NULL, worker, arg) == 0) {
+        spawned++;
+    }
+    worker(arg);
+    for (size_t i = 0; i < spawned; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    if (tids != stack_tids) json_mem_free(tids);
+#else
+    (void)threads;
+    worker(arg);
+#endif
+}
+
+/**
+ * 执行全部段
+ */
+static void serial_execute(SerialPlan *p) {
+    parallel_run(p->threads < p->seg_count ? p->threads : p->seg_count, serial_worker, p);
+}
+
+static void serial_plan_free(SerialPlan *p) {
+    for (size_t i = 0; i < p->seg_count; i++) {
+        if (p->segs[i].kind != SEG_GLUE) json_mem_free(p->segs[i].buf);
+    }
+    json_mem_free(p->segs);
+    json_mem_free(p->glue);
+}
+
+/**
+ * 规划并执行并行序列化，结果留在各段缓冲中
+ * @return JSON_SUCCESS 或 JSON_MEM_ERROR
+ */
+static int serial_build(SerialPlan *p, const JsonValue *jv, const JsonSerializeOptions *options) {
+    memset(p, 0, sizeof(*p));
+    atomic_init(&p->next, 0);
+    atomic_init(&p->task_failed, false);
+    p->threads = options && options->threads ? options->threads : serial_default_threads();
+    p->min_split = options && options->min_split ? options->min_split : SERIAL_MIN_SPLIT;
+    if (p->threads > 1) {
+        serial_plan_value(p, jv, true);
+    } else {
+        serial_add_seg(p, SEG_VALUE, jv, 0, 0);
+    }
+    if (!p->failed) serial_execute(p);
+    if (p->failed || atomic_load(&p->task_failed)) {
+        serial_plan_free(p);
+        return JSON_MEM_ERROR;
+    }
+    return JSON_SUCCESS;
+}
+
+/**
+ * 并行序列化：大数组/对象切块后由多个线程分别写入独立缓冲再拼接，输出与 json_to_string 逐字节相同
+ * 全局分配器会被多个线程同时调用，必须是线程安全的
+ * @param jv
+ * @param options NULL 表示使用默认值
+ * @return 以 NUL 结尾的字符串，释放方式同 json_to_string；失败返回 NULL
+ */
+char* json_to_string_parallel(const JsonValue* jv, const JsonSerializeOptions* options) {
+    if (!jv) return NULL;
+    SerialPlan p;
+    if (serial_build(&p, jv, options) != JSON_SUCCESS) return NULL;
+
+    size_t total = 0;
+    for (size_t i = 0; i < p.seg_count; i++) total += p.segs[i].len;
+    char *result = json_malloc(total + 1);
+    if (result) {
+        char *out = result;
+        for (size_t i = 0; i < p.seg_count; i++) {
+            memcpy(out, p.segs[i].buf, p.segs[i].len);
+            out += p.segs[i].len;
+        }
+        *out = '\0';
+    }
+    serial_plan_free(&p);
+    return result;
+}
+
+/**
+ * 并行序列化后用 writev 把各段缓冲直接写入文件描述符，不做拼接
+ * @param fd
+ * @param jv
+ * @param options NULL 表示使用默认值
+ * @return JSON_SUCCESS；内存不足返回 JSON_MEM_ERROR，写入失败或平台不支持返回 JSON_INVALID
+ */
+int json_write_fd(int fd, const JsonValue* jv, const JsonSerializeOptions* options) {
+    if (!jv || fd < 0) return JSON_INVALID;
+#if defined(__unix__) || defined(__APPLE__)
+    SerialPlan p;
+    int error = serial_build(&p, jv, options);
+    if (error) return error;
+
+    struct iovec iov[SERIAL_IOV_MAX];
+    size_t seg = 0;
+    size_t seg_offset = 0; // 当前段已写出的字节数
+    while (seg < p.seg_count && !error) {
+        int n = 0;
+        for (size_t i = seg; i < p.seg_count && n < SERIAL_IOV_MAX; i++) {
+            size_t skip = i == seg ? seg_offset : 0;
+            if (p.segs[i].len == skip) continue;
+            iov[n].iov_base = p.segs[i].buf + skip;
+            iov[n].iov_len = p.segs[i].len - skip;
+            n++;
+        }
+        if (n == 0) break;
+        ssize_t written = writev(fd, iov, n);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            error = JSON_INVALID;
+            break;
+        }
+        // 部分写入：前移到下一个未写完的段
+        size_t left = (size_t)written;
+        while (seg < p.seg_count && left >= p.segs[seg].len - seg_offset) {
+            left -= p.segs[seg].len - seg_offset;
+            seg++;
+            seg_offset = 0;
+        }
+        seg_offset += left;
+    }
+    serial_plan_free(&p);
+    return error;
+#else
+    (void)options;
+    return JSON_INVALID;
+#endif
+}
+
+// ============================= 并行序列化 end ================================
+
+// ============================= 序列化缓存 start ================================
+
+#define TEXT_CACHE_MIN_BYTES 64  // 输出不足该长度的容器不缓存，重新生成更便宜
+
+/**
+ * 可缓存的容器存储块；单次分配的只读文档（BLOCK_PINNED）不单独释放，不缓存
+ */
+static JsonBlock *cache_block(const JsonValue *jv) {
+    void *data = value_block(jv);
+    if (!data || (block_flags(data) & BLOCK_PINNED)) return NULL;
+    return BLOCK_OF(data);
+}
+
+/**
+ * 计算长度，未修改的容器直接取缓存长度
+ * @return 失败返回 SIZE_MAX
+ */
+static size_t cached_length(const JsonValue* jv) {
+    JsonBlock *block = cache_block(jv);
+    JsonTextCache *cache = block ? atomic_load_explicit(&block->cache, memory_order_acquire) : NULL;
+    if (cache) return cache->len;
+
+    size_t length;
+    if (jv->type == JSON_ARRAY) {
+        length = 2;
+        for (size_t i = 0; i < jv->value.array_value.ele_count; ++i) {
+            size_t elem_len = cached_length(&jv->value.array_value.elements[i]);
+            if (elem_len == SIZE_MAX) return SIZE_MAX;
+            length += elem_len + 1;
+        }
+        if (jv->value.array_value.ele_count > 0) length--;
+        return length;
+    }
+    if (jv->type == JSON_OBJECT) {
+        length = 2;
+        for (size_t i = 0; i < jv->value.object_value.pair_count; ++i) {
+            const JsonPair* pair = &jv->value.object_value.pairs[i];
+            size_t val_len = cached_length(&pair->value);
+            if (val_len == SIZE_MAX) return SIZE_MAX;
+            length += strlen(pair->key) + 3 + val_len + 1;
+        }
+        if (jv->value.object_value.pair_count > 0) length--;
+        return length;
+    }
+    int n = json_value_length(jv);
+    return n < 0 ? SIZE_MAX : (size_t)n;
+}
+
+/**
+ * 序列化并在容器上留下缓存；缓存分配失败只影响下次的速度
+ * @return 写入结束位置
+ */
+static char* cached_serialize(char* buf, const JsonValue* jv) {
+    JsonBlock *block = cache_block(jv);
+    JsonTextCache *cache = block ? atomic_load_explicit(&block->cache, memory_order_acquire) : NULL;
+    if (cache) {
+        memcpy(buf, cache->data, cache->len);
+        return buf + cache->len;
+    }
+
+    char *start = buf;
+    if (jv->type == JSON_ARRAY) {
+        *buf++ = '[';
+        for (size_t i = 0; i < jv->value.array_value.ele_count; ++i) {
+            if (i > 0) *buf++ = ',';
+            buf = cached_serialize(buf, &jv->value.array_value.elements[i]);
+        }
+        *buf++ = ']';
+    } else if (jv->type == JSON_OBJECT) {
+        *buf++ = '{';
+        for (size_t i = 0; i < jv->value.object_value.pair_count; ++i) {
+            const JsonPair* pair = &jv->value.object_value.pairs[i];
+            size_t key_len = strlen(pair->key);
+            if (i > 0) *buf++ = ',';
+            *buf++ = '"';
+            memcpy(buf, pair->key, key_len);
+            buf += key_len;
+            *buf++ = '"';
+            *buf++ = ':';
+            buf = cached_serialize(buf, &pair->value);
+        }
+        *buf++ = '}';
+    } else {
+        buf = json_value_serialize(buf, jv);
+    }
+
+    size_t len = (size_t)(buf - start);
+    if (block && len >= TEXT_CACHE_MIN_BYTES) {
+        // 缓存留在文档上，与存储块使用同一个分配器
+        cache = mem_malloc(block->allocator, NULL, sizeof(JsonTextCache) + len);
+        if (cache) {
+            cache->len = len;
+            memcpy(cache->data, start, len);
+            // 共享的存储块可能被多个克隆同时序列化，只发布先到的一份
+            JsonTextCache *expected = NULL;
+            if (!atomic_compare_exchange_strong_explicit(&block->cache, &expected, cache,
+                                                         memory_order_acq_rel, memory_order_acquire)) {
+                block_free_cache(block, cache);
+            }
+        }
+    }
+    return buf;
+}
+
+/**
+ * 带缓存的序列化：每个容器保存上次输出的文本。修改接口与 json_set_* 写入前丢弃被写节点的缓存，
+ * 并沿所在存储块的父链丢弃全部祖先的缓存（见 value_chain_writable），与节点如何取得无关；
+ * 再次序列化时只重新生成变化的子树。缓存按嵌套层数重复保存文本，不再需要时用 json_cache_clear 释放
+ * @param jv
+ * @return 以 NUL 结尾的字符串，与 json_to_string 输出相同；失败返回 NULL
+ */
+char* json_to_string_cached(const JsonValue* jv) {
+    if (!jv) return NULL;
+    size_t length = cached_length(jv);
+    if (length == SIZE_MAX) return NULL;
+
+    // sprintf 写入结尾 NUL，多留一个字节
+    char* result = json_malloc(length + 1);
+    if (!result) return NULL;
+    char* end = cached_serialize(result, jv);
+    *end = '\0';
+    return result;
+}
+
+/**
+ * 释放文档中的全部序列化缓存；与克隆共享的存储块和冻结的存储块保留缓存，随最后一个持有者释放
+ * @param jv
+ */
+void json_cache_clear(JsonValue* jv) {
+    if (!jv) return;
+    JsonBlock *block = cache_block(jv);
+    // 冻结文档可能正被其他线程读取缓存，保留到 json_free
+    if (!block || block_is_shared(block + 1) || (block->flags & BLOCK_FROZEN)) return;
+    block_drop_cache(block + 1);
+    if (jv->type == JSON_ARRAY) {
+        for (size_t i = 0; i < jv->value.array_value.ele_count; ++i) {
+            json_cache_clear(&jv->value.array_value.elements[i]);
+        }
+    } else if (jv->type == JSON_OBJECT) {
+        for (size_t i = 0; i < jv->value.object_value.pair_count; ++i) {
+            json_cache_clear(&jv->value.object_value.pairs[i].value);
+        }
+    }
+}
+
+// ============================= 序列化缓存 end ================================
+
+// ============================= JSONPath 查询 start ================================
+
+#define QUERY_MAX_DEPTH 64       // 过滤表达式的最大嵌套层数
+#define QUERY_MIN_SPLIT 4096     // 并行查询时，元素数达到该值的数组才切块
+#define QUERY_NONE SIZE_MAX
+
+typedef enum {
+    QSEL_NAME,      // .name / ['name']
+    QSEL_WILDCARD,  // .* / [*]
+    QSEL_INDEX,     // [n]，负数从末尾计
+    QSEL_SLICE,     // [start:end:step]
+    QSEL_FILTER     // [?(expr)]
+} QuerySelectorKind;
+
+typedef struct {
+    QuerySelectorKind kind;
+    char *name;
+    size_t name_len;
+    int64_t index;             // INDEX；SLICE 的 start
+    int64_t end, step;         // SLICE
+    bool has_start, has_end;   // SLICE 省略的边界
+    size_t expr;               // FILTER 的根表达式
+} QuerySelector;
+
+typedef struct {
+    bool descendant;           // ..：作用于节点自身及全部后代
+    size_t first, count;       // 选择器区间
+} QuerySegment;
+
+// 过滤表达式中的单值路径（只含键和下标）
+typedef struct {
+    char *name;                // NULL 表示下标
+    size_t name_len;
+    int64_t index;
+} QueryStep;
+
+enum { QOPERAND_LITERAL, QOPERAND_CURRENT, QOPERAND_ROOT };
+enum { QCMP_EQ, QCMP_NE, QCMP_LT, QCMP_LE, QCMP_GT, QCMP_GE };
+
+typedef struct {
+    int kind;
+    size_t first, count;       // 路径步骤区间
+    JsonValue literal;
+} QueryOperand;
+
+typedef enum {
+    QEXPR_OR,
+    QEXPR_AND,
+    QEXPR_NOT,
+    QEXPR_EXISTS,              // 路径存在
+    QEXPR_CMP
+} QueryExprKind;
+
+typedef struct {
+    QueryExprKind kind;
+    int op;
+    size_t left, right;        // OR/AND/NOT 的子表达式
+    QueryOperand a, b;
+} QueryExpr;
+
+// 编译后的查询：各部分存放在数组中按下标引用，编译期间扩容不会使引用失效
+struct JsonQuery {
+    QuerySegment *segments;
+    size_t segment_count, segment_cap;
+    QuerySelector *selectors;
+    size_t selector_count, selector_cap;
+    QueryStep *steps;
+    size_t step_count, step_cap;
+    QueryExpr *exprs;
+    size_t expr_count, expr_cap;
+};
+
+typedef struct {
+    const char *pos;
+    JsonQuery *query;
+    int error;
+    size_t depth;
+} QueryParser;
+
+/**
+ * 数组追加一个清零的元素
+ * @return 新元素下标，失败返回 QUERY_NONE
+ */
+static size_t query_push(QueryParser *p, void **data, size_t *count, size_t *cap, size_t elem_size) {
+    if (p->error) return QUERY_NONE;
+    if (*count == *cap) {
+        size_t new_cap = *cap ? *cap * 2 : 8;
+        void *grown = json_realloc(*data, new_cap * elem_size);
+        if (!grown) {
+            p->error = JSON_MEM_ERROR;
+            return QUERY_NONE;
+        }
+        *data = grown;
+        *cap = new_cap;
+    }
+    memset((char *)*data + *count * elem_size, 0, elem_size);
+    return (*count)++;
+}
+
+#define QUERY_PUSH(p, field) \
+    query_push(p, (void **)&(p)->query->field##s, &(p)->query->field##_count, &(p)->query->field##_cap, \
+               sizeof(*(p)->query->field##s))
+
+static void query_skip_space(QueryParser *p) {
+    while (*p->pos == ' ' || *p->pos == '\t' || *p->pos == '\n' || *p->pos == '\r') p->pos++;
+}
+
+static bool query_fail(QueryParser *p) {
+    if (!p->error) p->error = JSON_INVALID;
+    return false;
+}
+
+/**
+ * 点号后的成员名：字母、数字、_、$、- 与非 ASCII 字节
+ */
+static bool query_name_char(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '$' || c == '-' || (unsigned char)c >= 0x80;
+}
+
+static bool query_parse_int(QueryParser *p, int64_t *out) {
+    const char *start = p->pos;
+    bool negative = *p->pos == '-';
+    if (negative) p->pos++;
+    if (!isdigit((unsigned char)*p->pos)) {
+        p->pos = start;
+        return false;
+    }
+    uint64_t value = 0;
+    while (isdigit((unsigned char)*p->pos)) {
+        if (value > (uint64_t)INT64_MAX / 10) return query_fail(p);
+        value = value * 10 + (uint64_t)(*p->pos++ - '0');
+    }
+    if (value > (uint64_t)INT64_MAX) return query_fail(p);
+    *out = negative ? -(int64_t)value : (int64_t)value;
+    return true;
+}
+
+/**
+ * 单引号或双引号字符串，支持常见转义；结果以 NUL 结尾，长度不含 NUL
+ */
+static char *query_parse_string(QueryParser *p, size_t *len) {
+    char quote = *p->pos++;
+    const char *start = p->pos;
+    size_t capacity = 0;
+    while (p->pos[capacity] && p->pos[capacity] != quote) {
+        if (p->pos[capacity] == '\\' && p->pos[capacity + 1]) capacity++;
+        capacity++;
+    }
+    if (p->pos[capacity] != quote) {
+        query_fail(p);
+        return NULL;
+    }
+    char *out = json_malloc(capacity + 1);
+    if (!out) {
+        p->error = JSON_MEM_ERROR;
+        return NULL;
+    }
+    size_t n = 0;
+    const char *end = start + capacity;
+    while (p->pos < end) {
+        char c = *p->pos++;
+        if (c != '\\') {
+            out[n++] = c;
+            continue;
+        }
+        c = *p->pos++;
+        switch (c) {
+            case 'b': out[n++] = '\b'; break;
+            case 'f': out[n++] = '\f'; break;
+            case 'n': out[n++] = '\n'; break;
+            case 'r': out[n++] = '\r'; break;
+            case 't': out[n++] = '\t'; break;
+            case 'u': {
+                unsigned int code = 0;
+                for (int k = 0; k < 4; k++) {
+                    char h = p->pos < end ? *p->pos++ : '\0';
+                    if (!isxdigit((unsigned char)h)) {
+                        json_mem_free(out);
+                        query_fail(p);
+                        return NULL;
+                    }
+                    code = code * 16 + (unsigned int)(isdigit((unsigned char)h) ? h - '0' : (tolower(h) - 'a' + 10));
+                }
+                // \uXXXX 占 6 字节，UTF-8 编码最多 3 字节，不会超出缓冲
+                if (code < 0x80) {
+                    out[n++] = (char)code;
+                } else if (code < 0x800) {
+                    out[n++] = (char)(0xC0 | (code >> 6));
+                    out[n++] = (char)(0x80 | (code & 0x3F));
+                } else {
+                    out[n++] = (char)(0xE0 | (code >> 12));
+                    out[n++] = (char)(0x80 | ((code >> 6) & 0x3F));
+                    out[n++] = (char)(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default: out[n++] = c; break;  // \' \" \\ \/
+        }
+    }
+    p->pos++;
+    out[n] = '\0';
+    *len = n;
+    return out;
+}
+
+/**
+ * 过滤表达式中 @ 或 $ 之后的单值路径
+ */
+static bool query_parse_singular(QueryParser *p, QueryOperand *operand) {
+    operand->first = p->query->step_count;
+    for (;;) {
+        size_t step;
+        if (p->pos[0] == '.' && query_name_char(p->pos[1])) {
+            const char *start = ++p->pos;
+            while (query_name_char(*p->pos)) p->pos++;
+            if ((step = QUERY_PUSH(p, step)) == QUERY_NONE) return false;
+            QueryStep *s = &p->query->steps[step];
+            s->name_len = (size_t)(p->pos - start);
+            s->name = json_malloc(s->name_len + 1);
+            if (!s->name) {
+                p->error = JSON_MEM_ERROR;
+                return false;
+            }
+            memcpy(s->name, start, s->name_len);
+            s->name[s->name_len] = '\0';
+        } else if (p->pos[0] == '[') {
+            p->pos++;
+            query_skip_space(p);
+            if ((step = QUERY_PUSH(p, step)) == QUERY_NONE) return false;
+            QueryStep *s = &p->query->steps[step];
+            if (*p->pos == '\'' || *p->pos == '"') {
+                s->name = query_parse_string(p, &s->name_len);
+                if (!s->name) return false;
+            } else if (!query_parse_int(p, &s->index)) {
+                return query_fail(p);
+            }
+            query_skip_space(p);
+            if (*p->pos++ != ']') return query_fail(p);
+        } else {
+            break;
+        }
+    }
+    operand->count = p->query->step_count - operand->first;
+    return true;
+}
+
+static bool query_parse_operand(QueryParser *p, QueryOperand *operand) {
+    query_skip_space(p);
+    char c = *p->pos;
+    if (c == '@' || c == '$') {
+        p->pos++;
+        operand->kind = c == '@' ? QOPERAND_CURRENT : QOPERAND_ROOT;
+        return query_parse_singular(p, operand);
+    }
+    operand->kind = QOPERAND_LITERAL;
+    if (c == '\'' || c == '"') {
+        size_t len;
+        char *str = query_parse_string(p, &len);
+        if (!str) return false;
+        operand->literal = (JsonValue){.type = JSON_STRING, .value.string_value = str};
+        return true;
+    }
+    static const struct { const char *word; size_t len; JsonValue value; } words[] = {
+        {"true", 4, {.type = JSON_BOOL, .value.bool_value = true}},
+        {"false", 5, {.type = JSON_BOOL, .value.bool_value = false}},
+        {"null", 4, {.type = JSON_NULL}},
+    };
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+        if (strncmp(p->pos, words[i].word, words[i].len) == 0 && !query_name_char(p->pos[words[i].len])) {
+            p->pos += words[i].len;
+            operand->literal = words[i].value;
+            return true;
+        }
+    }
+    if (c == '-' || isdigit((unsigned char)c)) {
+        // 与文档中的数字按同样规则取 int/float/double，比较时精度一致
+        double number;
+        const char *end;
+        JsonType type = scan_number(p->pos, &end, &number);
+        if (end == p->pos) return query_fail(p);
+        p->pos = end;
+        switch (type) {
+            case JSON_INT:   operand->literal = (JsonValue){.type = JSON_INT, .value.int_value = (int)number}; break;
+            case JSON_FLOAT: operand->literal = (JsonValue){.type = JSON_FLOAT, .value.float_value = (float)number}; break;
+            default:         operand->literal = (JsonValue){.type = JSON_DOUBLE, .value.double_value = number}; break;
+        }
+        return true;
+    }
+    return query_fail(p);
+}
+
+static size_t query_parse_or(QueryParser *p);
+
+static size_t query_parse_primary(QueryParser *p) {
+    query_skip_space(p);
+    if (*p->pos == '!') {
+        // 连续的 ! 同样递归，与括号共用深度上限
+        if (++p->depth > QUERY_MAX_DEPTH) {
+            p->error = JSON_TOO_DEEP;
+            return QUERY_NONE;
+        }
+        p->pos++;
+        size_t child = query_parse_primary(p);
+        p->depth--;
+        size_t expr = QUERY_PUSH(p, expr);
+        if (child == QUERY_NONE || expr == QUERY_NONE) return QUERY_NONE;
+        p->query->exprs[expr].kind = QEXPR_NOT;
+        p->query->exprs[expr].left = child;
+        return expr;
+    }
+    if (*p->pos == '(') {
+        if (++p->depth > QUERY_MAX_DEPTH) {
+            p->error = JSON_TOO_DEEP;
+            return QUERY_NONE;
+        }
+        p->pos++;
+        size_t expr = query_parse_or(p);
+        query_skip_space(p);
+        if (expr == QUERY_NONE || *p->pos++ != ')') {
+            query_fail(p);
+            return QUERY_NONE;
+        }
+        p->depth--;
+        return expr;
+    }
+
+    QueryOperand a = {0}, b = {0};
+    if (!query_parse_operand(p, &a)) return QUERY_NONE;
+    size_t expr = QUERY_PUSH(p, expr);
+    if (expr == QUERY_NONE) {
+        json_free(&a.literal);
+        return QUERY_NONE;
+    }
+    p->query->exprs[expr].a = a;
+
+    query_skip_space(p);
+    static const struct { const char *text; int op; } ops[] = {
+        {"==", QCMP_EQ}, {"!=", QCMP_NE}, {"<=", QCMP_LE}, {">=", QCMP_GE}, {"<", QCMP_LT}, {">", QCMP_GT},
+    };
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+        size_t len = strlen(ops[i].text);
+        if (strncmp(p->pos, ops[i].text, len) != 0) continue;
+        p->pos += len;
+        if (!query_parse_operand(p, &b)) return QUERY_NONE;
+        QueryExpr *e = &p->query->exprs[expr];
+        e->kind = QEXPR_CMP;
+        e->op = ops[i].op;
+        e->b = b;
+        return expr;
+    }
+    // 没有比较运算符时是存在性测试，字面量不能单独出现
+    if (a.kind == QOPERAND_LITERAL) {
+        query_fail(p);
+        return QUERY_NONE;
+    }
+    p->query->exprs[expr].kind = QEXPR_EXISTS;
+    return expr;
+}
+
+static size_t query_parse_binary(QueryParser *p, QueryExprKind kind) {
+    const char *token = kind == QEXPR_OR ? "||" : "&&";
+    size_t left = kind == QEXPR_OR ? query_parse_binary(p, QEXPR_AND) : query_parse_primary(p);
+    for (;;) {
+        query_skip_space(p);
+        if (left == QUERY_NONE || strncmp(p->pos, token, 2) != 0) return left;
+        p->pos += 2;
+        size_t right = kind == QEXPR_OR ? query_parse_binary(p, QEXPR_AND) : query_parse_primary(p);
+        size_t expr = QUERY_PUSH(p, expr);
+        if (right == QUERY_NONE || expr == QUERY_NONE) return QUERY_NONE;
+        p->query->exprs[expr].kind = kind;
+        p->query->exprs[expr].left = left;
+        p->query->exprs[expr].right = right;
+        left = expr;
+    }
+}
+
+static size_t query_parse_or(QueryParser *p) {
+    return query_parse_binary(p, QEXPR_OR);
+}
+
+/**
+ * 方括号内的一个选择器
+ */
+static bool query_parse_selector(QueryParser *p) {
+    query_skip_space(p);
+    size_t index = QUERY_PUSH(p, selector);
+    if (index == QUERY_NONE) return false;
+    QuerySelector *sel = &p->query->selectors[index];
+    char c = *p->pos;
+
+    if (c == '\'' || c == '"') {
+        sel->kind = QSEL_NAME;
+        sel->name = query_parse_string(p, &sel->name_len);
+        return sel->name != NULL;
+    }
+    if (c == '*') {
+        p->pos++;
+        sel->kind = QSEL_WILDCARD;
+        return true;
+    }
+    if (c == '?') {
+        p->pos++;
+        size_t expr = query_parse_or(p);
+        if (expr == QUERY_NONE) return query_fail(p);
+        // 解析表达式时 selectors 不会扩容，sel 仍然有效
+        p->query->selectors[index].kind = QSEL_FILTER;
+        p->query->selectors[index].expr = expr;
+        return true;
+    }
+
+    int64_t start = 0, end = 0, step = 1;
+    bool has_start = query_parse_int(p, &start);
+    if (p->error) return false;
+    query_skip_space(p);
+    if (*p->pos != ':') {
+        if (!has_start) return query_fail(p);
+        sel->kind = QSEL_INDEX;
+        sel->index = start;
+        return true;
+    }
+    p->pos++;
+    query_skip_space(p);
+    bool has_end = query_parse_int(p, &end);
+    query_skip_space(p);
+    if (*p->pos == ':') {
+        p->pos++;
+        query_skip_space(p);
+        if (!query_parse_int(p, &step)) step = 1;
+    }
+    if (p->error) return false;
+    sel->kind = QSEL_SLICE;
+    sel->index = start;
+    sel->end = end;
+    sel->step = step;
+    sel->has_start = has_start;
+    sel->has_end = has_end;
+    return true;
+}
+
+static bool query_parse_segments(QueryParser *p) {
+    for (;;) {
+        query_skip_space(p);
+        if (*p->pos == '\0') return true;
+        bool descendant = false;
+        if (p->pos[0] == '.' && p->pos[1] == '.') {
+            descendant = true;
+            p->pos += 2;
+        } else if (p->pos[0] == '.') {
+            p->pos++;
+        } else if (p->pos[0] != '[') {
+            return query_fail(p);
+        }
+
+        size_t seg = QUERY_PUSH(p, segment);
+        if (seg == QUERY_NONE) return false;
+        p->query->segments[seg].descendant = descendant;
+        p->query->segments[seg].first = p->query->selector_count;
+
+        if (*p->pos == '[') {
+            p->pos++;
+            do {
+                if (!query_parse_selector(p)) return query_fail(p);
+                query_skip_space(p);
+            } while (*p->pos == ',' && p->pos++);
+            if (*p->pos++ != ']') return query_fail(p);
+        } else if (*p->pos == '*') {
+            p->pos++;
+            size_t sel = QUERY_PUSH(p, selector);
+            if (sel == QUERY_NONE) return false;
+            p->query->selectors[sel].kind = QSEL_WILDCARD;
+        } else if (query_name_char(*p->pos)) {
+            const char *start = p->pos;
+            while (query_name_char(*p->pos)) p->pos++;
+            size_t sel = QUERY_PUSH(p, selector);
+            if (sel == QUERY_NONE) return false;
+            QuerySelector *s = &p->query->selectors[sel];
+            s->kind = QSEL_NAME;
+            s->name_len = (size_t)(p->pos - start);
+            s->name = json_malloc(s->name_len + 1);
+            if (!s->name) {
+                p->error = JSON_MEM_ERROR;
+                return false;
+            }
+            memcpy(s->name, start, s->name_len);
+            s->name[s->name_len] = '\0';
+        } else {
+            return query_fail(p);
+        }
+        p->query->segments[seg].count = p->query->selector_count - p->query->segments[seg].first;
+    }
+}
+
+void json_query_free(JsonQuery* query) {
+    if (!query) return;
+    for (size_t i = 0; i < query->selector_count; i++) json_mem_free(query->selectors[i].name);
+    for (size_t i = 0; i < query->step_count; i++) json_mem_free(query->steps[i].name);
+    for (size_t i = 0; i < query->expr_count; i++) {
+        json_free(&query->exprs[i].a.literal);
+        json_free(&query->exprs[i].b.literal);
+    }
+    json_mem_free(query->segments);
+    json_mem_free(query->selectors);
+    json_mem_free(query->steps);
+    json_mem_free(query->exprs);
+    json_mem_free(query);
+}
+
+/**
+ * 编译 JSONPath 表达式，支持 .name、['name']、*、..（递归下降）、[n]、[start:end:step]、
+ * 并集 [a,b] 与过滤 [?(@.price > 100 && @.tag == 'x')]；过滤表达式中的路径只能是单值路径（键与下标）
+ * @param expr 以 $ 开头的表达式
+ * @param error
+ * @return 编译结果，json_query_free 释放；失败返回 NULL
+ */
+JsonQuery* json_query_compile(const char* expr, int* error) {
+    *error = JSON_SUCCESS;
+    if (!expr) {
+        *error = JSON_INVALID;
+        return NULL;
+    }
+    JsonQuery *query = json_malloc(sizeof(JsonQuery));
+    if (!query) {
+        *error = JSON_MEM_ERROR;
+        return NULL;
+    }
+    memset(query, 0, sizeof(*query));
+    QueryParser p = {expr, query, JSON_SUCCESS, 0};
+    query_skip_space(&p);
+    if (*p.pos++ != '$') query_fail(&p);
+    else query_parse_segments(&p);
+    if (p.error) {
+        *error = p.error;
+        json_query_free(query);
+        return NULL;
+    }
+    return query;
+}
+
+// ---------------------------- 求值 ----------------------------
+
+typedef bool (*QueryEmit)(void *ctx, const JsonValue *node);
+
+typedef struct {
+    const JsonQuery *query;
+    const JsonValue *root;          // 过滤表达式中的 $
+    JsonQueryCallback callback;     // 回调模式
+    void *user;
+    const JsonValue **results;      // 结果数组模式
+    size_t capacity;
+    size_t count;                   // 命中总数（可能超过 capacity）
+    bool growable;                  // 并行分块：results 按需扩容
+    bool stopped;                   // 回调要求停止或内存不足
+    size_t threads, min_split;      // threads > 1 时并行
+} QueryRun;
+
+static bool query_emit(QueryRun *run, const JsonValue *node) {
+    if (run->callback) {
+        run->count++;
+        if (!run->callback(node, run->user)) run->stopped = true;
+        return !run->stopped;
+    }
+    if (run->growable && run->count == run->capacity) {
+        size_t capacity = run->capacity ? run->capacity * 2 : 64;
+        const JsonValue **results = json_realloc((void *)run->results, capacity * sizeof(*results));
+        if (!results) {
+            run->stopped = true;
+            return false;
+        }
+        run->results = results;
+        run->capacity = capacity;
+    }
+    if (run->count < run->capacity) run->results[run->count] = node;
+    run->count++;
+    return true;
+}
+
+/**
+ * 紧凑数组第 i 个元素转为临时数值节点
+ */
+static const JsonValue *query_packed_elem(const JsonValue *jv, size_t i, JsonValue *tmp) {
+    *tmp = packed_element(jv, i);
+    return tmp;
+}
+
+/**
+ * 按单值路径取值，不存在返回 NULL；紧凑数组元素写入 tmp
+ */
+static const JsonValue *query_operand(const QueryRun *run, const QueryOperand *operand,
+                                      const JsonValue *current, JsonValue *tmp) {
+    if (operand->kind == QOPERAND_LITERAL) return &operand->literal;
+    const JsonValue *node = operand->kind == QOPERAND_CURRENT ? current : run->root;
+    const QueryStep *steps = run->query->steps + operand->first;
+    for (size_t i = 0; i < operand->count && node; i++) {
+        if (steps[i].name) {
+            int index = find_key_index_n(node, steps[i].name, steps[i].name_len);
+            node = index < 0 ? NULL : &node->value.object_value.pairs[index].value;
+            continue;
+        }
+        size_t count = json_array_size(node);
+        int64_t index = steps[i].index < 0 ? (int64_t)count + steps[i].index : steps[i].index;
+        if ((node->type != JSON_ARRAY && !json_is_packed_array(node)) || index < 0 || (uint64_t)index >= count) {
+            return NULL;
+        }
+        if (node->type != JSON_ARRAY) return i + 1 == operand->count ? query_packed_elem(node, (size_t)index, tmp) : NULL;
+        node = &node->value.array_value.elements[index];
+    }
+    return node;
+}
+
+/**
+ * 比较：数值与字符串可比较大小，其余类型只有相等；不存在的路径只与不存在相等
+ */
+static bool query_compare(const JsonValue *a, const JsonValue *b, int op) {
+    bool equal = (!a || !b) ? a == b : value_equal(a, b);
+    if (op == QCMP_EQ) return equal;
+    if (op == QCMP_NE) return !equal;
+
+    bool less = false;
+    long double x, y;
+    if (a && b && value_number(a, &x) && value_number(b, &y)) {
+        less = op == QCMP_LT || op == QCMP_LE ? x < y : y < x;
+    } else if (a && b && a->type == JSON_STRING && b->type == JSON_STRING) {
+        int cmp = strcmp(a->value.string_value, b->value.string_value);
+        less = op == QCMP_LT || op == QCMP_LE ? cmp < 0 : cmp > 0;
+    }
+    return (op == QCMP_LE || op == QCMP_GE) ? less || equal : less;
+}
+
+static bool query_match(const QueryRun *run, size_t expr_index, const JsonValue *current) {
+    const QueryExpr *e = &run->query->exprs[expr_index];
+    switch (e->kind) {
+        case QEXPR_OR:  return query_match(run, e->left, current) || query_match(run, e->right, current);
+        case QEXPR_AND: return query_match(run, e->left, current) && query_match(run, e->right, current);
+        case QEXPR_NOT: return !query_match(run, e->left, current);
+        case QEXPR_EXISTS: {
+            JsonValue tmp;
+            return query_operand(run, &e->a, current, &tmp) != NULL;
+        }
+        case QEXPR_CMP: {
+            JsonValue tmp_a, tmp_b;
+            return query_compare(query_operand(run, &e->a, current, &tmp_a),
+                                 query_operand(run, &e->b, current, &tmp_b), e->op);
+        }
+    }
+    return false;
+}
+
+static void query_next(QueryRun *run, size_t seg, const JsonValue *node);
+
+/**
+ * 数组下标序列 first + k * step（begin <= k < end）中的元素逐个交给下一段，FILTER 先过滤
+ */
+static void query_range(QueryRun *run, size_t seg, const JsonValue *arr, const QuerySelector *sel,
+                        size_t first, int64_t step, size_t begin, size_t end) {
+    const JsonValue *elements = arr->value.array_value.elements;
+    for (size_t k = begin; k < end && !run->stopped; k++) {
+        const JsonValue *child = &elements[(int64_t)first + (int64_t)k * step];
+        if (sel->kind == QSEL_FILTER && !query_match(run, sel->expr, child)) continue;
+        query_next(run, seg + 1, child);
+    }
+}
+
+typedef struct {
+    const QueryRun *parent;
+    size_t seg;
+    const JsonValue *arr;
+    const QuerySelector *sel;
+    size_t first;
+    int64_t step;
+    size_t total, chunk, chunk_count;
+    QueryRun *chunks;               // 每块独立收集结果，最后按顺序合并
+    atomic_size_t next;
+} QueryParallel;
+
+static void *query_worker(void *arg) {
+    QueryParallel *par = arg;
+    for (;;) {
+        size_t c = atomic_fetch_add_explicit(&par->next, 1, memory_order_relaxed);
+        if (c >= par->chunk_count) break;
+        size_t begin = c * par->chunk;
+        size_t end = begin + par->chunk < par->total ? begin + par->chunk : par->total;
+        query_range(&par->chunks[c], par->seg, par->arr, par->sel, par->first, par->step, begin, end);
+    }
+    return NULL;
+}
+
+/**
+ * 大数组切块后由多个线程分别求值，结果按块顺序合并，与顺序求值的结果相同；
+ * 块内遇到的嵌套大数组顺序求值。内存不足时退回顺序求值
+ * @return 已处理返回 true
+ */
+static bool query_range_parallel(QueryRun *run, size_t seg, const JsonValue *arr, const QuerySelector *sel,
+                                 size_t first, int64_t step, size_t n) {
+    size_t pieces = run->threads * 4;
+    QueryParallel par = {run, seg, arr, sel, first, step, n, (n + pieces - 1) / pieces, 0, NULL, 0};
+    par.chunk_count = (n + par.chunk - 1) / par.chunk;
+    par.chunks = json_malloc(par.chunk_count * sizeof(QueryRun));
+    if (!par.chunks) return false;
+    for (size_t c = 0; c < par.chunk_count; c++) {
+        par.chunks[c] = (QueryRun){run->query, run->root, NULL, NULL, NULL, 0, 0, true, false, 1, 0};
+    }
+    atomic_init(&par.next, 0);
+    parallel_run(run->threads < par.chunk_count ? run->threads : par.chunk_count, query_worker, &par);
+
+    bool ok = true;
+    for (size_t c = 0; c < par.chunk_count; c++) {
+        if (par.chunks[c].stopped) ok = false;
+    }
+    for (size_t c = 0; c < par.chunk_count; c++) {
+        for (size_t i = 0; ok && i < par.chunks[c].count; i++) query_emit(run, par.chunks[c].results[i]);
+        json_mem_free((void *)par.chunks[c].results);
+    }
+    json_mem_free(par.chunks);
+    return ok;
+}
+
+/**
+ * 一个选择器作用于 node，选中的子节点交给下一段
+ */
+static void query_select(QueryRun *run, size_t seg, const JsonValue *node, const QuerySelector *sel) {
+    if (node->type == JSON_OBJECT) {
+        const JsonPair *pairs = node->value.object_value.pairs;
+        size_t count = node->value.object_value.pair_count;
+        if (sel->kind == QSEL_NAME) {
+            int index = find_key_index_n(node, sel->name, sel->name_len);
+            if (index >= 0) query_next(run, seg + 1, &pairs[index].value);
+        } else if (sel->kind == QSEL_WILDCARD || sel->kind == QSEL_FILTER) {
+            for (size_t i = 0; i < count && !run->stopped; i++) {
+                if (sel->kind == QSEL_FILTER && !query_match(run, sel->expr, &pairs[i].value)) continue;
+                query_next(run, seg + 1, &pairs[i].value);
+            }
+        }
+        return;
+    }
+    // 紧凑数组的元素没有独立节点，不能被选中（结果是文档内节点的指针，mJson.h 与 Readme 中说明了这一限制）
+    if (node->type != JSON_ARRAY || sel->kind == QSEL_NAME) return;
+
+    int64_t len = (int64_t)node->value.array_value.ele_count;
+    size_t first = 0, n = (size_t)len;
+    int64_t step = 1;
+    if (sel->kind == QSEL_INDEX) {
+        int64_t index = sel->index < 0 ? len + sel->index : sel->index;
+        if (index >= 0 && index < len) query_next(run, seg + 1, &node->value.array_value.elements[index]);
+        return;
+    }
+    if (sel->kind == QSEL_SLICE) {
+        // RFC 9535 切片：边界按长度规范化并截断，step 为 0 时不选中任何元素
+        step = sel->step;
+        if (step == 0) return;
+        int64_t start = sel->index < 0 ? len + sel->index : sel->index;
+        int64_t end = sel->end < 0 ? len + sel->end : sel->end;
+        int64_t lower, upper;
+        // 步长超过长度时只会选中第一个元素，先截断以免下面的计算溢出
+        if (len > 0 && step > len) step = len;
+        if (len > 0 && step < -len) step = -len;
+        if (step > 0) {
+            lower = sel->has_start ? (start < 0 ? 0 : start > len ? len : start) : 0;
+            upper = sel->has_end ? (end < 0 ? 0 : end > len ? len : end) : len;
+            if (lower >= upper) return;
+            first = (size_t)lower;
+            n = (size_t)((upper - lower + step - 1) / step);
+        } else {
+            upper = sel->has_start ? (start < -1 ? -1 : start > len - 1 ? len - 1 : start) : len - 1;
+            lower = sel->has_end ? (end < -1 ? -1 : end > len - 1 ? len - 1 : end) : -1;
+            if (upper <= lower) return;
+            first = (size_t)upper;
+            n = (size_t)((upper - lower + (-step) - 1) / (-step));
+        }
+    }
+    if (run->threads > 1 && n >= run->min_split && !run->callback &&
+        query_range_parallel(run, seg, node, sel, first, step, n)) {
+        return;
+    }
+    query_range(run, seg, node, sel, first, step, 0, n);
+}
+
+static void query_segment(QueryRun *run, size_t seg, const JsonValue *node) {
+    const QuerySegment *segment = &run->query->segments[seg];
+    for (size_t i = 0; i < segment->count && !run->stopped; i++) {
+        query_select(run, seg, node, &run->query->selectors[segment->first + i]);
+    }
+    if (!segment->descendant) return;
+    // 递归下降：按文档顺序作用于每个后代
+    if (node->type == JSON_ARRAY) {
+        for (size_t i = 0; i < node->value.array_value.ele_count && !run->stopped; i++) {
+            query_segment(run, seg, &node->value.array_value.elements[i]);
+        }
+    } else if (node->type == JSON_OBJECT) {
+        for (size_t i = 0; i < node->value.object_value.pair_count && !run->stopped; i++) {
+            query_segment(run, seg, &node->value.object_value.pairs[i].value);
+        }
+    }
+}
+
+static void query_next(QueryRun *run, size_t seg, const JsonValue *node) {
+    if (run->stopped) return;
+    if (seg == run->query->segment_count) {
+        query_emit(run, node);
+        return;
+    }
+    query_segment(run, seg, node);
+}
+
+/**
+ * 按文档顺序对每个命中节点调用 callback，callback 返回 false 时停止；节点指向文档内部，不做复制
+ * @param query
+ * @param doc
+ * @param callback
+ * @param user
+ * @return 已回调的节点数
+ */
+size_t json_query_each(const JsonQuery* query, const JsonValue* doc, JsonQueryCallback callback, void* user) {
+    if (!query || !doc || !callback) return 0;
+    QueryRun run = {query, doc, callback, user, NULL, 0, 0, false, false, 1, 0};
+    query_next(&run, 0, doc);
+    return run.count;
+}
+
+/**
+ * 把命中节点按文档顺序写入调用方提供的数组，不分配内存（并行时除外）
+ * @param query
+ * @param doc
+ * @param results 可为 NULL（只计数）
+ * @param capacity results 的容量，超出部分只计数
+ * @param threads 大于 1 时，元素数不少于 4096 的数组切块并行求值，结果顺序不变
+ * @return 命中总数，可能大于 capacity
+ */
+size_t json_query_select(const JsonQuery* query, const JsonValue* doc, const JsonValue** results,
+                         size_t capacity, unsigned int threads) {
+    if (!query || !doc) return 0;
+    QueryRun run = {query, doc, NULL, NULL, results, results ? capacity : 0, 0, false, false,
+                    threads, QUERY_MIN_SPLIT};
+    query_next(&run, 0, doc);
+    return run.count;
+}
+
+/**
+ * 编译并执行一次查询，如 json_query(&doc, "$.items[?(@.price > 100)].id", out, 64, &error)
+ * @return 命中总数，可能大于 capacity；表达式错误时返回 0 并设置 error
+ */
+size_t json_query(const JsonValue* doc, const char* expr, const JsonValue** results, size_t capacity, int* error) {
+    JsonQuery *query = json_query_compile(expr, error);
+    if (!query) return 0;
+    size_t count = json_query_select(query, doc, results, capacity, 1);
+    json_query_free(query);
+    return count;
+}
+
+// ============================= JSONPath 查询 end ================================
+
+// ============================= 冻结文档 start ================================
+
+#define FREEZE_INDEX_MIN_KEYS 16  // 冻结时为不少于该键数的对象建立按键索引，查找改为二分
+
+static int freeze_value(JsonValue *jv) {
+    void *data = value_block(jv);
+    const JsonAllocator *a = node_allocator(jv);
+    if (!data) {
+        // 空容器也需要存储块来记录冻结状态
+        if (jv->type == JSON_ARRAY) {
+            data = block_reserve(a, NULL, NULL, sizeof(JsonValue), 1);
+            if (!data) return 0;
+            jv->value.array_value.elements = data;
+        } else if (jv->type == JSON_OBJECT) {
+            if (!pairs_reserve(a, NULL, jv, 1)) return 0;
+            data = jv->value.object_value.pairs;
+        } else {
+            return 1;
+        }
+        value_adopt(jv);
+    }
+    // 共享的存储块只会被写时复制，本身不再被修改，保持原样
+    if (block_is_shared(data)) return 1;
+
+    if (jv->type == JSON_ARRAY) {
+        for (size_t i = 0; i < jv->value.array_value.ele_count; ++i) {
+            if (!freeze_value(&jv->value.array_value.elements[i])) return 0;
+        }
+    } else if (jv->type == JSON_OBJECT) {
+        size_t count = jv->value.object_value.pair_count;
+        if (count >= FREEZE_INDEX_MIN_KEYS && !(block_flags(data) & (BLOCK_SORTED | BLOCK_INDEXED)) &&
+            !object_sort(a, NULL, jv, true)) {
+            return 0;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (!freeze_value(&jv->value.object_value.pairs[i].value)) return 0;
+        }
+    }
+    // 子节点全部完成后再冻结本层，中途失败时文档仍可修改
+    BLOCK_OF(value_block(jv))->flags |= BLOCK_FROZEN;
+    return 1;
+}
+
+/**
+ * 冻结文档：之后所有修改接口（含 json_get_mut、补丁）返回失败：修改前沿所在存储块逐层向上检查，
+ * 任一层冻结即拒绝，因此经 json_get 取得的子节点同样不可修改。读取接口可由多个线程同时调用，
+ * 可重入且不分配内存；键数较多的对象同时建立按键索引。需在文档交给其他线程之前调用。
+ * 惰性结构（json_hash 的哈希、json_to_string_cached 的文本）以原子操作无锁发布，读取同样安全。
+ * 冻结后仍可 json_clone 出可修改的副本，文档用 json_free 释放
+ * @param jv
+ * @return 成功返回 1，内存不足返回 0（文档保持可修改）
+ */
+int json_freeze(JsonValue* jv) {
+    // 位于共享存储块中的节点（克隆后 json_get 取得）冻结后会影响其他克隆
+    if (!jv || !value_chain_writable(jv)) return 0;
+    return freeze_value(jv);
+}
+
+/**
+ * 容器是否已冻结，标量始终返回 false
+ */
+bool json_is_frozen(const JsonValue* jv) {
+    return jv && (block_flags(value_block(jv)) & BLOCK_FROZEN) != 0;
+}
+
+/**
+ * 序列化到调用方提供的缓冲区，不分配内存
+ * @param jv
+ * @param buf 可为 NULL，只计算长度
+ * @param size 缓冲区大小，大于所需长度时才写入（含结尾 NUL）
+ * @return 所需长度（不含 NUL），失败返回 0
+ */
+size_t json_to_buffer(const JsonValue* jv, char* buf, size_t size) {
+    if (!jv) return 0;
+    int length = json_value_length(jv);
+    if (length < 0) return 0;
+    if (buf && size > (size_t)length) {
+        char* end = json_value_serialize(buf, jv);
+        *end = '\0';
+    }
+    return (size_t)length;
+}
+
+// ============================= 冻结文档 end ================================
@@ -0,0 +1,49 @@
+//
+// 回归测试用的最小断言与公用辅助：失败时打印位置并计数，main 以失败数作为退出码
+//
+#ifndef MJSON_TESTS_CHECK_H
+#define MJSON_TESTS_CHECK_H
+
+#include "mJson.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        g_failures++; \
+    } \
+} while (0)
+
+#define CHECK_STR(actual, expected) do { \
+    const char *a_ = (actual), *e_ = (expected); \
+    if (!a_ || strcmp(a_, e_) != 0) { \
+        fprintf(stderr, "%s:%d: expected %s, got %s\n", __FILE__, __LINE__, e_, a_ ? a_ : "(null)"); \
+        g_failures++; \
+    } \
+} while (0)
+
+/**
+ * 按解析标志（JSON_PARSE_*）解析，使用全局分配器，解析失败计入失败数
+ */
+static inline JsonValue parse_with(const char *text, unsigned flags) {
+    JsonParseOptions options = {NULL, NULL, flags};
+    int error = JSON_SUCCESS;
+    JsonValue v = json_parse_ex(text, &options, &error);
+    CHECK(error == JSON_SUCCESS);
+    return v;
+}
+
+/**
+ * 序列化结果与期望文本一致
+ */
+static inline void check_output(const JsonValue *jv, const char *expected) {
+    char *out = json_to_string(jv);
+    CHECK_STR(out, expected);
+    free(out);
+}
+
+#endif //MJSON_TESTS_CHECK_H
@@ -0,0 +1,201 @@
+//
+// 文档分配器：json_parse_ex 指定的分配器在修改、克隆、冻结、补丁、序列化缓存和释放中都被沿用，解析统计与实际分配一致
+//
+#include "mJson.h"
+#include "check.h"
+#include <stdlib.h>
+
+// 每块内存前放一个头部记录大小；交给其他分配器释放时 ASan 会报告非法释放
+typedef struct {
+    size_t size;
+    size_t pad;
+} Header;
+
+typedef struct {
+    size_t live_count;
+    size_t live_bytes;
+} Arena;
+
+static void *arena_malloc(void *ctx, size_t size) {
+    Arena *arena = ctx;
+    Header *h = malloc(sizeof(Header) + size);
+    if (!h) return NULL;
+    h->size = size;
+    arena->live_count++;
+    arena->live_bytes += size;
+    return h + 1;
+}
+
+static void *arena_realloc(void *ctx, void *ptr, size_t size) {
+    Arena *arena = ctx;
+    if (!ptr) return arena_malloc(ctx, size);
+    Header *old = (Header *)ptr - 1;
+    size_t old_size = old->size;
+    Header *h = realloc(old, sizeof(Header) + size);
+    if (!h) return NULL;
+    h->size = size;
+    arena->live_bytes = arena->live_bytes - old_size + size;
+    return h + 1;
+}
+
+static void arena_free(void *ctx, void *ptr) {
+    Arena *arena = ctx;
+    if (!ptr) return;
+    Header *h = (Header *)ptr - 1;
+    arena->live_count--;
+    arena->live_bytes -= h->size;
+    free(h);
+}
+
+static Arena g_arena;
+static const JsonAllocator arena_allocator = {arena_malloc, arena_realloc, arena_free, &g_arena};
+
+static JsonValue parse_arena(const char *text, JsonAllocStats *stats) {
+    JsonParseOptions options = {&arena_allocator, stats, 0};
+    int error = JSON_SUCCESS;
+    JsonValue v = json_parse_ex(text, &options, &error);
+    CHECK(error == JSON_SUCCESS);
+    return v;
+}
+
+static void test_mutations(void) {
+    JsonValue doc = parse_arena("[1,2]", NULL);
+    JsonValue v = {.type = JSON_INT, .value.int_value = 3};
+    for (int i = 0; i < 16; i++) CHECK(array_append(&doc, &v));
+    CHECK(json_set_string(array_emplace(&doc), "tail"));
+    JsonValue *old = array_remove_at(&doc, 0);
+    CHECK(old != NULL);
+    json_free(old);
+    json_free(&doc);
+    CHECK(g_arena.live_count == 0);
+
+    doc = parse_arena("{\"a\":\"x\",\"o\":{},\"l\":[]}", NULL);
+    CHECK(object_add_pair(json_get_mut(&doc, "o"), "k", &v));
+    CHECK(json_set_string(json_get_mut(&doc, "a"), "yy"));
+    CHECK(json_set_string(object_emplace(json_get_mut(&doc, "o"), "s"), "str"));
+    CHECK(json_set_string(array_emplace(json_get_mut(&doc, "l")), "item"));
+    const char *keys[] = {"p", "q"};
+    JsonValue values[] = {{.type = JSON_INT, .value.int_value = 1}, {.type = JSON_NULL}};
+    CHECK(object_add_pairs(&doc, keys, values, 2));
+    CHECK(json_object_sort(&doc, true));
+    check_output(&doc, "{\"a\":\"yy\",\"o\":{\"k\":3,\"s\":\"str\"},\"l\":[\"item\"],\"p\":1,\"q\":null}");
+    old = object_remove(&doc, "a");
+    CHECK(old != NULL);
+    json_free(old);
+    json_free(&doc);
+    CHECK(g_arena.live_count == 0);
+
+    // 根节点为字符串时同样由文档分配器释放
+    doc = parse_arena("\"root\"", NULL);
+    CHECK(json_set_string(&doc, "changed"));
+    json_free(&doc);
+    CHECK(g_arena.live_count == 0);
+}
+
+static void test_clone_and_freeze(void) {
+    JsonValue doc = parse_arena("{\"a\":{\"s\":\"x\"},\"e\":[],\"n\":\"v\"}", NULL);
+    int error = JSON_SUCCESS;
+    JsonValue copy = json_clone(&doc, &error);
+    CHECK(error == JSON_SUCCESS);
+    CHECK(json_set_string(json_get_mut(&copy, "a.s"), "changed"));
+    CHECK(object_add_pair(json_get_mut(&copy, "a"), "t", &(JsonValue){.type = JSON_BOOL, .value.bool_value = true}));
+    check_output(&doc, "{\"a\":{\"s\":\"x\"},\"e\":[],\"n\":\"v\"}");
+    json_free(&copy);
+
+    // 冻结为空容器新建存储块
+    CHECK(json_freeze(&doc));
+    copy = json_clone(&doc, &error);
+    CHECK(error == JSON_SUCCESS);
+    CHECK(json_set_int(json_get_mut(&copy, "n"), 1));
+    json_free(&copy);
+    json_free(&doc);
+    CHECK(g_arena.live_count == 0);
+
+    JsonValue str = parse_arena("\"text\"", NULL);
+    copy = json_clone(&str, &error);
+    json_free(&str);
+    check_output(&copy, "\"text\"");
+    json_free(&copy);
+    CHECK(g_arena.live_count == 0);
+}
+
+/**
+ * 序列化缓存留在文档上，同样由文档分配器分配和释放
+ */
+static void test_serialize_cache(void) {
+    static const char TEXT[] = "{\"items\":[{\"name\":\"first item\",\"tags\":[\"a\",\"b\"]},"
+                               "{\"name\":\"second item\",\"tags\":[\"c\",\"d\"]}],\"total\":2}";
+    JsonValue doc = parse_arena(TEXT, NULL);
+    size_t parsed = g_arena.live_count;
+    char *text = json_to_string_cached(&doc);
+    CHECK_STR(text, TEXT);
+    free(text);
+    CHECK(g_arena.live_count > parsed);
+
+    // 修改丢弃祖先的缓存，再次序列化重建
+    CHECK(json_set_int(json_get_mut(&doc, "total"), 3));
+    text = json_to_string_cached(&doc);
+    CHECK(text != NULL);
+    free(text);
+    json_cache_clear(&doc);
+    CHECK(g_arena.live_count == parsed);
+
+    // 共享存储块上的缓存随最后一个持有者释放
+    free(json_to_string_cached(&doc));
+    int error = JSON_SUCCESS;
+    JsonValue copy = json_clone(&doc, &error);
+    CHECK(error == JSON_SUCCESS);
+    free(json_to_string_cached(&copy));
+    json_free(&doc);
+    CHECK(g_arena.live_count > 0);
+    json_free(&copy);
+    CHECK(g_arena.live_count == 0);
+}
+
+static void test_patches(void) {
+    int error = JSON_SUCCESS;
+    JsonValue doc = parse_arena("{\"a\":\"x\",\"b\":[1],\"c\":{\"d\":\"e\"}}", NULL);
+    JsonValue patch = json_parse("[{\"op\":\"add\",\"path\":\"/n\",\"value\":\"new\"},"
+                                 "{\"op\":\"remove\",\"path\":\"/a\"},"
+                                 "{\"op\":\"copy\",\"from\":\"/c\",\"path\":\"/b/0\"}]", &error);
+    CHECK(json_patch_apply(&doc, &patch) == JSON_SUCCESS);
+    json_free(&patch);
+    // 失败的补丁回滚已做的修改
+    patch = json_parse("[{\"op\":\"remove\",\"path\":\"/n\"},{\"op\":\"add\",\"path\":\"/k\",\"value\":\"s\"},"
+                       "{\"op\":\"test\",\"path\":\"/b/1\",\"value\":2}]", &error);
+    CHECK(json_patch_apply(&doc, &patch) == JSON_INVALID);
+    json_free(&patch);
+    patch = json_parse("{\"c\":{\"d\":null,\"f\":\"g\"},\"h\":\"i\"}", &error);
+    CHECK(json_merge_patch_apply(&doc, &patch) == JSON_SUCCESS);
+    json_free(&patch);
+    check_output(&doc, "{\"b\":[{\"d\":\"e\"},1],\"c\":{\"f\":\"g\"},\"n\":\"new\",\"h\":\"i\"}");
+    json_free(&doc);
+    CHECK(g_arena.live_count == 0);
+}
+
+static void test_parse_stats(void) {
+    JsonAllocStats stats = {0};
+    JsonValue doc = parse_arena("{\"key\":\"value\",\"esc\":\"a\\u0041\\n\",\"list\":[\"x\",{\"y\":\"z\"}]}", &stats);
+    // 字符串按实际长度分配，统计与分配器看到的存活字节数一致
+    CHECK(stats.current_bytes == g_arena.live_bytes);
+    CHECK(stats.alloc_count == g_arena.live_count);
+    json_free(&doc);
+    CHECK(g_arena.live_count == 0);
+
+    stats = (JsonAllocStats){0};
+    JsonParseOptions options = {&arena_allocator, &stats, JSON_PARSE_SORT_KEYS};
+    int error = JSON_SUCCESS;
+    doc = json_parse_ex("{\"a\":\"long string value\",\"b\":[\"s\",{\"k\":\"v\"}],\"c\":tru}", &options, &error);
+    CHECK(error == JSON_INVALID);
+    CHECK(stats.current_bytes == 0);
+    CHECK(g_arena.live_count == 0);
+}
+
+int main(void) {
+    test_mutations();
+    test_clone_and_freeze();
+    test_serialize_cache();
+    test_patches();
+    test_parse_stats();
+    return g_failures;
+}
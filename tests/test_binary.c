@@ -0,0 +1,213 @@
+//
+// CBOR 编解码：各 JsonType 经 json_from_binary 与 json_from_binary_flat 的往返、截断与不支持的输入、嵌套深度限制
+//
+#include "mJson.h"
+#include "check.h"
+#include <stdlib.h>
+
+/**
+ * 覆盖全部 JsonType：int64 由展开的 int64 紧凑数组产生，float/double 由 set 写入
+ */
+static JsonValue build_all_types(void) {
+    JsonValue doc = parse_with("{\"n\":null,\"t\":true,\"f\":false,\"i\":-7,\"u\":2147483647,\"fl\":0,\"d\":0,"
+                               "\"s\":\"h\\u00e9llo\",\"es\":\"\",\"big\":[1,-9007199254740993],"
+                               "\"arr\":[1,\"x\",[],{}],\"o\":{\"z\":1,\"a\":{\"b\":[null]}},\"eo\":{},"
+                               "\"pi\":[1,-2,3],\"pl\":[1,9007199254740993],\"pf\":[0.5,-1.5],\"pd\":[0.5,3.1415926535898]}",
+                               JSON_PARSE_PACK_NUMBERS);
+    CHECK(json_set_float(json_get_mut(&doc, "fl"), -2.5f));
+    CHECK(json_set_double(json_get_mut(&doc, "d"), 1e300));
+    CHECK(json_array_unpack(json_get_mut(&doc, "big")));
+    return doc;
+}
+
+static void check_types(const JsonValue *doc) {
+    static const struct {
+        const char *path;
+        JsonType type;
+    } expected[] = {
+        {"n", JSON_NULL}, {"t", JSON_BOOL}, {"i", JSON_INT}, {"u", JSON_INT}, {"fl", JSON_FLOAT},
+        {"d", JSON_DOUBLE}, {"s", JSON_STRING}, {"es", JSON_STRING}, {"big[1]", JSON_INT64},
+        {"arr", JSON_ARRAY}, {"arr[2]", JSON_ARRAY}, {"o", JSON_OBJECT}, {"eo", JSON_OBJECT},
+        {"pi", JSON_INT_ARRAY}, {"pl", JSON_INT64_ARRAY}, {"pf", JSON_FLOAT_ARRAY}, {"pd", JSON_DOUBLE_ARRAY},
+    };
+    CHECK(doc->type == JSON_OBJECT);
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        const JsonValue *v = json_get(doc, expected[i].path);
+        if (!v || v->type != expected[i].type) fprintf(stderr, "  path %s\n", expected[i].path);
+        CHECK(v && v->type == expected[i].type);
+    }
+    CHECK(json_get(doc, "big[1]")->value.int64_value == -9007199254740993LL);
+    CHECK(json_get(doc, "fl")->value.float_value == -2.5f);
+    CHECK(json_get(doc, "d")->value.double_value == 1e300);
+    CHECK(json_get(doc, "f")->value.bool_value == false);
+    CHECK_STR(json_get(doc, "s")->value.string_value, "h\xC3\xA9llo");
+    const JsonValue *pl = json_get(doc, "pl");
+    CHECK(pl->value.packed_value.count == 2 && ((const int64_t *)pl->value.packed_value.data)[1] == 9007199254740993LL);
+    const JsonValue *pf = json_get(doc, "pf");
+    CHECK(pf->value.packed_value.count == 2 && ((const float *)pf->value.packed_value.data)[1] == -1.5f);
+}
+
+static void check_same_binary(const JsonValue *jv, const unsigned char *expected, size_t expected_len) {
+    size_t len = 0;
+    unsigned char *data = json_to_binary(jv, &len);
+    CHECK(data && len == expected_len && memcmp(data, expected, len) == 0);
+    free(data);
+}
+
+static void test_round_trip(void) {
+    JsonValue doc = build_all_types();
+    check_types(&doc);
+    size_t len = 0;
+    unsigned char *data = json_to_binary(&doc, &len);
+    CHECK(data != NULL && len > 0);
+    if (!data) return;
+
+    int error = JSON_INVALID;
+    JsonValue decoded = json_from_binary(data, len, &error);
+    CHECK(error == JSON_SUCCESS);
+    check_types(&decoded);
+    CHECK(json_equal(&doc, &decoded));
+    check_same_binary(&decoded, data, len);
+    // 解码结果是普通文档，可以修改
+    CHECK(json_set_int(json_get_mut(&decoded, "i"), 8));
+    json_free(&decoded);
+
+    error = JSON_INVALID;
+    JsonValue *flat = json_from_binary_flat(data, len, &error);
+    CHECK(flat != NULL && error == JSON_SUCCESS);
+    if (flat) {
+        check_types(flat);
+        CHECK(json_equal(&doc, flat));
+        check_same_binary(flat, data, len);
+        CHECK(json_get(flat, "i")->value.int_value == -7);
+    }
+    json_free_flat(flat);
+
+    // 各类型单独作为顶层值
+    static const char *SCALARS[] = {"null", "true", "-1", "0.5", "\"\"", "[]", "{}", "[1,2]", "[0.5]"};
+    for (size_t i = 0; i < sizeof(SCALARS) / sizeof(SCALARS[0]); i++) {
+        JsonValue v = parse_with(SCALARS[i], JSON_PARSE_PACK_NUMBERS);
+        size_t vlen = 0;
+        unsigned char *bytes = json_to_binary(&v, &vlen);
+        JsonValue back = json_from_binary(bytes, vlen, &error);
+        CHECK(error == JSON_SUCCESS && back.type == v.type && json_equal(&v, &back));
+        JsonValue *back_flat = json_from_binary_flat(bytes, vlen, &error);
+        CHECK(back_flat && back_flat->type == v.type && json_equal(&v, back_flat));
+        json_free_flat(back_flat);
+        json_free(&back);
+        free(bytes);
+        json_free(&v);
+    }
+    free(data);
+    json_free(&doc);
+}
+
+static void check_rejected(const unsigned char *data, size_t len, int expected) {
+    int error = JSON_SUCCESS;
+    JsonValue v = json_from_binary(data, len, &error);
+    CHECK(error == expected);
+    CHECK(v.type == JSON_NULL);
+    error = JSON_SUCCESS;
+    CHECK(json_from_binary_flat(data, len, &error) == NULL);
+    CHECK(error == expected);
+}
+
+#define REJECT(expected, ...) do { \
+    static const unsigned char bytes_[] = {__VA_ARGS__}; \
+    check_rejected(bytes_, sizeof(bytes_), expected); \
+} while (0)
+
+static void test_truncated(void) {
+    JsonValue doc = build_all_types();
+    size_t len = 0;
+    unsigned char *data = json_to_binary(&doc, &len);
+    json_free(&doc);
+    CHECK(data != NULL);
+    if (!data) return;
+    // 每个前缀都不完整；多出的字节同样拒绝
+    for (size_t i = 0; i < len; i++) check_rejected(data, i, JSON_INVALID);
+    unsigned char *longer = malloc(len + 1);
+    if (longer) {
+        memcpy(longer, data, len);
+        longer[len] = 0xF6;
+        check_rejected(longer, len + 1, JSON_INVALID);
+        free(longer);
+    }
+    free(data);
+
+    int error = JSON_SUCCESS;
+    json_from_binary(NULL, 0, &error);
+    CHECK(error == JSON_INVALID);
+    CHECK(json_from_binary_flat(NULL, 0, &error) == NULL && error == JSON_INVALID);
+    // 声明的长度超过剩余输入
+    REJECT(JSON_INVALID, 0x9B, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF);
+    REJECT(JSON_INVALID, 0x65, 'a', 'b');
+    REJECT(JSON_INVALID, 0xD8, 0x4E, 0x48, 0x01, 0x00, 0x00, 0x00);
+}
+
+static void test_unsupported(void) {
+    // 不定长的字节串、文本、数组、映射
+    REJECT(JSON_INVALID, 0x5F, 0x41, 'a', 0xFF);
+    REJECT(JSON_INVALID, 0x7F, 0x61, 'a', 0xFF);
+    REJECT(JSON_INVALID, 0x9F, 0x01, 0xFF);
+    REJECT(JSON_INVALID, 0xBF, 0x61, 'a', 0x01, 0xFF);
+    REJECT(JSON_INVALID, 0x82, 0x01, 0x9F, 0xFF);
+    // 保留的附加信息 28..30
+    REJECT(JSON_INVALID, 0x1C);
+    // 非文本键：整数、字节串、数组
+    REJECT(JSON_INVALID, 0xA1, 0x01, 0x02);
+    REJECT(JSON_INVALID, 0xA1, 0x41, 'k', 0x02);
+    REJECT(JSON_INVALID, 0xA1, 0x80, 0x02);
+    REJECT(JSON_INVALID, 0xA2, 0x61, 'k', 0x01, 0x02, 0x03);
+    // 文本中的 NUL、顶层字节串、未知标签、未分配的简单值、元素大小不整除的类型化数组
+    REJECT(JSON_INVALID, 0x63, 'a', 0x00, 'b');
+    REJECT(JSON_INVALID, 0x41, 0x00);
+    REJECT(JSON_INVALID, 0xC1, 0x01);
+    REJECT(JSON_INVALID, 0xF7);
+    REJECT(JSON_INVALID, 0xD8, 0x4E, 0x43, 0x01, 0x00, 0x00);
+
+    // 半精度浮点解码为 float
+    static const unsigned char half[] = {0xF9, 0x3E, 0x00};
+    int error = JSON_INVALID;
+    JsonValue v = json_from_binary(half, sizeof(half), &error);
+    CHECK(error == JSON_SUCCESS && v.type == JSON_FLOAT && v.value.float_value == 1.5f);
+}
+
+static void test_depth(void) {
+    // 容器最多嵌套 1024 层
+    size_t len = 1025;
+    unsigned char *data = malloc(len + 1);
+    if (!data) return;
+    memset(data, 0x81, len);
+    data[len - 1] = 0x80;
+    int error = JSON_INVALID;
+    JsonValue v = json_from_binary(data + 1, len - 1, &error);
+    CHECK(error == JSON_SUCCESS && v.type == JSON_ARRAY);
+    json_free(&v);
+    JsonValue *flat = json_from_binary_flat(data + 1, len - 1, &error);
+    CHECK(flat != NULL && error == JSON_SUCCESS);
+    json_free_flat(flat);
+    check_rejected(data, len, JSON_TOO_DEEP);
+
+    free(data);
+
+    // 映射与数组共用深度限制：512 组 {"k":[ 共 1024 层
+    data = malloc(512 * 4 + 1);
+    if (!data) return;
+    for (size_t i = 0; i < 512; i++) memcpy(data + i * 4, "\xA1\x61k\x81", 4);
+    data[2048] = 0xF6;
+    v = json_from_binary(data, 2049, &error);
+    CHECK(error == JSON_SUCCESS && json_get(&v, "k[0].k[0].k[0]") != NULL);
+    json_free(&v);
+    data[2048] = 0x80;
+    check_rejected(data, 2049, JSON_TOO_DEEP);
+    free(data);
+}
+
+int main(void) {
+    test_round_trip();
+    test_truncated();
+    test_unsupported();
+    test_depth();
+    return g_failures;
+}
@@ -0,0 +1,58 @@
+//
+// 结构体绑定与字符串解析：非法转义、未闭合字符串必须报错
+//
+#include "mJson.h"
+#include "check.h"
+#include <stdlib.h>
+
+typedef struct {
+    char *name;
+    char tag[8];
+    int id;
+} Item;
+
+static const JsonField item_fields[] = {
+    JSON_FIELD_OF(Item, name, JSON_FIELD_STRING),
+    JSON_FIELD_OF(Item, tag, JSON_FIELD_CHARS),
+    JSON_FIELD_OF(Item, id, JSON_FIELD_INT),
+};
+static const JsonStructDesc item_desc = JSON_STRUCT_DESC(Item, item_fields);
+
+static void test_decode(void) {
+    Item item;
+    CHECK(json_decode_struct("{\"name\":\"a\\nb\",\"tag\":\"x\",\"id\":3}", &item_desc, &item) == JSON_SUCCESS);
+    CHECK_STR(item.name, "a\nb");
+    CHECK_STR(item.tag, "x");
+    CHECK(item.id == 3);
+    json_struct_free(&item_desc, &item);
+
+    CHECK(json_decode_struct("{\"name\":\"a\\qb\"}", &item_desc, &item) == JSON_INVALID);
+    CHECK(json_decode_struct("{\"tag\":\"a\\qb\"}", &item_desc, &item) == JSON_INVALID);
+    CHECK(json_decode_struct("{\"na\\qme\":1}", &item_desc, &item) == JSON_INVALID);
+    CHECK(json_decode_struct("{\"name\":\"ab", &item_desc, &item) == JSON_INVALID);
+    CHECK(json_decode_struct("{\"name\":\"ab\\", &item_desc, &item) == JSON_INVALID);
+    CHECK(json_decode_struct("{\"na\\u00", &item_desc, &item) == JSON_INVALID);
+    CHECK(json_decode_struct("{\"name\":\"\\u12G4\"}", &item_desc, &item) == JSON_INVALID);
+    CHECK(item.name == NULL);
+}
+
+static void test_parse(void) {
+    static const char *invalid[] = {"\"ab", "[\"ab", "{\"ab", "{\"a\":\"b", "\"a\\qb\"", "\"a\\", "[\"\\u12\"]"};
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        int error = JSON_SUCCESS;
+        JsonValue v = json_parse(invalid[i], &error);
+        CHECK(error != JSON_SUCCESS);
+        json_free(&v);
+    }
+    int error;
+    JsonValue v = json_parse("\"a\\u0041\\/\"", &error);
+    CHECK(error == JSON_SUCCESS && v.type == JSON_STRING);
+    CHECK_STR(v.value.string_value, "aA/");
+    json_free(&v);
+}
+
+int main(void) {
+    test_decode();
+    test_parse();
+    return g_failures ? 1 : 0;
+}
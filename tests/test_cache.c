@@ -0,0 +1,79 @@
+//
+// 序列化缓存：任何修改都使被写节点及其全部祖先的缓存失效，与节点经 json_get 还是 json_get_mut 取得无关
+//
+#include "mJson.h"
+#include "check.h"
+#include <stdlib.h>
+
+static const char *STATUS =
+    "{\"status\":{\"uptime\":1,\"name\":\"svc\",\"workers\":[{\"load\":1},{\"load\":2}]},\"tags\":[\"a\"]}";
+
+/**
+ * 缓存输出与无缓存输出一致
+ */
+static void check_cached(const JsonValue *jv, const char *expected) {
+    char *cached = json_to_string_cached(jv);
+    char *plain = json_to_string(jv);
+    CHECK_STR(cached, expected);
+    CHECK_STR(plain, expected);
+    free(cached);
+    free(plain);
+}
+
+static void test_get_pointers(void) {
+    JsonValue doc = parse_with(STATUS, 0);
+    check_cached(&doc, STATUS);
+    // 先缓存各层子树
+    free(json_to_string_cached(json_get(&doc, "status.workers")));
+
+    JsonValue v = {.type = JSON_INT, .value.int_value = 2};
+    JsonValue *old = object_update(json_get(&doc, "status"), "uptime", &v);
+    CHECK(old != NULL);
+    json_free(old);
+    check_cached(&doc, "{\"status\":{\"uptime\":2,\"name\":\"svc\",\"workers\":[{\"load\":1},{\"load\":2}]},\"tags\":[\"a\"]}");
+
+    CHECK(json_set_int(json_get(&doc, "status.workers[1].load"), 9));
+    check_cached(&doc, "{\"status\":{\"uptime\":2,\"name\":\"svc\",\"workers\":[{\"load\":1},{\"load\":9}]},\"tags\":[\"a\"]}");
+    check_cached(json_get(&doc, "status.workers"), "[{\"load\":1},{\"load\":9}]");
+
+    CHECK(json_set_string(json_get(&doc, "status.name"), "api"));
+    CHECK(array_append(json_get(&doc, "tags"), &v));
+    check_cached(&doc, "{\"status\":{\"uptime\":2,\"name\":\"api\",\"workers\":[{\"load\":1},{\"load\":9}]},\"tags\":[\"a\",2]}");
+
+    JsonValue *removed = object_remove(json_get(&doc, "status.workers[0]"), "load");
+    CHECK(removed != NULL);
+    json_free(removed);
+    check_cached(&doc, "{\"status\":{\"uptime\":2,\"name\":\"api\",\"workers\":[{},{\"load\":9}]},\"tags\":[\"a\",2]}");
+
+    int error = JSON_SUCCESS;
+    JsonValue patch = json_parse("[{\"op\":\"replace\",\"path\":\"/load\",\"value\":5}]", &error);
+    CHECK(json_patch_apply(json_get(&doc, "status.workers[1]"), &patch) == JSON_SUCCESS);
+    json_free(&patch);
+    patch = json_parse("{\"uptime\":null}", &error);
+    CHECK(json_merge_patch_apply(json_get(&doc, "status"), &patch) == JSON_SUCCESS);
+    json_free(&patch);
+    check_cached(&doc, "{\"status\":{\"name\":\"api\",\"workers\":[{},{\"load\":5}]},\"tags\":[\"a\",2]}");
+
+    json_cache_clear(&doc);
+    json_free(&doc);
+}
+
+static void test_clone_caches(void) {
+    JsonValue doc = parse_with(STATUS, 0);
+    check_cached(&doc, STATUS);
+    int error = JSON_SUCCESS;
+    JsonValue copy = json_clone(&doc, &error);
+    CHECK(error == JSON_SUCCESS);
+    // 克隆共用源文档的缓存，修改克隆只丢弃克隆复制出的各层
+    CHECK(json_set_int(json_get_mut(&copy, "status.workers[0].load"), 7));
+    check_cached(&copy, "{\"status\":{\"uptime\":1,\"name\":\"svc\",\"workers\":[{\"load\":7},{\"load\":2}]},\"tags\":[\"a\"]}");
+    check_cached(&doc, STATUS);
+    json_free(&copy);
+    json_free(&doc);
+}
+
+int main(void) {
+    test_get_pointers();
+    test_clone_caches();
+    return g_failures;
+}
@@ -0,0 +1,190 @@
+//
+// 写时复制克隆：经 json_get 取得的共享节点一律拒绝修改，经 json_get_mut 取得的节点修改后源文档不变
+//
+#include "mJson.h"
+#include "check.h"
+#include <stdlib.h>
+
+static const char *SOURCE =
+    "{\"a\":{\"b\":1,\"s\":\"text\",\"list\":[1,2,3]},\"obj\":{\"z\":1,\"y\":2},\"nums\":[1,2,3]}";
+
+static JsonValue clone_of(const JsonValue *src) {
+    int error = JSON_SUCCESS;
+    JsonValue c = json_clone(src, &error);
+    CHECK(error == JSON_SUCCESS);
+    return c;
+}
+
+static JsonValue *get_shared(JsonValue *doc, const char *path) { return json_get(doc, path); }
+static JsonValue *get_mut(JsonValue *doc, const char *path) { return json_get_mut(doc, path); }
+
+/**
+ * 对 a（对象，含键 b）、a.list（数组）、obj（已排序对象）、a.s（标量）逐一调用修改接口
+ * 每组修改前重新取节点，避免前一组修改使指针失效
+ * @param expect 期望的返回：1 表示全部成功，0 表示全部被拒绝
+ */
+static void mutate_all(JsonValue *doc, JsonValue *(*get)(JsonValue *, const char *), int expect) {
+    JsonValue *list = get(doc, "a.list");
+    JsonValue v = {.type = JSON_INT, .value.int_value = 7};
+    JsonValue *ptrs[] = {&v};
+    JsonValue moved[] = {{.type = JSON_INT, .value.int_value = 8}};
+    const char *keys[] = {"k"};
+
+    CHECK(array_append(list, &v) == expect);
+    CHECK(batch_append(list, ptrs, 1) == expect);
+    CHECK(array_insert_at(list, 0, &v) == expect);
+    CHECK(array_insert_batch(list, 0, ptrs, 1) == expect);
+    CHECK(array_reserve(list, 64) == expect);
+    CHECK(array_append_move(list, moved, 1) == expect);
+    CHECK((array_get_mut(list, 0) != NULL) == expect);
+    CHECK((array_emplace(list) != NULL) == expect);
+    // 返回的旧元素位于容器的备用槽中，只释放内容
+    JsonValue *old = array_replace_at(list, 0, &v);
+    CHECK((old != NULL) == expect);
+    if (old) json_free(old);
+    old = array_remove_at(list, 0);
+    CHECK((old != NULL) == expect);
+    if (old) json_free(old);
+
+    JsonValue *obj = get(doc, "a");
+    CHECK(object_add_pair(obj, "n1", &v) == expect);
+    CHECK(object_insert_at(obj, 0, "n2", &v) == expect);
+    CHECK(object_reserve(obj, 64) == expect);
+    moved[0] = (JsonValue){.type = JSON_INT, .value.int_value = 9};
+    CHECK(object_add_pairs(obj, keys, moved, 1) == expect);
+    CHECK((object_emplace(obj, "n3") != NULL) == expect);
+    CHECK((object_get_mut_n(obj, "b", 1) != NULL) == expect);
+    old = object_update(obj, "b", &v);
+    CHECK((old != NULL) == expect);
+    if (old) json_free(old);
+    old = object_remove(obj, "n1");
+    CHECK((old != NULL) == expect);
+    if (old) json_free(old);
+
+    JsonValue *sorted = get(doc, "obj");
+    CHECK(object_insert_sorted(sorted, "m", &v) == expect);
+    moved[0] = (JsonValue){.type = JSON_INT, .value.int_value = 10};
+    CHECK(object_insert_sorted_batch(sorted, keys, moved, 1) == expect);
+    CHECK(json_object_sort(sorted, false) == expect);
+
+    list = get(doc, "a.list");
+    JsonBuilder *builder = json_builder_create();
+    JsonValue *node = json_builder_node(builder);
+    json_set_int(node, 11);
+    CHECK(json_builder_append(builder, list, node) == expect);
+    if (!expect) json_builder_release(builder, node);
+    node = json_builder_node(builder);
+    json_set_int(node, 12);
+    CHECK(json_builder_add_pair(builder, obj, "n4", node) == expect);
+    if (!expect) json_builder_release(builder, node);
+    json_builder_destroy(builder);
+
+    CHECK(json_insert(&obj, "n5", &v) == expect);
+    CHECK(json_insert(&obj, "b", &v) == expect);
+
+    int error = JSON_SUCCESS;
+    JsonValue patch = json_parse("[{\"op\":\"add\",\"path\":\"/n6\",\"value\":1},"
+                                 "{\"op\":\"replace\",\"path\":\"/b\",\"value\":\"r\"}]", &error);
+    CHECK((json_patch_apply(obj, &patch) == JSON_SUCCESS) == expect);
+    json_free(&patch);
+    patch = json_parse("{\"b\":null,\"n7\":{\"x\":1}}", &error);
+    CHECK((json_merge_patch_apply(obj, &patch) == JSON_SUCCESS) == expect);
+    json_free(&patch);
+
+    JsonValue *scalar = get(doc, "a.s");
+    CHECK(json_set_null(scalar) == expect);
+    CHECK(json_set_bool(scalar, true) == expect);
+    CHECK(json_set_int(scalar, 3) == expect);
+    CHECK(json_set_float(scalar, 1.5f) == expect);
+    CHECK(json_set_double(scalar, 2.5) == expect);
+    CHECK(json_set_array(scalar) == expect);
+    CHECK(json_set_object(scalar) == expect);
+    CHECK(json_set_string_n(scalar, "ab", 2) == expect);
+    CHECK(json_set_string(scalar, "changed") == expect);
+}
+
+static void test_shared_nodes_refuse(void) {
+    JsonValue src = parse_with(SOURCE, JSON_PARSE_SORT_KEYS | JSON_PARSE_KEEP_ORDER);
+    char *before = json_to_string(&src);
+    JsonValue c = clone_of(&src);
+
+    mutate_all(&c, get_shared, 0);
+    check_output(&src, before);
+    check_output(&c, before);
+
+    json_free(&c);
+    check_output(&src, before);
+    free(before);
+    json_free(&src);
+}
+
+static void test_mut_nodes_copy(void) {
+    JsonValue src = parse_with(SOURCE, JSON_PARSE_SORT_KEYS | JSON_PARSE_KEEP_ORDER);
+    char *before = json_to_string(&src);
+    JsonValue c = clone_of(&src);
+
+    mutate_all(&c, get_mut, 1);
+    check_output(json_get(&c, "a.s"), "\"changed\"");
+    check_output(&src, before);
+
+    // 源文档反过来修改也不影响克隆
+    char *cloned = json_to_string(&c);
+    JsonValue v = {.type = JSON_INT, .value.int_value = 42};
+    CHECK(json_set_int(json_get_mut(&src, "a.b"), 5));
+    CHECK(array_append(json_get_mut(&src, "a.list"), &v));
+    check_output(&c, cloned);
+    free(cloned);
+
+    json_free(&c);
+    free(before);
+    json_free(&src);
+}
+
+static void test_nested_clone_chain(void) {
+    // 多层克隆：中间一份释放后，剩余两份仍互不影响
+    JsonValue src = parse_with(SOURCE, 0);
+    JsonValue c1 = clone_of(&src);
+    JsonValue c2 = clone_of(&c1);
+    CHECK(!json_set_int(json_get(&c2, "a.b"), 9));
+    json_free(&c1);
+    CHECK(json_set_int(json_get_mut(&c2, "a.b"), 9));
+    CHECK(json_set_string(json_get_mut(&src, "a.s"), "other"));
+    check_output(json_get(&src, "a"), "{\"b\":1,\"s\":\"other\",\"list\":[1,2,3]}");
+    check_output(json_get(&c2, "a"), "{\"b\":9,\"s\":\"text\",\"list\":[1,2,3]}");
+    json_free(&c2);
+    json_free(&src);
+}
+
+static void test_sole_owner_writable(void) {
+    // 源文档释放后克隆独占全部存储块，json_get 取得的节点重新可写
+    JsonValue src = parse_with(SOURCE, 0);
+    JsonValue c = clone_of(&src);
+    json_free(&src);
+    CHECK(json_set_int(json_get(&c, "a.b"), 2));
+    JsonValue v = {.type = JSON_INT, .value.int_value = 4};
+    CHECK(array_append(json_get(&c, "a.list"), &v));
+    check_output(json_get(&c, "a"), "{\"b\":2,\"s\":\"text\",\"list\":[1,2,3,4]}");
+    json_free(&c);
+}
+
+static void test_packed_unpack(void) {
+    JsonValue src = parse_with("{\"nums\":[1,2,3]}", JSON_PARSE_PACK_NUMBERS);
+    JsonValue c = clone_of(&src);
+    CHECK(json_is_packed_array(json_get(&c, "nums")));
+    CHECK(!json_array_unpack(json_get(&c, "nums")));
+    CHECK(json_array_unpack(json_get_mut(&c, "nums")));
+    CHECK(!json_is_packed_array(json_get(&c, "nums")));
+    CHECK(json_is_packed_array(json_get(&src, "nums")));
+    check_output(&src, "{\"nums\":[1,2,3]}");
+    json_free(&c);
+    json_free(&src);
+}
+
+int main(void) {
+    test_shared_nodes_refuse();
+    test_mut_nodes_copy();
+    test_nested_clone_chain();
+    test_sole_owner_writable();
+    test_packed_unpack();
+    return g_failures;
+}
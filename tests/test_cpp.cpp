@@ -0,0 +1,129 @@
+//
+// C++ 封装：结构体按键表解码、set 系列返回修改结果、紧凑数组按下标取元素
+//
+#include "mJson.hpp"
+#include "check.h"
+#include <string>
+#include <vector>
+
+struct Limits {
+    int rps = 0;
+    std::optional<int> burst;
+};
+MJSON_FIELDS(Limits, rps, burst)
+
+// 字段声明顺序与键的字典序不同
+struct Service {
+    std::string zone;
+    int port = 0;
+    std::vector<double> weights;
+    Limits limits;
+    bool enabled = false;
+    std::string alpha;
+};
+MJSON_FIELDS(Service, zone, port, weights, limits, enabled, alpha)
+
+static void test_decode(void) {
+    Service svc;
+    svc.alpha = "kept";
+    const char *json = "{\"unknown\":[1,{}],\"port\":8080,\"enabled\":true,\"zone\":\"eu\","
+                       "\"limits\":{\"burst\":null,\"rps\":5},\"weights\":[0.5,1.5],\"zz\":1}";
+    CHECK(mjson::decode(json, svc) == JSON_SUCCESS);
+    CHECK(svc.zone == "eu");
+    CHECK(svc.port == 8080);
+    CHECK(svc.enabled);
+    CHECK(svc.limits.rps == 5 && !svc.limits.burst);
+    CHECK(svc.weights.size() == 2 && svc.weights[1] == 1.5);
+    // 缺少的字段保持原值
+    CHECK(svc.alpha == "kept");
+    // 类型不符的字段使解码失败
+    CHECK(mjson::decode("{\"port\":\"x\"}", svc) == JSON_INVALID);
+    CHECK(mjson::to_json(svc.limits) == "{\"rps\":5,\"burst\":null}");
+}
+
+static void test_set_status(void) {
+    mjson::Document doc = mjson::Document::parse("{\"a\":{\"b\":1}}");
+    CHECK(doc.mut()["a"]["b"].set(2));
+    CHECK(doc.mut()["a"]["c"].set(3) == false);
+    CHECK(doc.freeze());
+    mjson::MutValue frozen = doc.mut();
+    CHECK(!frozen.set_null());
+    CHECK(!frozen.set(true));
+    CHECK(!frozen.set(1));
+    CHECK(!frozen.set(1.5f));
+    CHECK(!frozen.set(2.5));
+    CHECK(!frozen.set("s"));
+    CHECK(!frozen.set_array());
+    CHECK(!frozen.set_object());
+    CHECK(doc.to_string() == "{\"a\":{\"b\":2}}");
+}
+
+static void test_packed_index(void) {
+    JsonParseOptions options = {NULL, NULL, JSON_PARSE_PACK_NUMBERS};
+    mjson::Document doc = mjson::Document::parse("{\"i\":[1,2,3],\"l\":[1,9007199254740993],\"f\":[0.5,2]}",
+                                                 nullptr, &options);
+    mjson::Value ints = doc["i"];
+    CHECK(ints.is_packed());
+    CHECK(ints[2].as_int() == 3);
+    CHECK(!ints[3].valid());
+    CHECK(doc["l"][1].type() == mjson::Type::Int64 && doc["l"][1].as_int64() == 9007199254740993LL);
+    CHECK(doc["l"][0].type() == mjson::Type::Int);
+    CHECK(doc["f"][0].as_double() == 0.5);
+
+    // 视图复制后仍指向自己的元素副本
+    mjson::Value first = ints[0];
+    mjson::Value copy = first;
+    first = ints[1];
+    CHECK(copy.as_int() == 1 && first.as_int() == 2);
+    CHECK(copy.get() != first.get());
+
+    std::vector<int> values;
+    CHECK(mjson::from_json(ints, values) && values.size() == 3);
+}
+
+/**
+ * 同一文本按紧凑数组与普通数组解析，解码到 vector<E> 的结果一致
+ */
+template <class E>
+static bool decode_both(const char *text, std::vector<E> &packed) {
+    JsonParseOptions options = {NULL, NULL, JSON_PARSE_PACK_NUMBERS};
+    mjson::Document a = mjson::Document::parse(text, nullptr, &options);
+    mjson::Document b = mjson::Document::parse(text);
+    CHECK(a.root().is_packed() && b.root().is_array());
+    std::vector<E> plain;
+    bool ok = mjson::from_json(a.root(), packed);
+    CHECK(ok == mjson::from_json(b.root(), plain));
+    if (ok) CHECK(packed == plain);
+    return ok;
+}
+
+static void test_packed_vectors(void) {
+    std::vector<int> ints;
+    CHECK(!decode_both("[1.5,2.7,-3.9]", ints));
+    CHECK(decode_both("[1,2,-3]", ints) && ints[2] == -3);
+    CHECK(!decode_both("[1,9007199254740993]", ints));
+    std::vector<std::uint8_t> bytes;
+    CHECK(!decode_both("[300,-1]", bytes));
+    CHECK(decode_both("[0,255]", bytes) && bytes[1] == 255);
+    std::vector<std::int64_t> longs;
+    CHECK(decode_both("[1,5000000000]", longs) && longs[1] == 5000000000LL);
+    // 普通数组中超出 int 的整数保存为 double，紧凑数组保留全部精度
+    JsonParseOptions options = {NULL, NULL, JSON_PARSE_PACK_NUMBERS};
+    mjson::Document big = mjson::Document::parse("[1,9007199254740993]", nullptr, &options);
+    CHECK(mjson::from_json(big.root(), longs) && longs[1] == 9007199254740993LL);
+    CHECK(decode_both("[1,2]", longs) && longs[1] == 2);
+    std::vector<double> doubles;
+    CHECK(decode_both("[0.5,175.23]", doubles) && doubles[1] == 175.23);
+    std::vector<float> floats;
+    CHECK(decode_both("[0.5,3.1415926535898]", floats) && floats[0] == 0.5f);
+    std::vector<std::optional<int>> optionals;
+    CHECK(decode_both("[1,2]", optionals) && optionals[1] == 2);
+}
+
+int main() {
+    test_decode();
+    test_set_status();
+    test_packed_index();
+    test_packed_vectors();
+    return g_failures;
+}
@@ -0,0 +1,97 @@
+//
+// 冻结文档：经任何途径取得的节点上的修改接口都失败；克隆中仍位于冻结存储块内的节点只能经 json_get_mut 写入，源文档保持不变
+//
+#include "mJson.h"
+#include "check.h"
+#include <stdlib.h>
+
+static const char *CONFIG =
+    "{\"svc\":{\"cfg\":{\"port\":80,\"host\":\"h\",\"tags\":[\"a\"],\"nums\":[1,2]}},\"name\":\"svc\"}";
+
+static JsonValue parse_frozen(void) {
+    JsonValue doc = parse_with(CONFIG, JSON_PARSE_PACK_NUMBERS);
+    CHECK(json_freeze(&doc));
+    return doc;
+}
+
+/**
+ * svc.cfg 及其下各节点上的修改接口全部失败
+ */
+static void check_refused(JsonValue *doc) {
+    JsonValue v = {.type = JSON_INT, .value.int_value = 1};
+    JsonValue *cfg = json_get(doc, "svc.cfg");
+    JsonValue *port = json_get(doc, "svc.cfg.port");
+    JsonValue *tags = json_get(doc, "svc.cfg.tags");
+
+    CHECK(!json_set_int(port, 8080));
+    CHECK(!json_set_null(port));
+    CHECK(!json_set_string(json_get(doc, "svc.cfg.host"), "x"));
+    CHECK(!json_set_object(tags));
+    CHECK(!json_set_string(json_get(doc, "svc.cfg.tags[0]"), "b"));
+    CHECK(!array_append(tags, &v));
+    CHECK(array_emplace(tags) == NULL);
+    CHECK(array_get_mut(tags, 0) == NULL);
+    CHECK(array_remove_at(tags, 0) == NULL);
+    CHECK(!object_add_pair(cfg, "k", &v));
+    CHECK(object_update(cfg, "port", &v) == NULL);
+    CHECK(object_remove(cfg, "host") == NULL);
+    CHECK(object_get_mut_n(cfg, "port", 4) == NULL);
+    CHECK(!json_object_sort(cfg, false));
+    CHECK(!json_array_unpack(json_get(doc, "svc.cfg.nums")));
+    CHECK(!json_insert(&cfg, "k", &v));
+
+    int error = JSON_SUCCESS;
+    JsonValue patch = json_parse("[{\"op\":\"add\",\"path\":\"/k\",\"value\":1}]", &error);
+    CHECK(json_patch_apply(cfg, &patch) == JSON_INVALID);
+    json_free(&patch);
+    patch = json_parse("{\"port\":null}", &error);
+    CHECK(json_merge_patch_apply(cfg, &patch) == JSON_INVALID);
+    json_free(&patch);
+}
+
+static void test_frozen_refuses(void) {
+    JsonValue doc = parse_frozen();
+    check_refused(&doc);
+    CHECK(json_get_mut(&doc, "svc.cfg.port") == NULL);
+    CHECK(!object_add_pair(json_get(&doc, "svc"), "k", &(JsonValue){.type = JSON_NULL}));
+    CHECK(!json_set_int(&doc, 1));
+    check_output(&doc, CONFIG);
+    CHECK(json_is_frozen(&doc));
+    json_free(&doc);
+}
+
+static void test_frozen_clone(void) {
+    JsonValue doc = parse_frozen();
+    int error = JSON_SUCCESS;
+    JsonValue copy = json_clone(&doc, &error);
+    CHECK(error == JSON_SUCCESS);
+    CHECK(!json_is_frozen(&copy));
+
+    // svc 以下的节点仍位于冻结源文档的存储块中
+    check_refused(&copy);
+    check_output(&copy, CONFIG);
+
+    // 克隆的根一层已复制，svc 位于克隆独占的存储块中：写入时复制 svc 的存储块，源文档不变
+    JsonValue v = {.type = JSON_INT, .value.int_value = 3};
+    CHECK(object_add_pair(json_get(&copy, "svc"), "k", &v));
+    CHECK(json_set_int(json_get_mut(&copy, "svc.cfg.port"), 8080));
+    CHECK(json_array_unpack(json_get_mut(&copy, "svc.cfg.nums")));
+    CHECK(array_append(json_get_mut(&copy, "svc.cfg.nums"), &v));
+    check_output(&copy, "{\"svc\":{\"cfg\":{\"port\":8080,\"host\":\"h\",\"tags\":[\"a\"],\"nums\":[1,2,3]},\"k\":3},"
+                        "\"name\":\"svc\"}");
+    check_output(&doc, CONFIG);
+    CHECK(json_is_frozen(json_get(&doc, "svc.cfg")));
+
+    // 源文档释放后，尚未复制的冻结存储块仍只能经 json_get_mut 写入
+    json_free(&doc);
+    CHECK(!json_set_string(json_get(&copy, "svc.cfg.tags[0]"), "b"));
+    CHECK(json_set_string(json_get_mut(&copy, "svc.cfg.tags[0]"), "b"));
+    check_output(json_get(&copy, "svc.cfg.tags"), "[\"b\"]");
+    json_free(&copy);
+}
+
+int main(void) {
+    test_frozen_refuses();
+    test_frozen_clone();
+    return g_failures;
+}
@@ -0,0 +1,65 @@
+//
+// 结构哈希：修改使节点及其祖先的哈希失效，json_equal/json_diff 不会因过期或相同的哈希漏掉差异
+//
+#include "mJson.h"
+#include "check.h"
+#include <stdlib.h>
+
+static const char *DOC = "{\"a\":{\"b\":1,\"s\":\"x\"},\"c\":[1,{\"d\":true}]}";
+
+static void check_diff(const JsonValue *from, const JsonValue *to, const char *expected) {
+    int error = JSON_SUCCESS;
+    JsonValue patch = json_diff(from, to, &error);
+    CHECK(error == JSON_SUCCESS);
+    char *out = json_to_string(&patch);
+    CHECK_STR(out, expected);
+    free(out);
+    json_free(&patch);
+}
+
+static void test_nested_set(void) {
+    JsonValue x = parse_with(DOC, JSON_PARSE_HASH), y = parse_with(DOC, JSON_PARSE_HASH);
+    CHECK(json_equal(&x, &y));
+    CHECK(json_hash(&x, JSON_HASH_UNORDERED) == json_hash(&y, JSON_HASH_UNORDERED));
+
+    CHECK(json_set_int(json_get(&x, "a.b"), 2));
+    CHECK(!json_equal(&x, &y));
+    CHECK(json_hash(&x, JSON_HASH_UNORDERED) != json_hash(&y, JSON_HASH_UNORDERED));
+    check_diff(&y, &x, "[{\"op\":\"replace\",\"path\":\"/a/b\",\"value\":2}]");
+
+    CHECK(json_set_int(json_get(&x, "a.b"), 1));
+    CHECK(json_equal(&x, &y));
+    check_diff(&y, &x, "[]");
+
+    JsonValue v = {.type = JSON_INT, .value.int_value = 3};
+    CHECK(array_append(json_get(&x, "c"), &v));
+    CHECK(!json_equal(&x, &y));
+    check_diff(&y, &x, "[{\"op\":\"add\",\"path\":\"/c/-\",\"value\":3}]");
+
+    int error = JSON_SUCCESS;
+    JsonValue patch = json_parse("[{\"op\":\"replace\",\"path\":\"/d\",\"value\":false}]", &error);
+    CHECK(json_patch_apply(json_get(&y, "c[1]"), &patch) == JSON_SUCCESS);
+    json_free(&patch);
+    check_diff(&x, &y, "[{\"op\":\"replace\",\"path\":\"/c/1/d\",\"value\":false},{\"op\":\"remove\",\"path\":\"/c/2\"}]");
+
+    json_free(&x);
+    json_free(&y);
+}
+
+static void test_clone_hashes(void) {
+    JsonValue x = parse_with(DOC, JSON_PARSE_HASH);
+    int error = JSON_SUCCESS;
+    JsonValue y = json_clone(&x, &error);
+    CHECK(error == JSON_SUCCESS);
+    CHECK(json_set_string(json_get_mut(&y, "a.s"), "changed"));
+    CHECK(!json_equal(&x, &y));
+    check_diff(&x, &y, "[{\"op\":\"replace\",\"path\":\"/a/s\",\"value\":\"changed\"}]");
+    json_free(&y);
+    json_free(&x);
+}
+
+int main(void) {
+    test_nested_set();
+    test_clone_hashes();
+    return g_failures;
+}
@@ -0,0 +1,151 @@
+//
+// 紧凑数值数组：解析后序列化必须与原始数值一致，展开不丢失精度
+//
+#include "mJson.h"
+#include "check.h"
+#include <stdlib.h>
+
+static void check_round_trip(const char *text, JsonType expected_type) {
+    JsonValue v = parse_with(text, JSON_PARSE_PACK_NUMBERS);
+    CHECK(v.type == expected_type);
+    char *out = json_to_string(&v);
+    CHECK_STR(out, text);
+    free(out);
+
+    // 展开为普通数组后输出不变
+    CHECK(json_array_unpack(&v));
+    out = json_to_string(&v);
+    CHECK_STR(out, text);
+    free(out);
+    json_free(&v);
+}
+
+static void test_mixed_round_trip(void) {
+    check_round_trip("[1,2,3]", JSON_INT_ARRAY);
+    check_round_trip("[1,2.5,-3]", JSON_FLOAT_ARRAY);
+    check_round_trip("[999999,0.5]", JSON_FLOAT_ARRAY);
+    check_round_trip("[1234567,0.5]", JSON_DOUBLE_ARRAY);
+    check_round_trip("[1000000,0.25]", JSON_DOUBLE_ARRAY);
+    check_round_trip("[-16777217,1.5]", JSON_DOUBLE_ARRAY);
+    check_round_trip("[0.5,3.1415926535898]", JSON_DOUBLE_ARRAY);
+    check_round_trip("[1,9007199254740993]", JSON_INT64_ARRAY);
+    check_round_trip("[-9223372036854775807,2147483648]", JSON_INT64_ARRAY);
+}
+
+/**
+ * 元素没有节点：按路径或下标取元素得到 NULL，类型化接口与展开后的节点可用
+ */
+static void test_element_access(void) {
+    JsonValue doc = parse_with("{\"a\":[1,2,3]}", JSON_PARSE_PACK_NUMBERS);
+    JsonValue *a = json_get_mut(&doc, "a");
+    CHECK(a && a->type == JSON_INT_ARRAY && json_array_size(a) == 3);
+    CHECK(json_get(&doc, "a[1]") == NULL);
+    CHECK(array_get(a, 1) == NULL);
+    CHECK(array_get_mut(a, 1) == NULL);
+    size_t count = 0;
+    const int32_t *ints = json_int_array(a, &count);
+    CHECK(ints && count == 3 && ints[1] == 2);
+    CHECK(json_array_unpack(a));
+    CHECK(json_get(&doc, "a[1]") && json_get(&doc, "a[1]")->value.int_value == 2);
+    CHECK(array_get(a, 2) && array_get(a, 2)->value.int_value == 3);
+    json_free(&doc);
+}
+
+static void test_unpack_int64(void) {
+    JsonValue v = parse_with("[1,9007199254740993]", JSON_PARSE_PACK_NUMBERS);
+    CHECK(json_array_unpack(&v));
+    const JsonValue *big = array_get(&v, 1);
+    CHECK(big && big->type == JSON_INT64 && big->value.int64_value == 9007199254740993LL);
+    CHECK(array_get(&v, 0)->type == JSON_INT);
+
+    // 与紧凑形式按数值相等
+    JsonValue packed = parse_with("[1,9007199254740993]", JSON_PARSE_PACK_NUMBERS);
+    CHECK(json_equal(&v, &packed));
+    CHECK(json_hash(&v, 0) == json_hash(&packed, 0));
+    json_free(&packed);
+
+    // CBOR 往返保持 int64
+    size_t size;
+    unsigned char *bytes = json_to_binary(&v, &size);
+    CHECK(bytes != NULL);
+    int error;
+    JsonValue decoded = json_from_binary(bytes, size, &error);
+    CHECK(error == JSON_SUCCESS);
+    const JsonValue *elem = array_get(&decoded, 1);
+    CHECK(elem && elem->type == JSON_INT64 && elem->value.int64_value == 9007199254740993LL);
+    free(bytes);
+    json_free(&decoded);
+    json_free(&v);
+}
+
+static int apply_patch(JsonValue *doc, const char *text) {
+    int error = JSON_SUCCESS;
+    JsonValue patch = json_parse(text, &error);
+    CHECK(error == JSON_SUCCESS);
+    error = json_patch_apply(doc, &patch);
+    json_free(&patch);
+    return error;
+}
+
+static void test_patch_reads_in_place(void) {
+    JsonValue doc = parse_with("{\"a\":[1,2,3],\"b\":[1,9007199254740993],\"c\":{}}", JSON_PARSE_PACK_NUMBERS);
+    // test 与 copy 只读取紧凑数组，不展开
+    CHECK(apply_patch(&doc, "[{\"op\":\"test\",\"path\":\"/a/1\",\"value\":2},"
+                            "{\"op\":\"copy\",\"from\":\"/a/2\",\"path\":\"/c/x\"}]") == JSON_SUCCESS);
+    CHECK(json_is_packed_array(json_get(&doc, "a")));
+    CHECK(apply_patch(&doc, "[{\"op\":\"test\",\"path\":\"/a/0\",\"value\":5}]") == JSON_INVALID);
+    CHECK(apply_patch(&doc, "[{\"op\":\"test\",\"path\":\"/a/3\",\"value\":1}]") == JSON_INVALID);
+    CHECK(apply_patch(&doc, "[{\"op\":\"test\",\"path\":\"/a/0/x\",\"value\":1}]") == JSON_INVALID);
+    CHECK(json_is_packed_array(json_get(&doc, "a")));
+    CHECK(json_is_packed_array(json_get(&doc, "b")));
+
+    // 只有被写入的紧凑数组展开
+    CHECK(apply_patch(&doc, "[{\"op\":\"move\",\"from\":\"/b/1\",\"path\":\"/c/y\"}]") == JSON_SUCCESS);
+    CHECK(!json_is_packed_array(json_get(&doc, "b")));
+    CHECK(json_is_packed_array(json_get(&doc, "a")));
+    check_output(&doc, "{\"a\":[1,2,3],\"b\":[1],\"c\":{\"x\":3,\"y\":9007199254740993}}");
+    json_free(&doc);
+
+    // 补丁失败时展开的紧凑数组恢复原样
+    doc = parse_with("{\"a\":[1,2,3],\"b\":{\"c\":[0.5,1.5]}}", JSON_PARSE_PACK_NUMBERS);
+    const int32_t *before = json_int_array(json_get(&doc, "a"), NULL);
+    CHECK(apply_patch(&doc, "[{\"op\":\"add\",\"path\":\"/a/-\",\"value\":\"x\"},"
+                            "{\"op\":\"remove\",\"path\":\"/b/c/0\"},"
+                            "{\"op\":\"test\",\"path\":\"/a/0\",\"value\":9}]") == JSON_INVALID);
+    size_t count = 0;
+    CHECK(json_get(&doc, "a")->type == JSON_INT_ARRAY);
+    CHECK(json_int_array(json_get(&doc, "a"), &count) == before && count == 3);
+    CHECK(json_get(&doc, "b.c")->type == JSON_FLOAT_ARRAY);
+    check_output(&doc, "{\"a\":[1,2,3],\"b\":{\"c\":[0.5,1.5]}}");
+    json_free(&doc);
+
+    // 整个文档是紧凑数组
+    doc = parse_with("[1,2]", JSON_PARSE_PACK_NUMBERS);
+    CHECK(apply_patch(&doc, "[{\"op\":\"replace\",\"path\":\"/0\",\"value\":5},"
+                            "{\"op\":\"test\",\"path\":\"/1\",\"value\":3}]") == JSON_INVALID);
+    CHECK(doc.type == JSON_INT_ARRAY);
+    check_output(&doc, "[1,2]");
+    CHECK(apply_patch(&doc, "[{\"op\":\"replace\",\"path\":\"/0\",\"value\":5}]") == JSON_SUCCESS);
+    CHECK(doc.type == JSON_ARRAY);
+    check_output(&doc, "[5,2]");
+    json_free(&doc);
+
+    // 冻结的文档可以 test，紧凑数组保持不变
+    doc = parse_with("{\"a\":[1,2,3]}", JSON_PARSE_PACK_NUMBERS);
+    CHECK(json_freeze(&doc));
+    int error = JSON_SUCCESS;
+    JsonValue copy = json_clone(&doc, &error);
+    CHECK(error == JSON_SUCCESS);
+    CHECK(apply_patch(&copy, "[{\"op\":\"test\",\"path\":\"/a/2\",\"value\":3}]") == JSON_SUCCESS);
+    CHECK(json_is_packed_array(json_get(&doc, "a")));
+    json_free(&copy);
+    json_free(&doc);
+}
+
+int main(void) {
+    test_element_access();
+    test_mixed_round_trip();
+    test_unpack_int64();
+    test_patch_reads_in_place();
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+//
+// 并行序列化：各线程数与切块阈值下 json_to_string_parallel、json_write_fd 的输出与 json_to_string 逐字节相同
+//
+#include "mJson.h"
+#include "check.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+static const char *DOCS[] = {
+    "[]",
+    "{}",
+    "7",
+    "\"s\\n\\u0001\"",
+    "[[],{},[[]],{\"a\":{}}]",
+    "{\"e\":[],\"o\":{},\"s\":\"x\\\"y\",\"n\":null,\"b\":[true,false],\"d\":-0.5e-3}",
+    "[1,[2,[3,[4,[5,{\"k\":[6,7,8,9]}]]]],\"t\",{\"u\":{\"v\":{\"w\":[10,11,12]}}}]",
+    "{\"ints\":[1,2,3,4,5,6,7,8,9],\"longs\":[1,9007199254740993,3],\"floats\":[0.5,1.5,2.5],"
+    "\"doubles\":[0.5,3.1415926535898],\"empty\":[],\"mixed\":[1,\"x\",[1,2,3]]}",
+};
+
+/**
+ * 生成较大的嵌套文档：每层若干对象、紧凑数组和字符串
+ */
+static char *build_large(void) {
+    size_t cap = 1 << 20, len = 0;
+    char *text = malloc(cap);
+    if (!text) return NULL;
+    len += (size_t)snprintf(text + len, cap - len, "{\"items\":[");
+    for (int i = 0; i < 3000; i++) {
+        len += (size_t)snprintf(text + len, cap - len,
+                                "%s{\"id\":%d,\"name\":\"n%d\\t\",\"vals\":[%d,%d,%d],\"f\":[%d.5,1.25],\"sub\":{\"a\":[],\"b\":{}}}",
+                                i ? "," : "", i, i, i, i + 1, i + 2, i);
+    }
+    snprintf(text + len, cap - len, "],\"tail\":[[],[[]],{}]}");
+    return text;
+}
+
+static char *read_fd(int fd) {
+    size_t cap = 4096, len = 0;
+    char *out = malloc(cap + 1);
+    ssize_t n;
+    while (out && (n = read(fd, out + len, cap - len)) > 0) {
+        len += (size_t)n;
+        if (len == cap) {
+            char *grown = realloc(out, cap * 2 + 1);
+            if (!grown) {
+                free(out);
+                return NULL;
+            }
+            out = grown;
+            cap *= 2;
+        }
+    }
+    if (out) out[len] = '\0';
+    return out;
+}
+
+static void check_write_file(const JsonValue *jv, const JsonSerializeOptions *options, const char *expected) {
+    char path[] = "/tmp/mjson_parallel_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    if (fd < 0) return;
+    CHECK(json_write_fd(fd, jv, options) == JSON_SUCCESS);
+    CHECK(lseek(fd, 0, SEEK_SET) == 0);
+    char *written = read_fd(fd);
+    CHECK_STR(written, expected);
+    free(written);
+    close(fd);
+    unlink(path);
+}
+
+static void check_document(const JsonValue *jv) {
+    static const size_t splits[] = {1, 2, 3, 7, 0};
+    char *expected = json_to_string(jv);
+    CHECK(expected != NULL);
+    if (!expected) return;
+    for (unsigned threads = 1; threads <= 8; threads++) {
+        for (size_t s = 0; s < sizeof(splits) / sizeof(splits[0]); s++) {
+            JsonSerializeOptions options = {threads, splits[s]};
+            char *out = json_to_string_parallel(jv, &options);
+            CHECK_STR(out, expected);
+            free(out);
+            if (threads % 3 == 1) check_write_file(jv, &options, expected);
+        }
+    }
+    char *out = json_to_string_parallel(jv, NULL);
+    CHECK_STR(out, expected);
+    free(out);
+    free(expected);
+}
+
+static void test_documents(void) {
+    for (size_t i = 0; i < sizeof(DOCS) / sizeof(DOCS[0]); i++) {
+        JsonValue plain = parse_with(DOCS[i], 0);
+        JsonValue packed = parse_with(DOCS[i], JSON_PARSE_PACK_NUMBERS);
+        check_document(&plain);
+        check_document(&packed);
+        json_free(&plain);
+        json_free(&packed);
+    }
+}
+
+static void test_large(void) {
+    char *text = build_large();
+    CHECK(text != NULL);
+    if (!text) return;
+    JsonValue doc = parse_with(text, JSON_PARSE_PACK_NUMBERS);
+    free(text);
+    check_document(&doc);
+    // 带序列化缓存的子树同样一致
+    free(json_to_string_cached(json_get(&doc, "items[5]")));
+    check_document(&doc);
+    json_free(&doc);
+}
+
+static void test_pipe(void) {
+    JsonValue doc = parse_with(DOCS[7], JSON_PARSE_PACK_NUMBERS);
+    char *expected = json_to_string(&doc);
+    int fds[2];
+    CHECK(pipe(fds) == 0);
+    JsonSerializeOptions options = {4, 1};
+    // 输出小于管道缓冲，写完再读取
+    CHECK(json_write_fd(fds[1], &doc, &options) == JSON_SUCCESS);
+    close(fds[1]);
+    char *written = read_fd(fds[0]);
+    CHECK_STR(written, expected);
+    close(fds[0]);
+    CHECK(json_write_fd(-1, &doc, &options) == JSON_INVALID);
+    free(written);
+    free(expected);
+    json_free(&doc);
+}
+
+int main(void) {
+    test_documents();
+    test_large();
+    test_pipe();
+    return g_failures;
+}
@@ -0,0 +1,75 @@
+//
+// JSONPath 编译与求值的边界：深层 ! 链、极端切片步长、紧凑数组元素不可选中
+//
+#include "mJson.h"
+#include "check.h"
+#include <stdlib.h>
+
+static void test_not_depth(void) {
+    char expr[4096] = "$[?";
+    size_t len = strlen(expr);
+    for (int i = 0; i < 2000; i++) expr[len++] = '!';
+    strcpy(expr + len, "@.a]");
+    int error = JSON_SUCCESS;
+    JsonQuery *q = json_query_compile(expr, &error);
+    CHECK(q == NULL);
+    CHECK(error == JSON_TOO_DEEP);
+
+    error = JSON_SUCCESS;
+    q = json_query_compile("$[?!!@.a]", &error);
+    CHECK(q != NULL && error == JSON_SUCCESS);
+    json_query_free(q);
+}
+
+static void test_slice_step(void) {
+    int error;
+    JsonValue doc = json_parse("{\"a\":[\"x\",{},{},{},\"y\"]}", &error);
+    CHECK(error == JSON_SUCCESS);
+    const JsonValue *results[8];
+    CHECK(json_query(&doc, "$.a[0:5:9223372036854775807]", results, 8, &error) == 1);
+    CHECK(results[0]->type == JSON_STRING);
+    CHECK(json_query(&doc, "$.a[::-9223372036854775807]", results, 8, &error) == 1);
+    CHECK_STR(results[0]->value.string_value, "y");
+    CHECK(json_query(&doc, "$.a[1:4:2]", results, 8, &error) == 2);
+    CHECK(json_query(&doc, "$.a[::-2]", results, 8, &error) == 3);
+    json_free(&doc);
+}
+
+/**
+ * 紧凑数组元素没有节点：选择器不选中元素，只能选中数组本身；过滤条件可以读取元素
+ */
+static void test_packed(void) {
+    JsonParseOptions options = {NULL, NULL, JSON_PARSE_PACK_NUMBERS};
+    int error;
+    JsonValue doc = json_parse_ex("{\"a\":[1,2,3],\"items\":[{\"p\":[5,6]},{\"p\":[0.5]}],\"s\":[1,\"x\"]}",
+                                  &options, &error);
+    CHECK(error == JSON_SUCCESS);
+    CHECK(json_get(&doc, "a")->type == JSON_INT_ARRAY);
+    const JsonValue *results[8];
+    static const char *NO_MATCH[] = {"$.a[*]", "$.a[1]", "$.a[-1]", "$.a[0:2]", "$.a[?(@ > 1)]", "$..p[0]", "$..p[*]"};
+    for (size_t i = 0; i < sizeof(NO_MATCH) / sizeof(NO_MATCH[0]); i++) {
+        error = JSON_INVALID;
+        CHECK(json_query(&doc, NO_MATCH[i], results, 8, &error) == 0);
+        CHECK(error == JSON_SUCCESS);
+    }
+    CHECK(json_query(&doc, "$.a", results, 8, &error) == 1 && results[0]->type == JSON_INT_ARRAY);
+    CHECK(json_query(&doc, "$..p", results, 8, &error) == 2);
+    CHECK(results[0]->type == JSON_INT_ARRAY && results[1]->type == JSON_FLOAT_ARRAY);
+    CHECK(json_query(&doc, "$.items[?(@.p[1] == 6)].p", results, 8, &error) == 1);
+    CHECK(json_query(&doc, "$.items[?(@.p[0] < 1)]", results, 8, &error) == 1);
+    // 混合类型的数组不压缩，元素照常选中
+    CHECK(json_query(&doc, "$.s[*]", results, 8, &error) == 2);
+
+    // 展开后元素成为节点
+    CHECK(json_array_unpack(json_get_mut(&doc, "a")));
+    CHECK(json_query(&doc, "$.a[*]", results, 8, &error) == 3);
+    CHECK(json_query(&doc, "$.a[1]", results, 8, &error) == 1 && results[0]->value.int_value == 2);
+    json_free(&doc);
+}
+
+int main(void) {
+    test_not_depth();
+    test_slice_step();
+    test_packed();
+    return g_failures ? 1 : 0;
+}
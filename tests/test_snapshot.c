@@ -0,0 +1,190 @@
+//
+// 可映射快照：写入后打开的往返、各 JsonType 节点上的访问接口、损坏的文件头
+//
+#include "mJson.h"
+#include "check.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+static char g_path[] = "/tmp/mjson_snapshot_XXXXXX";
+
+static unsigned char *read_file(size_t *size) {
+    FILE *fp = fopen(g_path, "rb");
+    if (!fp) return NULL;
+    fseek(fp, 0, SEEK_END);
+    *size = (size_t)ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    unsigned char *data = malloc(*size);
+    if (data && fread(data, 1, *size, fp) != *size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    return data;
+}
+
+static void write_file(const unsigned char *data, size_t size) {
+    FILE *fp = fopen(g_path, "wb");
+    CHECK(fp != NULL);
+    if (!fp) return;
+    CHECK(fwrite(data, 1, size, fp) == size);
+    fclose(fp);
+}
+
+/**
+ * 标量节点不是容器：按容器访问一律得到空结果
+ */
+static void check_scalar(const JsonSnapNode *node, JsonType type) {
+    CHECK(node != NULL);
+    CHECK(json_snap_type(node) == type);
+    CHECK(json_snap_size(node) == 0);
+    CHECK(json_snap_array_get(node, 0) == NULL);
+    CHECK(json_snap_object_at(node, 0, NULL) == NULL);
+    CHECK(json_snap_find(node, "k") == NULL);
+    size_t count = 1;
+    CHECK(json_snap_packed(node, &count) == NULL);
+}
+
+static void test_round_trip(void) {
+    JsonValue doc = parse_with("{\"n\":null,\"b\":true,\"i\":-7,\"f\":0,\"d\":0,\"s\":\"a\\u0000b\",\"big\":[1,5000000000],"
+                               "\"arr\":[1,\"x\",{}],\"o\":{\"z\":1,\"a\":2},\"e\":{},"
+                               "\"pi\":[1,2],\"pl\":[1,9007199254740993],\"pf\":[0.5,1.5],\"pd\":[0.5,3.1415926535898]}",
+                               JSON_PARSE_PACK_NUMBERS);
+    CHECK(json_set_float(json_get_mut(&doc, "f"), 1.5f));
+    CHECK(json_set_double(json_get_mut(&doc, "d"), 2.25));
+    CHECK(json_array_unpack(json_get_mut(&doc, "big")));
+    CHECK(json_get(&doc, "big[1]")->type == JSON_INT64);
+    CHECK(json_snapshot_write(&doc, g_path) == JSON_SUCCESS);
+    json_free(&doc);
+
+    int error = JSON_INVALID;
+    JsonSnapshot *snap = json_snapshot_open(g_path, &error);
+    CHECK(snap != NULL && error == JSON_SUCCESS);
+    if (!snap) return;
+    const JsonSnapNode *root = json_snapshot_root(snap);
+    CHECK(json_snap_type(root) == JSON_OBJECT);
+    CHECK(json_snap_size(root) == 14);
+
+    check_scalar(json_snap_get(root, "n"), JSON_NULL);
+    check_scalar(json_snap_get(root, "b"), JSON_BOOL);
+    CHECK(json_snap_bool(json_snap_get(root, "b")));
+    check_scalar(json_snap_get(root, "i"), JSON_INT);
+    CHECK(json_snap_int(json_snap_get(root, "i")) == -7);
+    CHECK(json_snap_int64(json_snap_get(root, "i")) == -7);
+    check_scalar(json_snap_get(root, "f"), JSON_FLOAT);
+    CHECK(json_snap_float(json_snap_get(root, "f")) == 1.5f);
+    check_scalar(json_snap_get(root, "d"), JSON_DOUBLE);
+    CHECK(json_snap_double(json_snap_get(root, "d")) == 2.25);
+    check_scalar(json_snap_get(root, "s"), JSON_STRING);
+    size_t len = 0;
+    const char *str = json_snap_string(json_snap_get(root, "s"), &len);
+    CHECK(str && len == 1 && str[0] == 'a');
+    // int64 的负载是数值本身，不能当作容器偏移读取
+    check_scalar(json_snap_get(root, "big[1]"), JSON_INT64);
+    CHECK(json_snap_int64(json_snap_get(root, "big[1]")) == 5000000000LL);
+    CHECK(json_snap_int(json_snap_get(root, "big[1]")) == 0);
+
+    const JsonSnapNode *arr = json_snap_get(root, "arr");
+    CHECK(json_snap_type(arr) == JSON_ARRAY && json_snap_size(arr) == 3);
+    CHECK(json_snap_packed(arr, NULL) == NULL);
+    CHECK(json_snap_object_at(arr, 0, NULL) == NULL);
+    CHECK_STR(json_snap_string(json_snap_array_get(arr, 1), NULL), "x");
+    CHECK(json_snap_type(json_snap_get(root, "arr[2]")) == JSON_OBJECT);
+    CHECK(json_snap_array_get(arr, 3) == NULL);
+
+    // object_at 按原始位置，find 按键二分
+    const JsonSnapNode *obj = json_snap_get(root, "o");
+    const char *key = NULL;
+    CHECK(json_snap_int(json_snap_object_at(obj, 0, &key)) == 1);
+    CHECK_STR(key, "z");
+    CHECK(json_snap_int(json_snap_object_at(obj, 1, &key)) == 2);
+    CHECK_STR(key, "a");
+    CHECK(json_snap_object_at(obj, 2, &key) == NULL);
+    CHECK(json_snap_int(json_snap_find(obj, "a")) == 2);
+    CHECK(json_snap_array_get(obj, 0) == NULL);
+    CHECK(json_snap_packed(obj, NULL) == NULL);
+    CHECK(json_snap_size(json_snap_get(root, "e")) == 0);
+    CHECK(json_snap_get(root, "missing") == NULL);
+
+    size_t count = 0;
+    const int32_t *ints = json_snap_packed(json_snap_get(root, "pi"), &count);
+    CHECK(json_snap_type(json_snap_get(root, "pi")) == JSON_INT_ARRAY);
+    CHECK(ints && count == 2 && ints[1] == 2);
+    const int64_t *longs = json_snap_packed(json_snap_get(root, "pl"), &count);
+    CHECK(json_snap_type(json_snap_get(root, "pl")) == JSON_INT64_ARRAY);
+    CHECK(longs && count == 2 && longs[1] == 9007199254740993LL);
+    const float *floats = json_snap_packed(json_snap_get(root, "pf"), &count);
+    CHECK(json_snap_type(json_snap_get(root, "pf")) == JSON_FLOAT_ARRAY);
+    CHECK(floats && count == 2 && floats[1] == 1.5f);
+    const double *doubles = json_snap_packed(json_snap_get(root, "pd"), &count);
+    CHECK(json_snap_type(json_snap_get(root, "pd")) == JSON_DOUBLE_ARRAY);
+    CHECK(doubles && count == 2 && doubles[1] == 3.1415926535898);
+    // 紧凑数组的元素没有节点
+    CHECK(json_snap_size(json_snap_get(root, "pd")) == 2);
+    CHECK(json_snap_get(root, "pi[0]") == NULL);
+    json_snapshot_close(snap);
+}
+
+static void check_open_fails(void) {
+    int error = JSON_SUCCESS;
+    JsonSnapshot *snap = json_snapshot_open(g_path, &error);
+    CHECK(snap == NULL);
+    CHECK(error == JSON_INVALID);
+    json_snapshot_close(snap);
+}
+
+static void test_corrupt_header(void) {
+    JsonValue doc = parse_with("{\"a\":[1,\"x\"]}", 0);
+    CHECK(json_snapshot_write(&doc, g_path) == JSON_SUCCESS);
+    json_free(&doc);
+    size_t size = 0;
+    unsigned char *data = read_file(&size);
+    CHECK(data != NULL && size > 32);
+    if (!data) return;
+    unsigned char *bad = malloc(size);
+    if (!bad) return;
+
+    // 文件头依次为 magic[8]、byte_order、version、root_offset、file_size
+    memcpy(bad, data, size);
+    bad[0] ^= 0xFF;
+    write_file(bad, size);
+    check_open_fails();
+
+    memcpy(bad, data, size);
+    bad[12] ^= 0xFF;
+    write_file(bad, size);
+    check_open_fails();
+
+    memcpy(bad, data, size);
+    memset(bad + 16, 0xFF, 8);
+    write_file(bad, size);
+    check_open_fails();
+
+    // 截断：文件大小与头部记录不符
+    write_file(data, size - 1);
+    check_open_fails();
+    // 不足一个文件头
+    write_file(data, 8);
+    check_open_fails();
+
+    write_file(data, size);
+    int error = JSON_INVALID;
+    JsonSnapshot *snap = json_snapshot_open(g_path, &error);
+    CHECK(snap != NULL && error == JSON_SUCCESS);
+    json_snapshot_close(snap);
+
+    int missing = JSON_SUCCESS;
+    CHECK(json_snapshot_open("/nonexistent/mjson.snap", &missing) == NULL && missing == JSON_INVALID);
+    free(bad);
+    free(data);
+}
+
+int main(void) {
+    int fd = mkstemp(g_path);
+    if (fd < 0) return 1;
+    close(fd);
+    test_round_trip();
+    test_corrupt_header();
+    unlink(g_path);
+    return g_failures;
+}
@@ -0,0 +1,84 @@
+//
+// 有序对象：空对象的排序状态、带索引对象的批量插入、扩容失败后的索引一致性
+//
+#include "mJson.h"
+#include "check.h"
+#include <stdlib.h>
+
+static void test_empty_sorted(void) {
+    JsonValue obj = parse_with("{}", JSON_PARSE_SORT_KEYS);
+    CHECK(json_object_is_sorted(&obj));
+    JsonValue v = {.type = JSON_INT, .value.int_value = 1};
+    CHECK(object_insert_sorted(&obj, "b", &v));
+    CHECK(object_insert_sorted(&obj, "a", &v));
+    check_output(&obj, "{\"a\":1,\"b\":1}");
+    json_free(&obj);
+
+    obj = parse_with("{\"x\":{}}", JSON_PARSE_SORT_KEYS);
+    CHECK(json_object_is_sorted(json_get(&obj, "x")));
+    json_free(&obj);
+}
+
+static void test_indexed_batch(void) {
+    JsonValue obj = parse_with("{\"m\":1,\"c\":2}", JSON_PARSE_SORT_KEYS | JSON_PARSE_KEEP_ORDER);
+    CHECK(json_object_is_sorted(&obj));
+    const char *keys[] = {"z", "a", "d"};
+    JsonValue values[] = {{.type = JSON_INT, .value.int_value = 3}, {.type = JSON_INT, .value.int_value = 4}, {.type = JSON_INT, .value.int_value = 5}};
+    CHECK(object_insert_sorted_batch(&obj, keys, values, 3));
+    // 与逐个 object_insert_sorted 相同：追加，键序由索引维护
+    check_output(&obj, "{\"m\":1,\"c\":2,\"z\":3,\"a\":4,\"d\":5}");
+    static const char *all[] = {"a", "c", "d", "m", "z"};
+    for (size_t i = 0; i < 5; i++) CHECK(object_get_n(&obj, all[i], 1) != NULL);
+    json_free(&obj);
+
+    JsonValue single = parse_with("{\"m\":1,\"c\":2}", JSON_PARSE_SORT_KEYS | JSON_PARSE_KEEP_ORDER);
+    for (size_t i = 0; i < 3; i++) {
+        JsonValue v = {.type = JSON_INT, .value.int_value = (int)i + 3};
+        CHECK(object_insert_sorted(&single, keys[i], &v));
+    }
+    check_output(&single, "{\"m\":1,\"c\":2,\"z\":3,\"a\":4,\"d\":5}");
+    json_free(&single);
+}
+
+// 1：键值对存储块（至少 64 字节）的分配失败；2：按键索引（很小）的扩容失败
+static int g_fail_mode;
+
+static void *test_malloc(void *ctx, size_t size) {
+    (void)ctx;
+    return g_fail_mode == 1 && size >= 64 ? NULL : malloc(size);
+}
+
+static void *test_realloc(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    if ((g_fail_mode == 1 && size >= 64) || (g_fail_mode == 2 && size < 64)) return NULL;
+    return realloc(ptr, size);
+}
+
+static void test_free(void *ctx, void *ptr) {
+    (void)ctx;
+    free(ptr);
+}
+
+static void test_grow_failure(void) {
+    static const JsonAllocator failing = {test_malloc, test_realloc, test_free, NULL};
+    json_set_allocator(&failing);
+    JsonValue obj = parse_with("{\"b\":1}", JSON_PARSE_SORT_KEYS | JSON_PARSE_KEEP_ORDER);
+    JsonValue v = {.type = JSON_INT, .value.int_value = 2};
+    for (g_fail_mode = 1; g_fail_mode <= 2; g_fail_mode++) CHECK(!object_insert_sorted(&obj, "a", &v));
+    g_fail_mode = 0;
+    for (int i = 0; i < 8; i++) {
+        char key[2] = {(char)('c' + i), '\0'};
+        CHECK(object_insert_sorted(&obj, key, &v));
+    }
+    CHECK(object_insert_sorted(&obj, "a", &v));
+    CHECK(object_get_n(&obj, "a", 1) && object_get_n(&obj, "j", 1));
+    json_free(&obj);
+    json_set_allocator(NULL);
+}
+
+int main(void) {
+    test_empty_sorted();
+    test_indexed_batch();
+    test_grow_failure();
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+//
+// 解析/序列化统计（仅以 MJSON_STATS=ON 构建）：已知输入的节点数、深度、字符串字节、转义数与各线程累计
+//
+#include "mJson.h"
+#include "check.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+// 键 "kéy" 与字符串 "x\n" 各含一个转义，解码后字符串共 1 + 2 + 4 + 1 + 1 字节
+static const char TEXT[] = " {\"a\":[1,2.5,\"x\\n\"],\"k\\u00e9y\":{\"c\":null,\"d\":true}} ";
+
+static void check_known_parse(const JsonParseStats *s) {
+    CHECK(s->calls == 1);
+    CHECK(s->bytes == sizeof(TEXT) - 1);
+    CHECK(s->nodes[JSON_NULL] == 1);
+    CHECK(s->nodes[JSON_BOOL] == 1);
+    CHECK(s->nodes[JSON_INT] == 1);
+    CHECK(s->nodes[JSON_FLOAT] == 1);
+    CHECK(s->nodes[JSON_DOUBLE] == 0);
+    CHECK(s->nodes[JSON_STRING] == 1);
+    CHECK(s->nodes[JSON_ARRAY] == 1);
+    CHECK(s->nodes[JSON_OBJECT] == 2);
+    CHECK(s->max_depth == 3);
+    CHECK(s->string_bytes == 9);
+    CHECK(s->escapes == 2);
+}
+
+static void test_known_input(void) {
+    json_stats_reset();
+    CHECK(json_stats_enabled());
+    int error = JSON_INVALID;
+    JsonValue doc = json_parse(TEXT, &error);
+    CHECK(error == JSON_SUCCESS);
+    JsonStats stats;
+    json_stats_last(&stats);
+    check_known_parse(&stats.parse);
+    CHECK(stats.serialize.calls == 0);
+
+    char *text = json_to_string(&doc);
+    CHECK(text != NULL);
+    json_stats_last(&stats);
+    CHECK(stats.serialize.calls == 1);
+    CHECK(text && stats.serialize.bytes == strlen(text));
+    // 序列化不改变最近一次解析的记录
+    check_known_parse(&stats.parse);
+    free(text);
+    json_free(&doc);
+}
+
+static void test_totals(void) {
+    json_stats_reset();
+    int error;
+    JsonValue doc = json_parse(TEXT, &error);
+    json_free(&doc);
+    // 紧凑数组按整体计一个节点
+    doc = parse_with("[[1,2,3],[1.5]]", JSON_PARSE_PACK_NUMBERS);
+    JsonStats stats;
+    json_stats_last(&stats);
+    CHECK(stats.parse.nodes[JSON_ARRAY] == 1);
+    CHECK(stats.parse.nodes[JSON_INT_ARRAY] == 1);
+    CHECK(stats.parse.nodes[JSON_FLOAT_ARRAY] == 1);
+    CHECK(stats.parse.nodes[JSON_INT] == 0);
+    CHECK(stats.parse.max_depth == 2);
+    char *text = json_to_string(&doc);
+    free(text);
+    json_free(&doc);
+
+    json_stats_thread(&stats);
+    CHECK(stats.parse.calls == 2);
+    CHECK(stats.parse.bytes == sizeof(TEXT) - 1 + 15);
+    CHECK(stats.parse.nodes[JSON_OBJECT] == 2);
+    CHECK(stats.parse.nodes[JSON_ARRAY] == 2);
+    CHECK(stats.parse.max_depth == 3);
+    CHECK(stats.parse.string_bytes == 9);
+    CHECK(stats.parse.escapes == 2);
+    CHECK(stats.serialize.calls == 1);
+    CHECK(stats.serialize.bytes == 15);
+
+    // 失败的解析同样计入，字节数为出错前消耗的输入
+    doc = json_parse("[1,", &error);
+    CHECK(error != JSON_SUCCESS);
+    json_stats_last(&stats);
+    CHECK(stats.parse.calls == 1 && stats.parse.bytes == 3);
+    json_stats_thread(&stats);
+    CHECK(stats.parse.calls == 3);
+
+    json_stats_reset();
+    json_stats_thread(&stats);
+    CHECK(stats.parse.calls == 0 && stats.parse.bytes == 0 && stats.serialize.calls == 0);
+}
+
+static void *parse_in_thread(void *arg) {
+    JsonStats *out = arg;
+    int error;
+    for (int i = 0; i < 3; i++) {
+        JsonValue doc = json_parse(TEXT, &error);
+        json_free(&doc);
+    }
+    json_stats_thread(out);
+    return NULL;
+}
+
+static void test_per_thread(void) {
+    json_stats_reset();
+    int error;
+    JsonValue doc = json_parse("[1]", &error);
+    json_free(&doc);
+
+    JsonStats worker = {0};
+    pthread_t thread;
+    CHECK(pthread_create(&thread, NULL, parse_in_thread, &worker) == 0);
+    pthread_join(thread, NULL);
+    CHECK(worker.parse.calls == 3);
+    CHECK(worker.parse.bytes == 3 * (sizeof(TEXT) - 1));
+    CHECK(worker.parse.nodes[JSON_OBJECT] == 6);
+    CHECK(worker.parse.escapes == 6);
+
+    // 其他线程的解析不计入本线程
+    JsonStats mine;
+    json_stats_thread(&mine);
+    CHECK(mine.parse.calls == 1);
+    CHECK(mine.parse.bytes == 3);
+    CHECK(mine.parse.nodes[JSON_OBJECT] == 0);
+    CHECK(mine.parse.max_depth == 2);
+}
+
+int main(void) {
+    test_known_input();
+    test_totals();
+    test_per_thread();
+    return g_failures;
+}
@@ -0,0 +1,113 @@
+//
+// 严格校验：RFC 8259 的 UTF-8、转义代理对、嵌套深度与尾随内容，以及报告的错误偏移
+//
+#include "mJson.h"
+#include "check.h"
+#include <stdlib.h>
+
+/**
+ * 校验 text（按字面长度，可含 NUL），结果与错误偏移均需符合期望；成功时不写 err_offset
+ */
+static void check_validate(const char *text, size_t len, int expected, size_t expected_offset) {
+    size_t offset = (size_t)-1;
+    int result = json_validate(text, len, &offset);
+    if (result != expected || offset != expected_offset) {
+        fprintf(stderr, "  input \"%.*s\": result %d offset %zu\n", (int)len, text, result, offset);
+    }
+    CHECK(result == expected);
+    CHECK(offset == expected_offset);
+}
+
+#define VALID(s) check_validate(s, sizeof(s) - 1, JSON_SUCCESS, (size_t)-1)
+#define INVALID_AT(s, off) check_validate(s, sizeof(s) - 1, JSON_INVALID, off)
+
+static void test_utf8(void) {
+    VALID("\"\xC3\xA9\"");
+    VALID("\"\xE2\x82\xAC\"");
+    VALID("\"\xF0\x9F\x98\x80\"");
+    VALID("\"\xF4\x8F\xBF\xBF\"");
+    // 过长编码
+    INVALID_AT("\"\xC0\xAF\"", 1);
+    INVALID_AT("\"\xC1\xBF\"", 1);
+    INVALID_AT("\"\xE0\x80\xAF\"", 1);
+    INVALID_AT("\"\xF0\x80\x80\xAF\"", 1);
+    // UTF-8 编码的代理项
+    INVALID_AT("\"\xED\xA0\x80\"", 1);
+    INVALID_AT("\"\xED\xBF\xBF\"", 1);
+    // 超出 U+10FFFF
+    INVALID_AT("\"\xF4\x90\x80\x80\"", 1);
+    INVALID_AT("\"\xF5\x80\x80\x80\"", 1);
+    // 孤立的后续字节、截断的序列
+    INVALID_AT("\"\x80\"", 1);
+    INVALID_AT("\"\xE2\x82\"", 1);
+    INVALID_AT("[\"ok\",\"\xC0\xAF\"]", 7);
+    // 未转义的控制字符
+    INVALID_AT("\"a\tb\"", 2);
+}
+
+static void test_surrogates(void) {
+    VALID("\"\\ud83d\\ude00\"");
+    VALID("\"\\uD83D\\uDE00\"");
+    VALID("\"\\u00e9\\uffff\"");
+    INVALID_AT("\"\\ud83d\"", 1);
+    INVALID_AT("\"\\ude00\"", 1);
+    INVALID_AT("\"\\ud83dx\"", 1);
+    INVALID_AT("\"\\ud83d\\u0041\"", 1);
+    INVALID_AT("\"ab\\ud83d\\ud83d\"", 3);
+    INVALID_AT("\"\\u12g4\"", 1);
+}
+
+static void test_depth(void) {
+    char *text = malloc(2 * 1025);
+    if (!text) return;
+    memset(text, '[', 1025);
+    memset(text + 1025, ']', 1025);
+    // 1024 层可以通过，第 1025 个开括号处报告 JSON_TOO_DEEP
+    check_validate(text + 1, 2 * 1024, JSON_SUCCESS, (size_t)-1);
+    check_validate(text, 2 * 1025, JSON_TOO_DEEP, 1024);
+    free(text);
+
+    // 对象与数组共用深度限制：512 组 {"a":[ 共 1024 层
+    text = malloc(512 * 8 + 8);
+    if (!text) return;
+    size_t len = 0;
+    for (int i = 0; i < 512; i++) len += (size_t)sprintf(text + len, "{\"a\":[");
+    size_t inner = len;
+    text[len++] = '1';
+    for (int i = 0; i < 512; i++) len += (size_t)sprintf(text + len, "]}");
+    check_validate(text, len, JSON_SUCCESS, (size_t)-1);
+    text[inner] = '{';
+    check_validate(text, len, JSON_TOO_DEEP, inner);
+    free(text);
+}
+
+static void test_structure(void) {
+    VALID("  [1, 2]\n");
+    VALID("1 ");
+    VALID("{\"a\":[true,false,null,-0.5e+3]}");
+    // 尾随内容
+    INVALID_AT("[1] x", 4);
+    INVALID_AT("{} {}", 3);
+    INVALID_AT("1 2", 2);
+    INVALID_AT("[1,]", 3);
+    INVALID_AT("{\"a\":1,}", 7);
+    INVALID_AT("01", 1);
+    INVALID_AT("", 0);
+    INVALID_AT("   ", 3);
+    // 长度之外的字节不参与校验
+    check_validate("[1]garbage", 3, JSON_SUCCESS, (size_t)-1);
+    check_validate("[1]", 2, JSON_INVALID, 2);
+    // 内嵌 NUL 不是合法字符
+    check_validate("[1]\0", 4, JSON_INVALID, 3);
+    size_t offset = 7;
+    CHECK(json_validate(NULL, 0, &offset) == JSON_INVALID && offset == 0);
+    CHECK(json_validate("[1", 2, NULL) == JSON_INVALID);
+}
+
+int main(void) {
+    test_utf8();
+    test_surrogates();
+    test_depth();
+    test_structure();
+    return g_failures;
+}